@@ -326,6 +326,64 @@ pub fn executable(
     }
 }
 
+/// build a headless command line executable (no zgui/sokol dependencies).
+/// Creates `name` (install) and `name-run` steps; arguments after `--` are
+/// forwarded to the run step.
+pub fn command_line_executable(
+    b: *std.Build,
+    comptime name: []const u8,
+    comptime main_file_name: []const u8,
+    options: Options,
+    module_deps: []const std.Build.Module.Import,
+) *std.Build.Step.Compile
+{
+    const exe = b.addExecutable(
+        .{
+            .name = name,
+            .root_source_file = b.path(main_file_name),
+            .target = options.target,
+            .optimize = options.optimize,
+        },
+    );
+
+    for (module_deps)
+        |mod|
+    {
+        exe.root_module.addImport(mod.name, mod.module);
+    }
+
+    const install_exe_step = &b.addInstallArtifact(
+        exe,
+        .{},
+    ).step;
+
+    const install = b.step(
+        name,
+        "Build/install '" ++ name ++ "' executable",
+    );
+    install.dependOn(install_exe_step);
+    b.getInstallStep().dependOn(install);
+
+    const run_cmd = b.addRunArtifact(exe);
+    run_cmd.step.dependOn(install);
+    if (b.args)
+        |args|
+    {
+        run_cmd.addArgs(args);
+    }
+
+    const run_step = b.step(
+        name ++ "-run",
+        "Run '" ++ name ++ "' executable",
+    );
+    run_step.dependOn(&run_cmd.step);
+
+    // zls check
+    options.all_check_step.dependOn(&exe.step);
+
+    return exe;
+}
+
 /// options for module_with_tests_and_artifact
 pub const CreateModuleOptions = struct {
     b: *std.Build,
@@ -509,6 +567,22 @@ pub fn build(
             debug_print_messages,
         );
 
+        const enable_tracing = b.option(
+            bool,
+            "enable_tracing",
+            (
+                "compile in the span tracer (src/tracing.zig) so that map "
+                ++ "building, joins, linearization and resampling can be "
+                ++ "exported as Chrome/Perfetto trace JSON"
+            ),
+        ) orelse false;
+
+        build_options.addOption(
+            bool,
+            "enable_tracing",
+            enable_tracing,
+        );
+
         const write_test_wavs = b.option(
             bool,
             "write_sampling_test_wave_files",
@@ -578,6 +652,27 @@ pub fn build(
         }
     );
 
+    const allocation_tracker = module_with_tests_and_artifact(
+        "allocation_tracker",
+        .{
+            .b = b,
+            .options = options,
+            .fpath = "src/allocation_tracker.zig",
+        }
+    );
+
+    const tracing = module_with_tests_and_artifact(
+        "tracing",
+        .{
+            .b = b,
+            .options = options,
+            .fpath = "src/tracing.zig",
+            .deps = &.{
+                .{ .name = "build_options", .module = build_options_mod},
+            },
+        }
+    );
+
     const kissfft = b.addStaticLibrary(
         .{
             .name = "kissfft",
@@ -674,6 +769,7 @@ pub fn build(
                 .{ .name = "string_stuff", .module = string_stuff },
                 .{ .name = "opentime", .module = opentime },
                 .{ .name = "comath", .module = comath_dep.module("comath") },
+                .{ .name = "tracing", .module = tracing },
             },
         }
     );
@@ -724,6 +820,22 @@ pub fn build(
             .deps = &.{
                 .{ .name = "opentime", .module = opentime },
                 .{ .name = "curve", .module = curve },
+                .{ .name = "tracing", .module = tracing },
+            },
+        }
+    );
+
+    // visualizer plot data, shared by the gui and headless tools
+    const plot_series = module_with_tests_and_artifact(
+        "plot_series",
+        .{
+            .b = b,
+            .options = options,
+            .fpath = "src/plot_series.zig",
+            .deps = &.{
+                .{ .name = "opentime", .module = opentime },
+                .{ .name = "curve", .module = curve },
+                .{ .name = "topology", .module = topology },
             },
         }
     );
@@ -747,6 +859,7 @@ pub fn build(
                 .{ .name = "wav", .module = wav_dep },
                 .{ .name = "opentime", .module = opentime, },
                 .{ .name = "topology", .module = topology, },
+                .{ .name = "tracing", .module = tracing, },
                 .{ .name = "build_options", .module = build_options_mod, },
             },
         }
@@ -765,6 +878,8 @@ pub fn build(
                 .{ .name = "topology", .module = topology },
                 .{ .name = "treecode", .module = treecode },
                 .{ .name = "sampling", .module = sampling },
+                .{ .name = "allocation_tracker", .module = allocation_tracker },
+                .{ .name = "tracing", .module = tracing },
                 .{ .name = "build_options", .module = build_options_mod},
             },
         }
@@ -880,6 +995,7 @@ pub fn build(
         .{ .name = "opentime", .module = opentime },
         .{ .name = "curve", .module = curve },
         .{ .name = "topology", .module = topology },
+        .{ .name = "plot_series", .module = plot_series },
 
         // libraries with c components
         .{ .name = "spline_gym", .module = &spline_gym.root_module },
@@ -923,4 +1039,93 @@ pub fn build(
         options,
         common_deps,
     );
+
+    // headless tools, not built for the web
+    if (!options.target.result.isWasm())
+    {
+        const tool_deps:[]const std.Build.Module.Import = &.{
+            .{ .name = "build_options", .module = build_options_mod},
+            .{ .name = "opentime", .module = opentime },
+            .{ .name = "curve", .module = curve },
+            .{ .name = "topology", .module = topology },
+            .{ .name = "treecode", .module = treecode },
+            .{ .name = "sampling", .module = sampling },
+            .{ .name = "opentimelineio", .module = opentimelineio },
+            .{ .name = "allocation_tracker", .module = allocation_tracker },
+            .{ .name = "tracing", .module = tracing },
+            .{ .name = "plot_series", .module = plot_series },
+        };
+
+        // benchmarks
+        {
+            const bench_exe = command_line_executable(
+                b,
+                "wrinkles_bench",
+                "src/wrinkles_bench.zig",
+                options,
+                tool_deps,
+            );
+
+            const run_bench = b.addRunArtifact(bench_exe);
+            if (b.args)
+                |args|
+            {
+                run_bench.addArgs(args);
+            }
+
+            const bench_step = b.step(
+                "bench",
+                (
+                 "Run the benchmark suite and print JSON results "
+                 ++ "(use -Doptimize=ReleaseFast, pass args after --)"
+                ),
+            );
+            bench_step.dependOn(&run_bench.step);
+        }
+
+        // synthetic timeline generator
+        _ = command_line_executable(
+            b,
+            "wrinkles_generate",
+            "src/wrinkles_generate.zig",
+            options,
+            tool_deps,
+        );
+
+        // pipelined preprocessing of many .otio files
+        _ = command_line_executable(
+            b,
+            "wrinkles_batch",
+            "src/wrinkles_batch.zig",
+            options,
+            tool_deps,
+        );
+
+        // resident projection query daemon
+        _ = command_line_executable(
+            b,
+            "wrinkles_serve",
+            "src/wrinkles_serve.zig",
+            options,
+            tool_deps,
+        );
+
+        // presentation ranges changed between two revisions of a timeline
+        _ = command_line_executable(
+            b,
+            "wrinkles_diff",
+            "src/wrinkles_diff.zig",
+            options,
+            tool_deps,
+        );
+
+        // headless runs of the visualizer math
+        _ = command_line_executable(
+            b,
+            "wrinkles_plot",
+            "src/wrinkles_plot.zig",
+            options,
+            tool_deps,
+        );
+    }
 }
@@ -0,0 +1,498 @@
+//! Allocation accounting.
+//!
+//! AllocationTracker wraps a child allocator and counts allocations, frees,
+//! bytes, live/peak bytes and a power-of-two size class histogram.  Stats are
+//! kept in total and per call site: `allocator_at(@src())` returns an
+//! allocator whose traffic is attributed to the calling source location.
+//!
+//! Tests and benchmarks can assert a Budget against the totals (or a site) so
+//! that allocation regressions fail the test step.
+//!
+//! Not thread safe.  The tracker must not be moved after an allocator has
+//! been requested from it.
+
+const std = @import("std");
+
+/// number of buckets in the size class histogram.  Bucket `i` counts
+/// allocations of (2^(i-1), 2^i] bytes, the last bucket counts everything
+/// larger.
+pub const SIZE_CLASS_COUNT = 32;
+
+/// counters for a set of allocations
+pub const Stats = struct {
+    allocations: usize = 0,
+    frees: usize = 0,
+    resizes: usize = 0,
+    /// allocations or resizes refused by the child allocator
+    failures: usize = 0,
+    /// total bytes requested (including growth by resize)
+    bytes_allocated: usize = 0,
+    bytes_freed: usize = 0,
+    /// bytes currently allocated
+    live_bytes: usize = 0,
+    /// high water mark of live_bytes
+    peak_live_bytes: usize = 0,
+    size_classes: [SIZE_CLASS_COUNT]usize = [_]usize{0} ** SIZE_CLASS_COUNT,
+
+    /// histogram bucket for an allocation of len bytes
+    pub fn size_class(
+        len: usize,
+    ) usize
+    {
+        if (len <= 1) {
+            return 0;
+        }
+
+        return @min(
+            std.math.log2_int_ceil(usize, len),
+            SIZE_CLASS_COUNT - 1,
+        );
+    }
+
+    fn record_alloc(
+        self: *@This(),
+        len: usize,
+    ) void
+    {
+        self.allocations += 1;
+        self.bytes_allocated += len;
+        self.size_classes[size_class(len)] += 1;
+        self.add_live(len);
+    }
+
+    fn record_free(
+        self: *@This(),
+        len: usize,
+    ) void
+    {
+        self.frees += 1;
+        self.bytes_freed += len;
+        self.live_bytes -|= len;
+    }
+
+    fn record_resize(
+        self: *@This(),
+        old_len: usize,
+        new_len: usize,
+    ) void
+    {
+        self.resizes += 1;
+        if (new_len > old_len)
+        {
+            self.bytes_allocated += new_len - old_len;
+            self.add_live(new_len - old_len);
+        }
+        else
+        {
+            self.bytes_freed += old_len - new_len;
+            self.live_bytes -|= old_len - new_len;
+        }
+    }
+
+    fn add_live(
+        self: *@This(),
+        len: usize,
+    ) void
+    {
+        self.live_bytes += len;
+        self.peak_live_bytes = @max(self.peak_live_bytes, self.live_bytes);
+    }
+
+    /// check the stats against the budget, printing every exceeded limit.
+    pub fn expect_within(
+        self: @This(),
+        budget: Budget,
+    ) !void
+    {
+        var exceeded = false;
+
+        inline for (std.meta.fields(Budget))
+            |f|
+        {
+            if (@field(budget, f.name))
+                |limit|
+            {
+                const measured = @field(self, f.name["max_".len..]);
+                if (measured > limit)
+                {
+                    std.debug.print(
+                        "allocation budget exceeded: {s} = {d} (limit {d})\n",
+                        .{ f.name["max_".len..], measured, limit },
+                    );
+                    exceeded = true;
+                }
+            }
+        }
+
+        if (exceeded) {
+            return error.AllocationBudgetExceeded;
+        }
+    }
+
+    pub fn format(
+        self: @This(),
+        comptime _: []const u8,
+        _: std.fmt.FormatOptions,
+        writer: anytype,
+    ) !void
+    {
+        try writer.print(
+            "allocs: {d} frees: {d} resizes: {d} bytes: {d} live: {d} "
+            ++ "peak: {d}",
+            .{
+                self.allocations,
+                self.frees,
+                self.resizes,
+                self.bytes_allocated,
+                self.live_bytes,
+                self.peak_live_bytes,
+            },
+        );
+    }
+};
+
+/// upper limits on Stats fields, null means unlimited.  Each field is named
+/// "max_" ++ the Stats field it limits.
+pub const Budget = struct {
+    max_allocations: ?usize = null,
+    max_bytes_allocated: ?usize = null,
+    max_live_bytes: ?usize = null,
+    max_peak_live_bytes: ?usize = null,
+};
+
+/// a call site that allocates through the tracker
+pub const Site = struct {
+    tracker: *AllocationTracker,
+    src: ?std.builtin.SourceLocation,
+    stats: Stats = .{},
+
+    /// allocator that attributes its traffic to this site
+    pub fn allocator(
+        self: *@This(),
+    ) std.mem.Allocator
+    {
+        return .{
+            .ptr = self,
+            .vtable = &.{
+                .alloc = alloc,
+                .resize = resize,
+                .free = free,
+            },
+        };
+    }
+
+    fn alloc(
+        ctx: *anyopaque,
+        len: usize,
+        ptr_align: u8,
+        ret_addr: usize,
+    ) ?[*]u8
+    {
+        const self: *Site = @ptrCast(@alignCast(ctx));
+        const result = self.tracker.child.rawAlloc(len, ptr_align, ret_addr);
+        if (result == null)
+        {
+            self.stats.failures += 1;
+            self.tracker.totals.failures += 1;
+            return null;
+        }
+
+        self.stats.record_alloc(len);
+        self.tracker.totals.record_alloc(len);
+        return result;
+    }
+
+    fn resize(
+        ctx: *anyopaque,
+        buf: []u8,
+        buf_align: u8,
+        new_len: usize,
+        ret_addr: usize,
+    ) bool
+    {
+        const self: *Site = @ptrCast(@alignCast(ctx));
+        if (!self.tracker.child.rawResize(buf, buf_align, new_len, ret_addr))
+        {
+            self.stats.failures += 1;
+            self.tracker.totals.failures += 1;
+            return false;
+        }
+
+        self.stats.record_resize(buf.len, new_len);
+        self.tracker.totals.record_resize(buf.len, new_len);
+        return true;
+    }
+
+    fn free(
+        ctx: *anyopaque,
+        buf: []u8,
+        buf_align: u8,
+        ret_addr: usize,
+    ) void
+    {
+        const self: *Site = @ptrCast(@alignCast(ctx));
+        self.tracker.child.rawFree(buf, buf_align, ret_addr);
+
+        self.stats.record_free(buf.len);
+        self.tracker.totals.record_free(buf.len);
+    }
+};
+
+/// Allocator wrapper that records Stats in total and per call site.
+pub const AllocationTracker = struct {
+    child: std.mem.Allocator,
+    totals: Stats = .{},
+    /// traffic through allocator() rather than allocator_at()
+    untagged: Site,
+    /// tagged sites, keyed on source location
+    sites: std.AutoArrayHashMapUnmanaged(SiteKey, *Site) = .{},
+
+    const SiteKey = struct {
+        file: usize,
+        line: u32,
+        column: u32,
+    };
+
+    /// The result must not be moved once an allocator has been requested
+    /// from it.
+    pub fn init(
+        child: std.mem.Allocator,
+    ) AllocationTracker
+    {
+        return .{
+            .child = child,
+            .untagged = .{ .tracker = undefined, .src = null },
+        };
+    }
+
+    /// heap allocate an AllocationTracker from child
+    pub fn create(
+        child: std.mem.Allocator,
+    ) !*AllocationTracker
+    {
+        const result = try child.create(AllocationTracker);
+        result.* = AllocationTracker.init(child);
+        return result;
+    }
+
+    /// free the bookkeeping (not the tracked allocations)
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        for (self.sites.values())
+            |site|
+        {
+            self.child.destroy(site);
+        }
+        self.sites.deinit(self.child);
+    }
+
+    /// deinit and free a tracker made with create()
+    pub fn destroy(
+        self: *@This(),
+    ) void
+    {
+        const child = self.child;
+        self.deinit();
+        child.destroy(self);
+    }
+
+    /// allocator whose traffic is only counted in the totals
+    pub fn allocator(
+        self: *@This(),
+    ) std.mem.Allocator
+    {
+        self.untagged.tracker = self;
+        return self.untagged.allocator();
+    }
+
+    /// allocator whose traffic is also counted against the site `src`,
+    /// usually `@src()` of the caller
+    pub fn allocator_at(
+        self: *@This(),
+        src: std.builtin.SourceLocation,
+    ) !std.mem.Allocator
+    {
+        return (try self.site(src)).allocator();
+    }
+
+    /// find or create the Site for src
+    pub fn site(
+        self: *@This(),
+        src: std.builtin.SourceLocation,
+    ) !*Site
+    {
+        const key = SiteKey{
+            .file = @intFromPtr(src.file.ptr),
+            .line = src.line,
+            .column = src.column,
+        };
+
+        const entry = try self.sites.getOrPut(self.child, key);
+        if (!entry.found_existing)
+        {
+            errdefer _ = self.sites.swapRemove(key);
+            entry.value_ptr.* = try self.child.create(Site);
+            entry.value_ptr.*.* = .{ .tracker = self, .src = src };
+        }
+
+        return entry.value_ptr.*;
+    }
+
+    /// stats for the site src, or null if nothing was allocated there
+    pub fn stats_at(
+        self: @This(),
+        src: std.builtin.SourceLocation,
+    ) ?Stats
+    {
+        const key = SiteKey{
+            .file = @intFromPtr(src.file.ptr),
+            .line = src.line,
+            .column = src.column,
+        };
+
+        const s = self.sites.get(key) orelse return null;
+        return s.stats;
+    }
+
+    /// zero all counters.  Live bytes are also reset, so frees of memory
+    /// allocated before the reset are clamped at zero.
+    pub fn reset(
+        self: *@This(),
+    ) void
+    {
+        self.totals = .{};
+        self.untagged.stats = .{};
+        for (self.sites.values())
+            |s|
+        {
+            s.stats = .{};
+        }
+    }
+
+    /// check the totals against the budget
+    pub fn expect_within(
+        self: @This(),
+        budget: Budget,
+    ) !void
+    {
+        try self.totals.expect_within(budget);
+    }
+
+    /// human readable report of the totals, histogram and each site
+    pub fn write_report(
+        self: @This(),
+        writer: anytype,
+    ) !void
+    {
+        try writer.print("total: {s}\n", .{ self.totals });
+
+        try writer.print("size classes:\n", .{});
+        for (self.totals.size_classes, 0..)
+            |count, ind|
+        {
+            if (count == 0) {
+                continue;
+            }
+            try writer.print(
+                "  <= 2^{d:<2}: {d}\n",
+                .{ ind, count },
+            );
+        }
+
+        try writer.print("  untagged: {s}\n", .{ self.untagged.stats });
+        for (self.sites.values())
+            |s|
+        {
+            const src = s.src.?;
+            try writer.print(
+                "  {s}:{d}:{d} ({s}): {s}\n",
+                .{ src.file, src.line, src.column, src.fn_name, s.stats },
+            );
+        }
+    }
+};
+
+test "AllocationTracker: totals, peak and size classes"
+{
+    var tracker = AllocationTracker.init(std.testing.allocator);
+    defer tracker.deinit();
+
+    const allocator = tracker.allocator();
+
+    const a = try allocator.alloc(u8, 100);
+    const b = try allocator.alloc(u8, 1000);
+    allocator.free(a);
+    const c = try allocator.alloc(u8, 10);
+    allocator.free(b);
+    allocator.free(c);
+
+    try std.testing.expectEqual(3, tracker.totals.allocations);
+    try std.testing.expectEqual(3, tracker.totals.frees);
+    try std.testing.expectEqual(1110, tracker.totals.bytes_allocated);
+    try std.testing.expectEqual(0, tracker.totals.live_bytes);
+    try std.testing.expectEqual(1100, tracker.totals.peak_live_bytes);
+
+    // 10 -> 2^4, 100 -> 2^7, 1000 -> 2^10
+    try std.testing.expectEqual(1, tracker.totals.size_classes[4]);
+    try std.testing.expectEqual(1, tracker.totals.size_classes[7]);
+    try std.testing.expectEqual(1, tracker.totals.size_classes[10]);
+}
+
+test "AllocationTracker: per site stats"
+{
+    const tracker = try AllocationTracker.create(std.testing.allocator);
+    defer tracker.destroy();
+
+    const here = @src();
+    const site_allocator = try tracker.allocator_at(here);
+
+    const a = try site_allocator.alloc(u32, 4);
+    defer site_allocator.free(a);
+
+    const b = try tracker.allocator().alloc(u32, 8);
+    defer tracker.allocator().free(b);
+
+    // the same source location resolves to the same site
+    try std.testing.expectEqual(
+        try tracker.site(here),
+        try tracker.site(here),
+    );
+
+    const site_stats = tracker.stats_at(here).?;
+    try std.testing.expectEqual(1, site_stats.allocations);
+    try std.testing.expectEqual(16, site_stats.bytes_allocated);
+
+    try std.testing.expectEqual(2, tracker.totals.allocations);
+    try std.testing.expectEqual(48, tracker.totals.live_bytes);
+
+    try std.testing.expectEqual(null, tracker.stats_at(@src()));
+}
+
+test "AllocationTracker: budgets"
+{
+    const tracker = try AllocationTracker.create(std.testing.allocator);
+    defer tracker.destroy();
+
+    var list = std.ArrayList(u64).init(tracker.allocator());
+    defer list.deinit();
+
+    for (0..100)
+        |i|
+    {
+        try list.append(i);
+    }
+
+    try tracker.expect_within(
+        .{
+            .max_allocations = 100,
+            .max_peak_live_bytes = 100 * @sizeOf(u64) * 4,
+        },
+    );
+
+    try std.testing.expectError(
+        error.AllocationBudgetExceeded,
+        tracker.expect_within(.{ .max_allocations = 0 }),
+    );
+}
@@ -79,6 +79,25 @@ void otio_write_map_to_png(
         const char*
 );
 
+typedef struct otio_HashMapStats {
+    size_t count;
+    size_t capacity;
+    double load_factor;
+    size_t max_probe_length;
+    double mean_probe_length;
+} otio_HashMapStats;
+typedef struct otio_TopologicalMapStats {
+    size_t node_count;
+    size_t max_code_length;
+    double mean_code_length;
+    otio_HashMapStats map_space_to_code;
+    otio_HashMapStats map_code_to_space;
+    otio_HashMapStats map_space_to_id;
+    size_t nodes_capacity;
+    size_t nodes_bytes;
+} otio_TopologicalMapStats;
+int otio_topo_map_fetch_stats(otio_TopologicalMap, otio_TopologicalMapStats*);
+
 // Topologies
 ///////////////////////////////////////////////////////////////////////////////
 typedef struct otio_Topology {
@@ -92,6 +111,16 @@ otio_Topology otio_fetch_topology(
 int otio_topo_fetch_input_bounds(otio_Topology, const otio_ContinuousInterval*);
 int otio_topo_fetch_output_bounds(otio_Topology, const otio_ContinuousInterval*);
 
+typedef struct otio_TopologyStats {
+    size_t mappings;
+    size_t empty_mappings;
+    size_t affine_mappings;
+    size_t linear_mappings;
+    size_t knots;
+    size_t max_knots_per_mapping;
+} otio_TopologyStats;
+int otio_topo_fetch_stats(otio_Topology, otio_TopologyStats*);
+
 
 // ProjectionOperatorMap
 ///////////////////////////////////////////////////////////////////////////////
@@ -107,6 +136,22 @@ otio_ProjectionOperatorMap otio_build_projection_op_map_to_media_tp_cvr(
 size_t otio_po_map_fetch_num_endpoints(otio_ProjectionOperatorMap in_map);
 const float* otio_po_map_fetch_endpoints(otio_ProjectionOperatorMap in_map);
 
+#define OTIO_OPERATORS_PER_SEGMENT_BUCKETS 16
+typedef struct otio_ProjectionOperatorMapStats {
+    size_t segments;
+    size_t operators;
+    size_t max_operators_per_segment;
+    double mean_operators_per_segment;
+    // bucket i counts segments with i operators, the last bucket counts
+    // segments with OTIO_OPERATORS_PER_SEGMENT_BUCKETS-1 or more
+    size_t operators_per_segment[OTIO_OPERATORS_PER_SEGMENT_BUCKETS];
+    otio_TopologyStats topology;
+} otio_ProjectionOperatorMapStats;
+int otio_po_map_fetch_stats(
+        otio_ProjectionOperatorMap in_map,
+        otio_ProjectionOperatorMapStats* result
+);
+
 size_t otio_po_map_fetch_num_operators_for_segment(
         otio_ProjectionOperatorMap in_map,
         size_t ind
@@ -352,6 +352,64 @@ pub export fn otio_write_map_to_png(
     std.log.debug("wrote map to: '{s}'\n", .{ filepath_c });
 }
 
+/// copy a stats struct from the library into its c mirror, field by field
+fn to_c_stats(
+    comptime T: type,
+    src: anytype,
+) T
+{
+    var result: T = undefined;
+
+    inline for (std.meta.fields(T))
+        |field|
+    {
+        @field(result, field.name) = switch (@typeInfo(field.type)) {
+            .Struct => to_c_stats(field.type, @field(src, field.name)),
+            else => @field(src, field.name),
+        };
+    }
+
+    return result;
+}
+
+pub export fn otio_topo_map_fetch_stats(
+    in_map: c.otio_TopologicalMap,
+    result: *c.otio_TopologicalMapStats,
+) c_int
+{
+    if (in_map.ref == null) {
+        return -1;
+    }
+
+    const map = ptrCast(otio.TopologicalMap, in_map.ref.?);
+
+    result.* = to_c_stats(c.otio_TopologicalMapStats, map.stats());
+
+    return 0;
+}
+
+pub export fn otio_po_map_fetch_stats(
+    in_po_map_c: c.otio_ProjectionOperatorMap,
+    result: *c.otio_ProjectionOperatorMapStats,
+) c_int
+{
+    if (in_po_map_c.ref == null) {
+        return -1;
+    }
+
+    const po_map = ptrCast(
+        otio.ProjectionOperatorMap,
+        in_po_map_c.ref.?
+    );
+
+    result.* = to_c_stats(
+        c.otio_ProjectionOperatorMapStats,
+        po_map.stats(),
+    );
+
+    return 0;
+}
+
 pub export fn otio_po_map_fetch_num_endpoints(
     in_po_map: c.otio_ProjectionOperatorMap,
 ) usize
@@ -567,6 +625,27 @@ pub export fn otio_topo_fetch_output_bounds(
     return 0;
 }
 
+pub export fn otio_topo_fetch_stats(
+    topo_c: c.otio_Topology,
+    result: *c.otio_TopologyStats,
+) c_int
+{
+    if (topo_c.ref == null) {
+        std.log.err("Null topo pointer\n", .{});
+
+        return -1;
+    }
+
+    const topo = ptrCast(
+        topology.Topology,
+        topo_c.ref.?,
+    );
+
+    result.* = to_c_stats(c.otio_TopologyStats, topo.stats());
+
+    return 0;
+}
+
 fn init_SpaceLabel(
     in_c: c.otio_SpaceLabel
 ) !otio.SpaceLabel
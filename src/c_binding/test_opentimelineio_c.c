@@ -202,6 +202,17 @@ main(
     );
     PRINTIF("built map: %p\n", map.ref);
 
+    otio_TopologicalMapStats map_stats;
+    if (!otio_topo_map_fetch_stats(map, &map_stats))
+    {
+        PRINTIF(
+                "map stats: %lu nodes, treecode length max: %lu mean: %g\n",
+                map_stats.node_count,
+                map_stats.max_code_length,
+                map_stats.mean_code_length
+        );
+    }
+
     // otio_write_map_to_png(arena.allocator, map, "/var/tmp/from_c_map.dot");
 
     // build a projection operator map to media
@@ -222,6 +233,19 @@ main(
             n_endpoints
     );
 
+    otio_ProjectionOperatorMapStats po_map_stats;
+    if (!otio_po_map_fetch_stats(po_map, &po_map_stats))
+    {
+        PRINTIF(
+                "po_map stats: %lu segments, %lu operators, %lu mappings, "
+                "%lu knots\n",
+                po_map_stats.segments,
+                po_map_stats.operators,
+                po_map_stats.topology.mappings,
+                po_map_stats.topology.knots
+        );
+    }
+
     const float* endpoints = otio_po_map_fetch_endpoints(po_map);
 
     for (int i=0; i < n_endpoints; i++) 
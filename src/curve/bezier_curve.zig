@@ -48,6 +48,7 @@ const generic_curve = @import("generic_curve.zig");
 const linear_curve = @import("linear_curve.zig");
 const control_point = @import("control_point.zig");
 const string_stuff = @import("string_stuff");
+const tracing = @import("tracing");
 
 pub const U_TYPE = opentime.Ordinate.BaseType;
 
@@ -1087,6 +1088,12 @@ pub const Bezier = struct {
         allocator:std.mem.Allocator,
     ) !linear_curve.Linear 
     {
+        const span = tracing.begin_sized(
+            "curve.Bezier.linearized",
+            self.segments.len,
+        );
+        defer span.end();
+
         var linearized_knots = std.ArrayList(
             control_point.ControlPoint
         ).init(allocator);
@@ -3,10 +3,12 @@ pub const linear_curve = @import("linear_curve.zig");
 pub const control_point = @import("control_point.zig");
 pub const bezier_curve = @import("bezier_curve.zig");
 pub const test_segment_projection = @import("test_segment_projection.zig");
+pub const polyline_cache = @import("polyline_cache.zig");
 
 pub const Bezier = bezier_curve.Bezier;
 pub const Linear = linear_curve.Linear;
 pub const ControlPoint = control_point.ControlPoint;
+pub const PolylineCache = polyline_cache.PolylineCache;
 
 pub const linearize_segment = bezier_curve.linearize_segment;
 pub const read_segment_json = bezier_curve.read_segment_json;
@@ -26,4 +28,5 @@ test {
     _ = bezier_curve;
     _ = control_point;
     _ = test_segment_projection;
+    _ = polyline_cache;
 }
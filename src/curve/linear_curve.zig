@@ -255,6 +255,42 @@ pub fn LinearOf(
                 return opentime.OUTOFBOUNDS;
             }
 
+            /// compute the output ordinate at input.r along with its
+            /// derivative, the slope of the segment times input.i.  Seeding
+            /// input.i with 1 gives d(output)/d(input); passing the result
+            /// of another projection chains the derivatives.  Null where
+            /// output_at_input is not an ordinate.
+            pub fn output_at_input_dual(
+                self: @This(),
+                input: opentime.Dual_Ord,
+            ) ?opentime.Dual_Ord
+            {
+                const value = (
+                    self.output_at_input(input.r).ordinate() catch return null
+                );
+
+                if (self.knots.len < 2) {
+                    return .{ .r = value };
+                }
+
+                // the end point takes the slope of the last segment
+                const index = (
+                    self.nearest_smaller_knot_index_input(input.r)
+                    orelse self.knots.len - 2
+                );
+                const knot = self.knots[index];
+                const next_knot = self.knots[index + 1];
+
+                const slope = next_knot.out.sub(knot.out).div(
+                    next_knot.in.sub(knot.in)
+                );
+
+                return .{
+                    .r = value,
+                    .i = slope.mul(input.i),
+                };
+            }
+
             /// compute the input ordinate at the output ordinate
             pub fn input_at_output(
                 self: @This(),
@@ -477,7 +513,11 @@ pub fn LinearOf(
                     or opentime.lt(input_points[input_points.len - 1], ib.start)
                 )
                 {
-                    return &.{ try self.clone(allocator) };
+                    const result = try allocator.alloc(Monotonic, 1);
+                    errdefer allocator.free(result);
+
+                    result[0] = try self.clone(allocator);
+                    return result;
                 }
 
                 var new_knot_slices = (
@@ -1684,3 +1724,39 @@ test "Linear.Monotonic: slope_kind"
         );
     }
 }
+
+test "Linear.Monotonic: output_at_input_dual"
+{
+    const crv = Linear.Monotonic{
+        .knots = &.{
+            ControlPoint.init(.{ .in = 0, .out = 0 }),
+            ControlPoint.init(.{ .in = 2, .out = 1 }),
+            ControlPoint.init(.{ .in = 4, .out = 5 }),
+        },
+    };
+
+    const first = crv.output_at_input_dual(
+        opentime.Dual_Ord.init_ri(1, 1)
+    ).?;
+    try opentime.expectOrdinateEqual(0.5, first.r);
+    try opentime.expectOrdinateEqual(0.5, first.i);
+
+    // the derivative of the input is carried through
+    const second = crv.output_at_input_dual(
+        opentime.Dual_Ord.init_ri(3, 2)
+    ).?;
+    try opentime.expectOrdinateEqual(3, second.r);
+    try opentime.expectOrdinateEqual(4, second.i);
+
+    // the end point uses the last segment
+    const end = crv.output_at_input_dual(
+        opentime.Dual_Ord.init_ri(4, 1)
+    ).?;
+    try opentime.expectOrdinateEqual(5, end.r);
+    try opentime.expectOrdinateEqual(2, end.i);
+
+    try expectEqual(
+        null,
+        crv.output_at_input_dual(opentime.Dual_Ord.init_ri(5, 1)),
+    );
+}
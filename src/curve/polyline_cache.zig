@@ -0,0 +1,548 @@
+//! Cached, viewport adaptive polylines for drawing curves.
+//!
+//! Instead of evaluating a fixed number of points every frame, a polyline is
+//! built once per curve and zoom level:
+//!
+//! - Bezier segments are subdivided adaptively until the chord error is
+//!   below `tolerance_px` pixels at the current zoom.
+//! - Linear curves are min/max decimated per pixel column, so that a
+//!   curve with millions of knots draws at most four points per column
+//!   without losing spikes.
+//!
+//! Polylines cover the whole curve rather than the visible range, so panning
+//! does not invalidate them.  Zoom is quantized to powers of two, so an
+//! entry is only rebuilt when the curve is edited or the zoom changes by 2x.
+//!
+//! Entries are keyed on a caller supplied identity (usually the address of
+//! the curve) and validated against a hash of the curve data.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const bezier_curve = @import("bezier_curve.zig");
+const control_point = @import("control_point.zig");
+
+/// the visible region of a plot and its size on screen
+pub const Viewport = struct {
+    x_min: f64,
+    x_max: f64,
+    y_min: f64,
+    y_max: f64,
+    width_px: f64,
+    height_px: f64,
+
+    /// pixels per unit in x and y, rounded up to a power of two so that
+    /// small zooms reuse the same polyline
+    fn zoom_level(
+        self: @This(),
+    ) ZoomLevel
+    {
+        return .{
+            .x = level_for(self.width_px, self.x_max - self.x_min),
+            .y = level_for(self.height_px, self.y_max - self.y_min),
+        };
+    }
+
+    fn level_for(
+        pixels: f64,
+        extent: f64,
+    ) i16
+    {
+        if (!(pixels > 0) or !(extent > 0) or !std.math.isFinite(extent)) {
+            return 0;
+        }
+
+        return @intFromFloat(
+            std.math.clamp(@ceil(std.math.log2(pixels / extent)), -512, 512)
+        );
+    }
+};
+
+/// log2 of pixels per unit in each axis
+const ZoomLevel = struct {
+    x: i16,
+    y: i16,
+
+    fn px_per_x(
+        self: @This(),
+    ) f64
+    {
+        return std.math.pow(f64, 2, @floatFromInt(self.x));
+    }
+
+    fn px_per_y(
+        self: @This(),
+    ) f64
+    {
+        return std.math.pow(f64, 2, @floatFromInt(self.y));
+    }
+};
+
+/// knobs for building polylines
+pub const Options = struct {
+    /// maximum distance, in pixels, between the polyline and the curve
+    tolerance_px: f64 = 0.5,
+    /// limit on bezier subdivision, 2^max_depth points per segment
+    max_depth: u8 = 12,
+};
+
+/// points of a polyline, owned by the cache.  Valid until the next call
+/// for the same identity or until the cache is deinit'd.
+pub const Polyline = struct {
+    xv: []const f64,
+    yv: []const f64,
+};
+
+const Entry = struct {
+    content_hash: u64,
+    zoom: ZoomLevel,
+    xv: []f64,
+    yv: []f64,
+};
+
+/// Cache of polylines, one per curve identity.
+pub const PolylineCache = struct {
+    allocator: std.mem.Allocator,
+    options: Options = .{},
+    entries: std.AutoHashMapUnmanaged(usize, Entry) = .{},
+
+    /// number of lookups answered from the cache
+    hits: usize = 0,
+    /// number of lookups that built a polyline
+    misses: usize = 0,
+
+    pub fn init(
+        allocator: std.mem.Allocator,
+    ) PolylineCache
+    {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        var iter = self.entries.valueIterator();
+        while (iter.next())
+            |entry|
+        {
+            self.free_entry(entry.*);
+        }
+        self.entries.deinit(self.allocator);
+    }
+
+    fn free_entry(
+        self: @This(),
+        entry: Entry,
+    ) void
+    {
+        self.allocator.free(entry.xv);
+        self.allocator.free(entry.yv);
+    }
+
+    /// drop the polyline for identity, if there is one
+    pub fn invalidate(
+        self: *@This(),
+        identity: usize,
+    ) void
+    {
+        if (self.entries.fetchRemove(identity))
+            |kv|
+        {
+            self.free_entry(kv.value);
+        }
+    }
+
+    /// polyline for a bezier curve at the zoom level of viewport
+    pub fn bezier(
+        self: *@This(),
+        identity: usize,
+        crv: bezier_curve.Bezier,
+        viewport: Viewport,
+    ) !Polyline
+    {
+        return try self.fetch(
+            identity,
+            std.mem.sliceAsBytes(crv.segments),
+            viewport,
+            crv,
+            build_bezier,
+        );
+    }
+
+    /// polyline for a linear curve at the zoom level of viewport
+    pub fn linear(
+        self: *@This(),
+        identity: usize,
+        knots: []const control_point.ControlPoint,
+        viewport: Viewport,
+    ) !Polyline
+    {
+        return try self.fetch(
+            identity,
+            std.mem.sliceAsBytes(knots),
+            viewport,
+            knots,
+            build_linear,
+        );
+    }
+
+    fn fetch(
+        self: *@This(),
+        identity: usize,
+        content: []const u8,
+        viewport: Viewport,
+        crv: anytype,
+        comptime build_fn: anytype,
+    ) !Polyline
+    {
+        const content_hash = std.hash.Wyhash.hash(0, content);
+        const zoom = viewport.zoom_level();
+
+        const slot = try self.entries.getOrPut(self.allocator, identity);
+        if (slot.found_existing)
+        {
+            const entry = slot.value_ptr.*;
+            if (
+                entry.content_hash == content_hash
+                and std.meta.eql(entry.zoom, zoom)
+            )
+            {
+                self.hits += 1;
+                return .{ .xv = entry.xv, .yv = entry.yv };
+            }
+
+            self.free_entry(entry);
+        }
+        self.misses += 1;
+
+        var builder = Builder{
+            .xv = std.ArrayList(f64).init(self.allocator),
+            .yv = std.ArrayList(f64).init(self.allocator),
+            .px_per_x = zoom.px_per_x(),
+            .px_per_y = zoom.px_per_y(),
+            .options = self.options,
+        };
+        errdefer {
+            builder.xv.deinit();
+            builder.yv.deinit();
+            _ = self.entries.remove(identity);
+        }
+
+        try build_fn(&builder, crv);
+
+        const xv = try builder.xv.toOwnedSlice();
+        errdefer self.allocator.free(xv);
+        const yv = try builder.yv.toOwnedSlice();
+
+        slot.value_ptr.* = .{
+            .content_hash = content_hash,
+            .zoom = zoom,
+            .xv = xv,
+            .yv = yv,
+        };
+
+        return .{ .xv = slot.value_ptr.xv, .yv = slot.value_ptr.yv };
+    }
+};
+
+/// accumulates points in plot units, measuring error in pixels
+const Builder = struct {
+    xv: std.ArrayList(f64),
+    yv: std.ArrayList(f64),
+    px_per_x: f64,
+    px_per_y: f64,
+    options: Options,
+
+    fn append(
+        self: *@This(),
+        x: f64,
+        y: f64,
+    ) !void
+    {
+        try self.xv.append(x);
+        try self.yv.append(y);
+    }
+
+    /// distance in pixels from p to the segment a-b
+    fn pixel_error(
+        self: @This(),
+        a: [2]f64,
+        b: [2]f64,
+        p: [2]f64,
+    ) f64
+    {
+        const ax = a[0] * self.px_per_x;
+        const ay = a[1] * self.px_per_y;
+        const dx = b[0] * self.px_per_x - ax;
+        const dy = b[1] * self.px_per_y - ay;
+        const px = p[0] * self.px_per_x - ax;
+        const py = p[1] * self.px_per_y - ay;
+
+        const len_sq = dx * dx + dy * dy;
+        if (len_sq == 0) {
+            return @sqrt(px * px + py * py);
+        }
+
+        const t = std.math.clamp((px * dx + py * dy) / len_sq, 0, 1);
+        const ex = px - t * dx;
+        const ey = py - t * dy;
+        return @sqrt(ex * ex + ey * ey);
+    }
+};
+
+fn eval_segment(
+    seg: bezier_curve.Bezier.Segment,
+    u: f64,
+) [2]f64
+{
+    const p = seg.eval_at(u);
+    return .{ p.in.as(f64), p.out.as(f64) };
+}
+
+/// append points after `a` (exclusive) up to `b` (inclusive) on seg, until
+/// every chord is within tolerance
+fn subdivide(
+    builder: *Builder,
+    seg: bezier_curve.Bezier.Segment,
+    u_a: f64,
+    a: [2]f64,
+    u_b: f64,
+    b: [2]f64,
+    depth: u8,
+) !void
+{
+    const u_mid = (u_a + u_b) / 2;
+    const mid = eval_segment(seg, u_mid);
+
+    // always split the first two levels, a single midpoint test can miss an
+    // s-shaped segment
+    if (
+        depth < builder.options.max_depth
+        and (
+            depth < 2
+            or builder.pixel_error(a, b, mid) > builder.options.tolerance_px
+        )
+    )
+    {
+        try subdivide(builder, seg, u_a, a, u_mid, mid, depth + 1);
+        try subdivide(builder, seg, u_mid, mid, u_b, b, depth + 1);
+        return;
+    }
+
+    try builder.append(b[0], b[1]);
+}
+
+fn build_bezier(
+    builder: *Builder,
+    crv: bezier_curve.Bezier,
+) !void
+{
+    if (crv.segments.len == 0) {
+        return;
+    }
+
+    const first = eval_segment(crv.segments[0], 0);
+    try builder.append(first[0], first[1]);
+
+    for (crv.segments)
+        |seg|
+    {
+        try subdivide(
+            builder,
+            seg,
+            0,
+            .{ seg.p0.in.as(f64), seg.p0.out.as(f64) },
+            1,
+            .{ seg.p3.in.as(f64), seg.p3.out.as(f64) },
+            0,
+        );
+    }
+}
+
+/// min/max decimation: per pixel column keep the first, lowest, highest and
+/// last knot, in input order
+fn build_linear(
+    builder: *Builder,
+    knots: []const control_point.ControlPoint,
+) !void
+{
+    if (knots.len == 0) {
+        return;
+    }
+
+    const Column = struct {
+        index: f64,
+        first: usize,
+        min: usize,
+        max: usize,
+        last: usize,
+    };
+
+    var maybe_column: ?Column = null;
+
+    for (knots, 0..)
+        |k, ind|
+    {
+        const column_index = @floor(k.in.as(f64) * builder.px_per_x);
+        const y = k.out.as(f64);
+
+        if (maybe_column)
+            |*column|
+        {
+            if (column.index == column_index)
+            {
+                if (y < knots[column.min].out.as(f64)) {
+                    column.min = ind;
+                }
+                if (y > knots[column.max].out.as(f64)) {
+                    column.max = ind;
+                }
+                column.last = ind;
+                continue;
+            }
+
+            try flush_column(builder, knots, column.*);
+        }
+
+        maybe_column = .{
+            .index = column_index,
+            .first = ind,
+            .min = ind,
+            .max = ind,
+            .last = ind,
+        };
+    }
+
+    try flush_column(builder, knots, maybe_column.?);
+}
+
+fn flush_column(
+    builder: *Builder,
+    knots: []const control_point.ControlPoint,
+    column: anytype,
+) !void
+{
+    var indices = [_]usize{
+        column.first,
+        @min(column.min, column.max),
+        @max(column.min, column.max),
+        column.last,
+    };
+
+    var last_written: ?usize = null;
+    for (&indices)
+        |ind|
+    {
+        if (last_written != null and last_written.? == ind) {
+            continue;
+        }
+        try builder.append(knots[ind].in.as(f64), knots[ind].out.as(f64));
+        last_written = ind;
+    }
+}
+
+const TEST_VIEWPORT = Viewport{
+    .x_min = 0,
+    .x_max = 10,
+    .y_min = 0,
+    .y_max = 10,
+    .width_px = 1000,
+    .height_px = 1000,
+};
+
+test "PolylineCache: bezier is adaptive, cached and accurate"
+{
+    const allocator = std.testing.allocator;
+
+    var segments = [_]bezier_curve.Bezier.Segment{
+        bezier_curve.Bezier.Segment.init_f32(
+            .{
+                .p0 = .{ .in = 0, .out = 0 },
+                .p1 = .{ .in = 1, .out = 10 },
+                .p2 = .{ .in = 9, .out = 0 },
+                .p3 = .{ .in = 10, .out = 10 },
+            }
+        ),
+    };
+    const crv = bezier_curve.Bezier{ .segments = &segments };
+
+    var cache = PolylineCache.init(allocator);
+    defer cache.deinit();
+
+    const id = @intFromPtr(&segments);
+
+    const fst = try cache.bezier(id, crv, TEST_VIEWPORT);
+    try std.testing.expectEqual(1, cache.misses);
+    try std.testing.expect(fst.xv.len > 4);
+
+    // end points are exact
+    try std.testing.expectEqual(0, fst.xv[0]);
+    try std.testing.expectEqual(10, fst.xv[fst.xv.len - 1]);
+    try std.testing.expectEqual(10, fst.yv[fst.yv.len - 1]);
+
+    // same curve, panned viewport: cached
+    var panned = TEST_VIEWPORT;
+    panned.x_min += 3;
+    panned.x_max += 3;
+    const snd = try cache.bezier(id, crv, panned);
+    try std.testing.expectEqual(1, cache.hits);
+    try std.testing.expectEqual(fst.xv.ptr, snd.xv.ptr);
+
+    // zooming in 4x needs more points
+    var zoomed = TEST_VIEWPORT;
+    zoomed.x_max = 2.5;
+    zoomed.y_max = 2.5;
+    const thd = try cache.bezier(id, crv, zoomed);
+    try std.testing.expectEqual(2, cache.misses);
+    try std.testing.expect(thd.xv.len > fst.xv.len);
+
+    // editing the curve invalidates it
+    segments[0].p1.out = opentime.Ordinate.init(5);
+    _ = try cache.bezier(id, crv, zoomed);
+    try std.testing.expectEqual(3, cache.misses);
+}
+
+test "PolylineCache: linear curves are min/max decimated"
+{
+    const allocator = std.testing.allocator;
+
+    // 100000 knots of a sawtooth over [0, 10), 10000 per unit.  At 128 px
+    // per unit that is ~78 knots per pixel column.
+    const knots = try allocator.alloc(
+        control_point.ControlPoint,
+        100000,
+    );
+    defer allocator.free(knots);
+
+    for (knots, 0..)
+        |*k, ind|
+    {
+        k.* = control_point.ControlPoint.init(
+            .{
+                .in = @as(f64, @floatFromInt(ind)) / 10000.0,
+                .out = @as(f64, @floatFromInt(ind % 7)),
+            }
+        );
+    }
+
+    var cache = PolylineCache.init(allocator);
+    defer cache.deinit();
+
+    const line = try cache.linear(@intFromPtr(knots.ptr), knots, TEST_VIEWPORT);
+
+    // at most 4 points per column, and much less than the input
+    try std.testing.expect(line.xv.len <= 4 * 128 * 10);
+    try std.testing.expect(line.xv.len < knots.len / 10);
+
+    // the extremes of the sawtooth survive
+    try std.testing.expectEqual(0, std.mem.min(f64, line.yv));
+    try std.testing.expectEqual(6, std.mem.max(f64, line.yv));
+
+    // first and last knot are kept
+    try std.testing.expectEqual(knots[0].in.as(f64), line.xv[0]);
+    try std.testing.expectEqual(
+        knots[knots.len - 1].in.as(f64),
+        line.xv[line.xv.len - 1],
+    );
+}
@@ -8,6 +8,9 @@ pub const ProjectionOperator = core.ProjectionOperator;
 pub const ProjectionOperatorMap = core.ProjectionOperatorMap;
 pub const SpaceLabel = core.SpaceLabel;
 pub const projection_map_to_media_from = core.projection_map_to_media_from;
+pub const projection_map_to_media_from_pooled = (
+    core.projection_map_to_media_from_pooled
+);
 
 pub const topological_map = @import("opentimelineio/topological_map.zig");
 pub const build_topological_map = topological_map.build_topological_map;
@@ -21,9 +24,32 @@ pub const Track = schema.Track;
 pub const Stack = schema.Stack;
 pub const Timeline = schema.Timeline;
 
+pub const timeline_generator = @import("opentimelineio/timeline_generator.zig");
+
+pub const summary_pyramid = @import("opentimelineio/summary_pyramid.zig");
+pub const SummaryPyramid = summary_pyramid.SummaryPyramid;
+
+pub const frame_grid = @import("opentimelineio/frame_grid.zig");
+pub const FrameGrid = frame_grid.FrameGrid;
+
+pub const evaluation_program = @import("opentimelineio/evaluation_program.zig");
+pub const EvaluationProgram = evaluation_program.EvaluationProgram;
+
+pub const shared_operator_map = @import("opentimelineio/shared_operator_map.zig");
+pub const SharedOperatorMap = shared_operator_map.SharedOperatorMap;
+
+pub const paged_operator_map = @import("opentimelineio/paged_operator_map.zig");
+pub const PagedOperatorMap = paged_operator_map.PagedOperatorMap;
+
+pub const timeline_diff = @import("opentimelineio/timeline_diff.zig");
+
 const otio_json = @import("opentimelineio_json.zig");
 
 pub const read_from_file = otio_json.read_from_file;
+pub const write_to_file = otio_json.write_to_file;
+
+pub const batch = @import("opentimelineio_batch.zig");
+pub const server = @import("opentimelineio_server.zig");
 
 test {
     const otio_highlevel_tests = @import(
@@ -32,4 +58,13 @@ test {
 
     _ = otio_json;
     _ = otio_highlevel_tests;
+    _ = timeline_generator;
+    _ = summary_pyramid;
+    _ = frame_grid;
+    _ = evaluation_program;
+    _ = shared_operator_map;
+    _ = paged_operator_map;
+    _ = timeline_diff;
+    _ = batch;
+    _ = server;
 }
@@ -0,0 +1,543 @@
+//! Flat instruction stream compiled from a ProjectionOperatorMap.
+//!
+//! Asking a ProjectionOperatorMap what is visible at a presentation time walks
+//! the segments, then each operator's Topology, then the Mapping union of
+//! every mapping, then the curve, following a pointer at every level.  An
+//! EvaluationProgram lowers the same map into a few contiguous arrays:
+//!
+//!     end_points       segment boundaries, binary searched
+//!     segment_starts   first instruction of each segment
+//!     instructions     per operator one .operator header followed by one
+//!                      instruction per mapping, in the order of the topology
+//!     knots            the knots of every .linear instruction, back to back
+//!     destinations     the distinct destination spaces ("media ids")
+//!
+//! The interpreter projects exactly like ProjectionOperator.
+//! project_instantaneous_cc, so results can be compared against the map.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+
+const core = @import("core.zig");
+
+pub const OpCode = enum(u8) {
+    /// start of an operator.  bounds holds the input bounds of its topology,
+    /// len the number of instructions that follow and index its destination
+    operator,
+    /// affine mapping over bounds
+    affine,
+    /// linear curve mapping over bounds, knots[index..index + len]
+    linear,
+    /// empty mapping over bounds, projects nothing
+    empty,
+    /// the operator's topology is an instant, bounds holds its output bounds
+    instant,
+};
+
+pub const Instruction = struct {
+    op: OpCode,
+    /// see OpCode
+    len: u32 = 0,
+    /// see OpCode
+    index: u32 = 0,
+    bounds: opentime.ContinuousInterval = opentime.ContinuousInterval.ZERO,
+    /// only used by .affine
+    xform: opentime.AffineTransform1D = .{},
+};
+
+/// one result of an evaluation, one per operator in the segment
+pub const Sample = struct {
+    /// index into EvaluationProgram.destinations
+    destination: u32,
+    result: opentime.ProjectionResult,
+};
+
+/// append the instructions of op to instructions: an .operator header
+/// that projects to destination, then one instruction per mapping.  The
+/// knots of .linear mappings are appended to knots.
+pub fn lower_operator(
+    op: core.ProjectionOperator,
+    destination: u32,
+    instructions: *std.ArrayList(Instruction),
+    knots: *std.ArrayList(curve.ControlPoint),
+) !void
+{
+    const topo = op.src_to_dst_topo;
+    const input_bounds = topo.input_bounds();
+
+    const header = instructions.items.len;
+    try instructions.append(
+        .{
+            .op = .operator,
+            .index = destination,
+            .bounds = input_bounds,
+        }
+    );
+
+    if (input_bounds.is_instant())
+    {
+        try instructions.append(
+            .{
+                .op = .instant,
+                .bounds = topo.output_bounds(),
+            }
+        );
+    }
+    else
+    {
+        for (topo.mappings)
+            |m|
+        {
+            try instructions.append(
+                switch (m) {
+                    .empty => |e| .{
+                        .op = .empty,
+                        .bounds = e.defined_range,
+                    },
+                    .affine => |aff| .{
+                        .op = .affine,
+                        .bounds = aff.input_bounds_val,
+                        .xform = aff.input_to_output_xform,
+                    },
+                    .linear => |lin| .{
+                        .op = .linear,
+                        .len = @intCast(
+                            lin.input_to_output_curve.knots.len
+                        ),
+                        .index = @intCast(knots.items.len),
+                        .bounds = m.input_bounds(),
+                    },
+                }
+            );
+
+            if (m == .linear)
+            {
+                try knots.appendSlice(
+                    m.linear.input_to_output_curve.knots
+                );
+            }
+        }
+    }
+
+    instructions.items[header].len = @intCast(
+        instructions.items.len - header - 1
+    );
+}
+
+/// A ProjectionOperatorMap lowered to an instruction stream.  Does not
+/// reference the map, but the destinations reference the same objects.
+pub const EvaluationProgram = struct {
+    allocator: std.mem.Allocator,
+    end_points: []const opentime.Ordinate = &.{},
+    /// segment i is instructions[segment_starts[i]..segment_starts[i+1]]
+    segment_starts: []const u32 = &.{},
+    instructions: []const Instruction = &.{},
+    knots: []const curve.ControlPoint = &.{},
+    destinations: []const core.SpaceReference = &.{},
+
+    pub fn compile(
+        allocator: std.mem.Allocator,
+        po_map: core.ProjectionOperatorMap,
+    ) !EvaluationProgram
+    {
+        if (po_map.is_empty()) {
+            return .{ .allocator = allocator };
+        }
+
+        var instructions = std.ArrayList(Instruction).init(allocator);
+        defer instructions.deinit();
+
+        var knots = std.ArrayList(curve.ControlPoint).init(allocator);
+        defer knots.deinit();
+
+        var destinations = std.ArrayList(core.SpaceReference).init(
+            allocator
+        );
+        defer destinations.deinit();
+
+        var destination_ids = std.AutoHashMap(core.SpaceReference, u32).init(
+            allocator
+        );
+        defer destination_ids.deinit();
+
+        const segment_starts = try allocator.alloc(
+            u32,
+            po_map.operators.len + 1,
+        );
+        errdefer allocator.free(segment_starts);
+
+        for (po_map.operators, 0..)
+            |segment_ops, ind|
+        {
+            segment_starts[ind] = @intCast(instructions.items.len);
+
+            for (segment_ops)
+                |op|
+            {
+                const entry = try destination_ids.getOrPut(op.destination);
+                if (!entry.found_existing)
+                {
+                    entry.value_ptr.* = @intCast(destinations.items.len);
+                    try destinations.append(op.destination);
+                }
+
+                try lower_operator(
+                    op,
+                    entry.value_ptr.*,
+                    &instructions,
+                    &knots,
+                );
+            }
+        }
+        segment_starts[po_map.operators.len] = @intCast(
+            instructions.items.len
+        );
+
+        const end_points = try allocator.dupe(
+            opentime.Ordinate,
+            po_map.end_points,
+        );
+        errdefer allocator.free(end_points);
+
+        const owned_instructions = try instructions.toOwnedSlice();
+        errdefer allocator.free(owned_instructions);
+
+        const owned_knots = try knots.toOwnedSlice();
+        errdefer allocator.free(owned_knots);
+
+        return .{
+            .allocator = allocator,
+            .end_points = end_points,
+            .segment_starts = segment_starts,
+            .instructions = owned_instructions,
+            .knots = owned_knots,
+            .destinations = try destinations.toOwnedSlice(),
+        };
+    }
+
+    pub fn deinit(
+        self: @This(),
+    ) void
+    {
+        self.allocator.free(self.end_points);
+        self.allocator.free(self.segment_starts);
+        self.allocator.free(self.instructions);
+        self.allocator.free(self.knots);
+        self.allocator.free(self.destinations);
+    }
+
+    /// the pointer free tables of the program, enough to evaluate it
+    pub fn code(
+        self: @This(),
+    ) Code
+    {
+        return .{
+            .end_points = self.end_points,
+            .segment_starts = self.segment_starts,
+            .instructions = self.instructions,
+            .knots = self.knots,
+        };
+    }
+
+    /// see Code.segment_count
+    pub fn segment_count(
+        self: @This(),
+    ) usize
+    {
+        return self.code().segment_count();
+    }
+
+    /// see Code.segment_at
+    pub fn segment_at(
+        self: @This(),
+        ord: opentime.Ordinate,
+    ) ?usize
+    {
+        return self.code().segment_at(ord);
+    }
+
+    /// see Code.evaluate_into
+    pub fn evaluate_into(
+        self: @This(),
+        ord: opentime.Ordinate,
+        result: []Sample,
+    ) usize
+    {
+        return self.code().evaluate_into(ord, result);
+    }
+
+    /// see Code.evaluate_batch
+    pub fn evaluate_batch(
+        self: @This(),
+        ords: []const opentime.Ordinate,
+        result: []Sample,
+        offsets: []usize,
+    ) error{NoSpaceLeft}!void
+    {
+        return self.code().evaluate_batch(ords, result, offsets);
+    }
+};
+
+/// The tables of an EvaluationProgram without its destinations.  Holds no
+/// pointers other than its slices, so it can also be laid over memory
+/// shared between processes, see shared_operator_map.
+pub const Code = struct {
+    end_points: []const opentime.Ordinate = &.{},
+    /// segment i is instructions[segment_starts[i]..segment_starts[i+1]]
+    segment_starts: []const u32 = &.{},
+    instructions: []const Instruction = &.{},
+    knots: []const curve.ControlPoint = &.{},
+
+    /// number of segments in the compiled map
+    pub fn segment_count(
+        self: @This(),
+    ) usize
+    {
+        return self.end_points.len -| 1;
+    }
+
+    /// index of the segment containing ord, the last segment includes its
+    /// end point.  null for ordinates outside of the program or not finite.
+    pub fn segment_at(
+        self: @This(),
+        ord: opentime.Ordinate,
+    ) ?usize
+    {
+        const n = self.segment_count();
+        if (
+            n == 0
+            or !std.math.isFinite(ord.as(opentime.Ordinate.BaseType))
+            or ord.lt(self.end_points[0])
+            or self.end_points[n].lt(ord)
+        )
+        {
+            return null;
+        }
+
+        // first end point > ord
+        var lo: usize = 0;
+        var hi: usize = n + 1;
+        while (lo < hi)
+        {
+            const mid = lo + (hi - lo) / 2;
+            if (self.end_points[mid].lteq(ord)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        return @min(lo - 1, n - 1);
+    }
+
+    /// write one Sample per operator visible at ord into result.  Returns
+    /// how many there are, which is larger than result.len if it was too
+    /// short.  Does not allocate.
+    pub fn evaluate_into(
+        self: @This(),
+        ord: opentime.Ordinate,
+        result: []Sample,
+    ) usize
+    {
+        const segment = self.segment_at(ord) orelse return 0;
+
+        var pc: usize = self.segment_starts[segment];
+        const segment_end = self.segment_starts[segment + 1];
+
+        var count: usize = 0;
+        while (pc < segment_end)
+        {
+            const header = self.instructions[pc];
+            const body = self.instructions[pc + 1..pc + 1 + header.len];
+            pc += 1 + header.len;
+
+            if (count < result.len)
+            {
+                result[count] = .{
+                    .destination = header.index,
+                    .result = self.run_operator(header, body, ord),
+                };
+            }
+            count += 1;
+        }
+
+        return count;
+    }
+
+    /// evaluate every ordinate in ords into result.  The samples of ords[i]
+    /// are written to result[offsets[i]..offsets[i+1]], so offsets must be
+    /// one longer than ords.  Returns error.NoSpaceLeft if result is too
+    /// short.  Does not allocate.
+    pub fn evaluate_batch(
+        self: @This(),
+        ords: []const opentime.Ordinate,
+        result: []Sample,
+        offsets: []usize,
+    ) error{NoSpaceLeft}!void
+    {
+        std.debug.assert(offsets.len == ords.len + 1);
+
+        var written: usize = 0;
+        for (ords, 0..)
+            |ord, ind|
+        {
+            offsets[ind] = written;
+
+            written += self.evaluate_into(ord, result[written..]);
+            if (written > result.len) {
+                return error.NoSpaceLeft;
+            }
+        }
+        offsets[ords.len] = written;
+    }
+
+    /// same as Topology.project_instantaneous_cc over the mappings in body
+    fn run_operator(
+        self: @This(),
+        header: Instruction,
+        body: []const Instruction,
+        ord: opentime.Ordinate,
+    ) opentime.ProjectionResult
+    {
+        if (header.bounds.is_instant())
+        {
+            if (header.bounds.start.eql(ord)) {
+                return .{ .SuccessInterval = body[0].bounds };
+            }
+            return opentime.OUTOFBOUNDS;
+        }
+
+        for (body)
+            |ins|
+        {
+            if (!ins.bounds.overlaps(ord)) {
+                continue;
+            }
+
+            return switch (ins.op) {
+                .affine => .{
+                    .SuccessOrdinate = ins.xform.applied_to_ordinate(ord),
+                },
+                .linear => (
+                    curve.Linear.Monotonic{
+                        .knots = self.knots[ins.index..ins.index + ins.len],
+                    }
+                ).output_at_input(ord),
+                .empty => opentime.OUTOFBOUNDS,
+                .operator, .instant => unreachable,
+            };
+        }
+
+        return opentime.OUTOFBOUNDS;
+    }
+};
+
+test "EvaluationProgram: matches the ProjectionOperatorMap"
+{
+    const allocator = std.testing.allocator;
+
+    const timeline_generator = @import("timeline_generator.zig");
+    const topological_map_m = @import("topological_map.zig");
+
+    const gen = try timeline_generator.generate(
+        allocator,
+        .{
+            .track_count = 2,
+            .clips_per_track = 32,
+            .gap_ratio = 0.25,
+            .warp_density = 0.5,
+            .seed = 93,
+        },
+    );
+    defer gen.deinit();
+
+    const map = try topological_map_m.build_topological_map(
+        allocator,
+        gen.ref(),
+    );
+    defer map.deinit();
+
+    const po_map = try core.projection_map_to_media_from(
+        allocator,
+        map,
+        try gen.ref().space(.presentation),
+    );
+    defer po_map.deinit();
+
+    const program = try EvaluationProgram.compile(allocator, po_map);
+    defer program.deinit();
+
+    try std.testing.expectEqual(po_map.operators.len, program.segment_count());
+
+    var samples: [16]Sample = undefined;
+
+    // the middle of every segment
+    for (po_map.operators, 0..)
+        |segment_ops, ind|
+    {
+        const ord = program.end_points[ind].add(
+            program.end_points[ind + 1]
+        ).div(2);
+
+        const count = program.evaluate_into(ord, &samples);
+        try std.testing.expectEqual(segment_ops.len, count);
+
+        for (segment_ops, samples[0..count])
+            |op, sample|
+        {
+            try std.testing.expectEqual(
+                op.destination,
+                program.destinations[sample.destination],
+            );
+            try std.testing.expectEqual(
+                op.project_instantaneous_cc(ord),
+                sample.result,
+            );
+        }
+    }
+
+    // outside of the map
+    try std.testing.expectEqual(
+        0,
+        program.evaluate_into(
+            program.end_points[0].sub(1),
+            &samples,
+        ),
+    );
+    try std.testing.expectEqual(
+        null,
+        program.segment_at(opentime.Ordinate.init(std.math.nan(f64))),
+    );
+    try std.testing.expectEqual(
+        null,
+        program.segment_at(opentime.Ordinate.init(std.math.inf(f64))),
+    );
+
+    // batched
+    const ords = [_]opentime.Ordinate{
+        program.end_points[0],
+        program.end_points[1],
+        program.end_points[program.end_points.len - 1].add(1),
+    };
+    var batch: [64]Sample = undefined;
+    var offsets: [ords.len + 1]usize = undefined;
+    try program.evaluate_batch(&ords, &batch, &offsets);
+
+    for (ords, 0..)
+        |ord, ind|
+    {
+        try std.testing.expectEqual(
+            program.evaluate_into(ord, &samples),
+            offsets[ind + 1] - offsets[ind],
+        );
+    }
+
+    const total = offsets[ords.len];
+    try std.testing.expect(total > 0);
+    try std.testing.expectError(
+        error.NoSpaceLeft,
+        program.evaluate_batch(&ords, batch[0..total - 1], &offsets),
+    );
+}
@@ -0,0 +1,338 @@
+//! Frame grid lookup tables compiled from a ProjectionOperator.
+//!
+//! Conforming between fixed rates (24 -> 25, 23.976 -> 24) asks the same
+//! operator for the destination frame of every source frame over and over.
+//! FrameGrid evaluates that once over a range of source frames and answers
+//! later lookups with an array read.  When the destination indices repeat
+//! with a fixed stride, as they do for any affine mapping between rational
+//! rates, only one period of the pattern is stored.  Piecewise linear warps
+//! are tabulated too, since the table only holds exact evaluations of the
+//! operator.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+const topology_m = @import("topology");
+const sampling = @import("sampling");
+
+const schema = @import("schema.zig");
+const core = @import("core.zig");
+
+/// longest pattern searched for, enough for the 1000/1001 NTSC ratios
+pub const MAX_PERIOD = 1001;
+
+/// destination discrete index for each frame of the source discrete space of
+/// a ProjectionOperator over a range of source frames
+pub const FrameGrid = struct {
+    /// borrowed, used for frames outside of the table
+    operator: core.ProjectionOperator,
+    /// first source index covered by the table
+    start_index: sampling.sample_index_t,
+    /// number of source indices covered by the table
+    count: usize,
+    table: Table,
+
+    pub const Table = union (enum) {
+        /// one destination index per covered source index
+        lut: []const sampling.sample_index_t,
+        /// the destination index of start_index + k * pattern.len + r is
+        /// pattern[r] + k * stride
+        periodic: struct {
+            pattern: []const sampling.sample_index_t,
+            stride: sampling.sample_index_t,
+        },
+    };
+
+    /// evaluate operator for count source frames starting at start_index.
+    /// The frames must be inside the bounds of the operator.
+    pub fn compile(
+        allocator: std.mem.Allocator,
+        operator: core.ProjectionOperator,
+        source_frames: struct {
+            start_index: sampling.sample_index_t,
+            count: usize,
+        },
+    ) !FrameGrid
+    {
+        var result = FrameGrid{
+            .operator = operator,
+            .start_index = source_frames.start_index,
+            .count = source_frames.count,
+            .table = .{ .lut = &.{} },
+        };
+
+        const lut = try allocator.alloc(
+            sampling.sample_index_t,
+            source_frames.count,
+        );
+        errdefer allocator.free(lut);
+
+        for (lut, source_frames.start_index..)
+            |*dst, src|
+        {
+            dst.* = try evaluate(operator, src);
+        }
+
+        if (find_period(lut))
+            |period|
+        {
+            defer allocator.free(lut);
+
+            result.table = .{
+                .periodic = .{
+                    .pattern = try allocator.dupe(
+                        sampling.sample_index_t,
+                        lut[0..period],
+                    ),
+                    .stride = lut[period] - lut[0],
+                },
+            };
+            return result;
+        }
+
+        result.table = .{ .lut = lut };
+        return result;
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        switch (self.table) {
+            .lut => |lut| allocator.free(lut),
+            .periodic => |p| allocator.free(p.pattern),
+        }
+    }
+
+    /// the destination index of the source frame at source_index
+    pub fn destination_index(
+        self: @This(),
+        source_index: sampling.sample_index_t,
+    ) !sampling.sample_index_t
+    {
+        if (
+            source_index < self.start_index
+            or source_index - self.start_index >= self.count
+        )
+        {
+            return try evaluate(self.operator, source_index);
+        }
+
+        const rel = source_index - self.start_index;
+
+        return switch (self.table) {
+            .lut => |lut| lut[rel],
+            .periodic => |p| (
+                p.pattern[rel % p.pattern.len]
+                + (rel / p.pattern.len) * p.stride
+            ),
+        };
+    }
+
+    /// write the destination indices of the source frames starting at
+    /// source_start into result
+    pub fn destination_indices_into(
+        self: @This(),
+        source_start: sampling.sample_index_t,
+        result: []sampling.sample_index_t,
+    ) !void
+    {
+        for (result, source_start..)
+            |*dst, src|
+        {
+            dst.* = try self.destination_index(src);
+        }
+    }
+};
+
+/// destination index of the start of the source frame at source_index,
+/// without a table
+pub fn evaluate(
+    operator: core.ProjectionOperator,
+    source_index: sampling.sample_index_t,
+) !sampling.sample_index_t
+{
+    const source_range = (
+        try operator.source.ref.discrete_index_to_continuous_range(
+            source_index,
+            operator.source.label,
+        )
+    );
+
+    return try operator.project_instantaneous_cd(source_range.start);
+}
+
+/// the shortest period p (up to MAX_PERIOD) with which indices repeat with a
+/// constant, non negative stride, if the indices cover at least two periods
+fn find_period(
+    indices: []const sampling.sample_index_t,
+) ?usize
+{
+    const max_period = @min(MAX_PERIOD, indices.len / 2);
+
+    var period: usize = 1;
+    candidates: while (period <= max_period)
+        : (period += 1)
+    {
+        if (indices[period] < indices[0]) {
+            continue;
+        }
+
+        const stride = indices[period] - indices[0];
+        for (indices[period..], indices[0..indices.len - period])
+            |later, earlier|
+        {
+            if (later != earlier + stride) {
+                continue :candidates;
+            }
+        }
+
+        return period;
+    }
+
+    return null;
+}
+
+test "FrameGrid: find_period"
+{
+    // 24 -> 25, every 24 frames one destination frame is skipped
+    var conform: [96]sampling.sample_index_t = undefined;
+    for (&conform, 0..)
+        |*dst, src|
+    {
+        dst.* = (src * 25) / 24;
+    }
+    try std.testing.expectEqual(24, find_period(&conform));
+
+    try std.testing.expectEqual(
+        null,
+        find_period(&.{ 0, 1, 3, 4, 9, 11 }),
+    );
+}
+
+test "FrameGrid: 24 to 25 conform matches the operator"
+{
+    const allocator = std.testing.allocator;
+
+    var tl = try schema.Timeline.init(allocator);
+    defer tl.recursively_deinit();
+    tl.discrete_info.presentation = .{
+        .sample_rate_hz = .{ .Int = 24 },
+    };
+    const cl = schema.Clip{
+        .media = .{
+            .bounds_s = opentime.ContinuousInterval.init(
+                .{ .start = 0, .end = 20 },
+            ),
+            .discrete_info = .{
+                .sample_rate_hz = .{ .Int = 25 },
+            },
+        },
+    };
+
+    const operator = core.ProjectionOperator{
+        .source = try core.ComposedValueRef.init(&tl).space(.presentation),
+        .destination = try core.ComposedValueRef.init(&cl).space(.media),
+        .src_to_dst_topo = try topology_m.Topology.init_identity(
+            allocator,
+            opentime.ContinuousInterval.init(.{ .start = 0, .end = 20 }),
+        ),
+    };
+    defer operator.deinit(allocator);
+
+    const grid = try FrameGrid.compile(
+        allocator,
+        operator,
+        .{ .start_index = 0, .count = 240 },
+    );
+    defer grid.deinit(allocator);
+
+    try std.testing.expectEqual(.periodic, std.meta.activeTag(grid.table));
+
+    var compiled: [300]sampling.sample_index_t = undefined;
+    try grid.destination_indices_into(100, &compiled);
+
+    for (compiled, 100..)
+        |dst, src|
+    {
+        try std.testing.expectEqual(try evaluate(operator, src), dst);
+    }
+
+    // and with the operator's own discrete projection
+    for ([_]sampling.sample_index_t{ 0, 23, 24, 101, 239 })
+        |src|
+    {
+        const dd = try operator.project_index_dd(allocator, src);
+        defer allocator.free(dd);
+
+        try std.testing.expect(
+            std.mem.indexOfScalar(
+                sampling.sample_index_t,
+                dd,
+                try grid.destination_index(src),
+            ) != null
+        );
+    }
+}
+
+test "FrameGrid: piecewise linear warps are tabulated"
+{
+    const allocator = std.testing.allocator;
+
+    var tl = try schema.Timeline.init(allocator);
+    defer tl.recursively_deinit();
+    tl.discrete_info.presentation = .{
+        .sample_rate_hz = .{ .Int = 24 },
+    };
+    const cl = schema.Clip{
+        .media = .{
+            .discrete_info = .{
+                .sample_rate_hz = .{ .Int = 24 },
+            },
+        },
+    };
+
+    const operator = core.ProjectionOperator{
+        .source = try core.ComposedValueRef.init(&tl).space(.presentation),
+        .destination = try core.ComposedValueRef.init(&cl).space(.media),
+        .src_to_dst_topo = try topology_m.Topology.init_from_linear_monotonic(
+            allocator,
+            .{
+                .knots = &.{
+                    curve.ControlPoint.init(.{ .in = 0, .out = 0 }),
+                    curve.ControlPoint.init(.{ .in = 10, .out = 5 }),
+                    curve.ControlPoint.init(.{ .in = 20, .out = 20 }),
+                },
+            },
+        ),
+    };
+    defer operator.deinit(allocator);
+
+    const grid = try FrameGrid.compile(
+        allocator,
+        operator,
+        .{ .start_index = 0, .count = 240 },
+    );
+    defer grid.deinit(allocator);
+
+    try std.testing.expect(grid.table == .lut);
+
+    // every frame agrees with projecting the start of the frame
+    for (0..240)
+        |src|
+    {
+        const frame_start = opentime.Ordinate.init(src).div(24);
+        try std.testing.expectEqual(
+            try operator.project_instantaneous_cd(frame_start),
+            try grid.destination_index(src),
+        );
+    }
+
+    // outside of the table
+    try std.testing.expectEqual(
+        try evaluate(operator, 300),
+        try grid.destination_index(300),
+    );
+}
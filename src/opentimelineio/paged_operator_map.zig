@@ -0,0 +1,988 @@
+//! Out of core ProjectionOperatorMap, paged through a file.
+//!
+//! The segments of a map are lowered like an EvaluationProgram and grouped
+//! into pages of `segments_per_page` segments.  Each page is a self
+//! contained, pointer free evaluation_program.Code:
+//!
+//!     PageHeader       segment, instruction and knot counts
+//!     end_points       []Ordinate, segment_count + 1
+//!     segment_starts   []u32, segment_count + 1
+//!     instructions     []Instruction, .linear indices are local to the page
+//!     knots            []ControlPoint
+//!
+//! The file is the Header, the pages back to back, the page index and the
+//! destination names.  Only the Header and the page index (one PageEntry per
+//! page) stay resident.  Pages are read on demand into a fixed number of
+//! page buffers recycled in least recently used order, so the memory of a
+//! reader is bounded by `cache_pages * max_page_bytes` rather than by the
+//! length of the timeline.  Sweeps stream the pages of a range in order
+//! through a buffer of their own, without disturbing the cache.
+//!
+//! Writing takes one segment at a time and only holds the current page, the
+//! page index and the destination names.
+//!
+//! Like shared_operator_map the tables are stored in native layout and
+//! guarded by its LAYOUT hash.  Readers are not thread safe.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+
+const core = @import("core.zig");
+const evaluation_program = @import("evaluation_program.zig");
+const Instruction = evaluation_program.Instruction;
+const shared_operator_map = @import("shared_operator_map.zig");
+const Section = shared_operator_map.Section;
+const ALIGNMENT = shared_operator_map.ALIGNMENT;
+
+pub const MAGIC = "WRKLPGM1".*;
+
+pub const Header = extern struct {
+    magic: [8]u8 = MAGIC,
+    layout: u64 = shared_operator_map.LAYOUT,
+    page_count: u64 = 0,
+    segment_count: u64 = 0,
+    destination_count: u64 = 0,
+    /// largest page, in bytes
+    max_page_bytes: u64 = 0,
+    /// []PageEntry
+    index: Section = .{},
+    /// []u32, destination i is names[off[i]..off[i+1]]
+    name_offsets: Section = .{},
+    /// []u8
+    names: Section = .{},
+};
+
+/// where a page is and what it covers, resident for every page
+pub const PageEntry = extern struct {
+    start: opentime.Ordinate.BaseType,
+    end: opentime.Ordinate.BaseType,
+    offset: u64,
+    size: u64,
+    first_segment: u64,
+
+    pub fn range(
+        self: @This(),
+    ) opentime.ContinuousInterval
+    {
+        return .{
+            .start = opentime.Ordinate.init(self.start),
+            .end = opentime.Ordinate.init(self.end),
+        };
+    }
+};
+
+const PageHeader = extern struct {
+    segment_count: u32,
+    instruction_count: u32,
+    knot_count: u32,
+    reserved: u32 = 0,
+};
+
+/// byte offsets of the tables of a page with the counts of header
+const PageLayout = struct {
+    end_points: usize,
+    segment_starts: usize,
+    instructions: usize,
+    knots: usize,
+    size: usize,
+
+    fn init(
+        header: PageHeader,
+    ) PageLayout
+    {
+        // widened before multiplying, the counts can come from a damaged
+        // file
+        const segments: usize = header.segment_count;
+        const instructions: usize = header.instruction_count;
+        const knots: usize = header.knot_count;
+
+        var result: PageLayout = undefined;
+        var offset = std.mem.alignForward(
+            usize,
+            @sizeOf(PageHeader),
+            ALIGNMENT,
+        );
+
+        result.end_points = offset;
+        offset = std.mem.alignForward(
+            usize,
+            offset + (segments + 1) * @sizeOf(opentime.Ordinate),
+            ALIGNMENT,
+        );
+
+        result.segment_starts = offset;
+        offset = std.mem.alignForward(
+            usize,
+            offset + (segments + 1) * @sizeOf(u32),
+            ALIGNMENT,
+        );
+
+        result.instructions = offset;
+        offset = std.mem.alignForward(
+            usize,
+            offset + instructions * @sizeOf(Instruction),
+            ALIGNMENT,
+        );
+
+        result.knots = offset;
+        result.size = std.mem.alignForward(
+            usize,
+            offset + knots * @sizeOf(curve.ControlPoint),
+            ALIGNMENT,
+        );
+
+        return result;
+    }
+};
+
+fn table(
+    comptime T: type,
+    bytes: []align(ALIGNMENT) u8,
+    offset: usize,
+    len: usize,
+) []T
+{
+    const ptr: [*]T = @ptrCast(@alignCast(bytes.ptr + offset));
+    return ptr[0..len];
+}
+
+/// knobs for writing
+pub const WriteOptions = struct {
+    segments_per_page: usize = 256,
+};
+
+/// Writes a paged map to a file, one segment at a time.
+pub const Writer = struct {
+    allocator: std.mem.Allocator,
+    file: std.fs.File,
+    options: WriteOptions,
+    header: Header = .{},
+    /// bytes written so far
+    offset: u64 = 0,
+
+    // the current page
+    end_points: std.ArrayList(opentime.Ordinate),
+    segment_starts: std.ArrayList(u32),
+    instructions: std.ArrayList(Instruction),
+    knots: std.ArrayList(curve.ControlPoint),
+
+    index: std.ArrayList(PageEntry),
+    destination_ids: std.AutoHashMap(core.SpaceReference, u32),
+    name_offsets: std.ArrayList(u32),
+    names: std.ArrayList(u8),
+
+    /// create (or truncate) sub_path in dir
+    pub fn create(
+        allocator: std.mem.Allocator,
+        dir: std.fs.Dir,
+        sub_path: []const u8,
+        options: WriteOptions,
+    ) !Writer
+    {
+        std.debug.assert(options.segments_per_page > 0);
+
+        var name_offsets = std.ArrayList(u32).init(allocator);
+        errdefer name_offsets.deinit();
+        try name_offsets.append(0);
+
+        const file = try dir.createFile(sub_path, .{});
+        errdefer file.close();
+
+        // the header is written last, reserve its space
+        const header_size = std.mem.alignForward(
+            usize,
+            @sizeOf(Header),
+            ALIGNMENT,
+        );
+        try file.writer().writeByteNTimes(0, header_size);
+
+        return .{
+            .allocator = allocator,
+            .file = file,
+            .options = options,
+            .offset = header_size,
+            .end_points = std.ArrayList(opentime.Ordinate).init(allocator),
+            .segment_starts = std.ArrayList(u32).init(allocator),
+            .instructions = std.ArrayList(Instruction).init(allocator),
+            .knots = std.ArrayList(curve.ControlPoint).init(allocator),
+            .index = std.ArrayList(PageEntry).init(allocator),
+            .destination_ids = std.AutoHashMap(core.SpaceReference, u32).init(
+                allocator
+            ),
+            .name_offsets = name_offsets,
+            .names = std.ArrayList(u8).init(allocator),
+        };
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        self.end_points.deinit();
+        self.segment_starts.deinit();
+        self.instructions.deinit();
+        self.knots.deinit();
+        self.index.deinit();
+        self.destination_ids.deinit();
+        self.name_offsets.deinit();
+        self.names.deinit();
+        self.file.close();
+    }
+
+    /// add the segment [start, end) and its operators.  Segments must be
+    /// appended in order and meet, start is the end of the previous one.
+    pub fn append_segment(
+        self: *@This(),
+        start: opentime.Ordinate,
+        end: opentime.Ordinate,
+        operators: []const core.ProjectionOperator,
+    ) !void
+    {
+        if (self.end_points.items.len == 0) {
+            try self.end_points.append(start);
+        }
+        std.debug.assert(
+            self.end_points.items[self.end_points.items.len - 1].eql(start)
+        );
+
+        try self.segment_starts.append(
+            @intCast(self.instructions.items.len)
+        );
+
+        for (operators)
+            |op|
+        {
+            const entry = try self.destination_ids.getOrPut(op.destination);
+            if (!entry.found_existing)
+            {
+                entry.value_ptr.* = @intCast(self.destination_ids.count() - 1);
+
+                try self.names.appendSlice(op.destination.ref.name() orelse "");
+                try self.name_offsets.append(@intCast(self.names.items.len));
+            }
+
+            try evaluation_program.lower_operator(
+                op,
+                entry.value_ptr.*,
+                &self.instructions,
+                &self.knots,
+            );
+        }
+
+        try self.end_points.append(end);
+        self.header.segment_count += 1;
+
+        if (self.segment_starts.items.len >= self.options.segments_per_page) {
+            try self.flush_page();
+        }
+    }
+
+    /// write out the current page
+    fn flush_page(
+        self: *@This(),
+    ) !void
+    {
+        const segment_count = self.segment_starts.items.len;
+        if (segment_count == 0) {
+            return;
+        }
+        try self.segment_starts.append(
+            @intCast(self.instructions.items.len)
+        );
+
+        const page_header = PageHeader{
+            .segment_count = @intCast(segment_count),
+            .instruction_count = @intCast(self.instructions.items.len),
+            .knot_count = @intCast(self.knots.items.len),
+        };
+        const layout = PageLayout.init(page_header);
+
+        const bytes = try self.allocator.alignedAlloc(
+            u8,
+            ALIGNMENT,
+            layout.size,
+        );
+        defer self.allocator.free(bytes);
+        @memset(bytes, 0);
+
+        table(PageHeader, bytes, 0, 1)[0] = page_header;
+        @memcpy(
+            table(
+                opentime.Ordinate,
+                bytes,
+                layout.end_points,
+                segment_count + 1,
+            ),
+            self.end_points.items,
+        );
+        @memcpy(
+            table(u32, bytes, layout.segment_starts, segment_count + 1),
+            self.segment_starts.items,
+        );
+        @memcpy(
+            table(
+                Instruction,
+                bytes,
+                layout.instructions,
+                self.instructions.items.len,
+            ),
+            self.instructions.items,
+        );
+        @memcpy(
+            table(
+                curve.ControlPoint,
+                bytes,
+                layout.knots,
+                self.knots.items.len,
+            ),
+            self.knots.items,
+        );
+
+        try self.file.writeAll(bytes);
+
+        const first_segment = self.header.segment_count - segment_count;
+        try self.index.append(
+            .{
+                .start = self.end_points.items[0].as(opentime.Ordinate.BaseType),
+                .end = self.end_points.items[segment_count].as(
+                    opentime.Ordinate.BaseType
+                ),
+                .offset = self.offset,
+                .size = layout.size,
+                .first_segment = first_segment,
+            }
+        );
+        self.offset += layout.size;
+        self.header.max_page_bytes = @max(
+            self.header.max_page_bytes,
+            layout.size,
+        );
+
+        // the next page starts where this one ended
+        const last_end = self.end_points.items[segment_count];
+        self.end_points.clearRetainingCapacity();
+        try self.end_points.append(last_end);
+        self.segment_starts.clearRetainingCapacity();
+        self.instructions.clearRetainingCapacity();
+        self.knots.clearRetainingCapacity();
+    }
+
+    /// write a table after the pages and return its section
+    fn write_table(
+        self: *@This(),
+        comptime T: type,
+        items: []const T,
+    ) !Section
+    {
+        const section = Section{ .offset = self.offset, .len = items.len };
+
+        const bytes = std.mem.sliceAsBytes(items);
+        const padded = std.mem.alignForward(usize, bytes.len, ALIGNMENT);
+        try self.file.writeAll(bytes);
+        try self.file.writer().writeByteNTimes(0, padded - bytes.len);
+        self.offset += padded;
+
+        return section;
+    }
+
+    /// write the last page, the index, the names and the header.  The
+    /// writer still has to be deinit'd.
+    pub fn finish(
+        self: *@This(),
+    ) !void
+    {
+        try self.flush_page();
+
+        self.header.page_count = self.index.items.len;
+        self.header.destination_count = self.destination_ids.count();
+        self.header.index = try self.write_table(PageEntry, self.index.items);
+        self.header.name_offsets = try self.write_table(
+            u32,
+            self.name_offsets.items,
+        );
+        self.header.names = try self.write_table(u8, self.names.items);
+
+        try self.file.pwriteAll(std.mem.asBytes(&self.header), 0);
+    }
+};
+
+/// write po_map as a paged map to sub_path in dir
+pub fn write_map(
+    allocator: std.mem.Allocator,
+    po_map: core.ProjectionOperatorMap,
+    dir: std.fs.Dir,
+    sub_path: []const u8,
+    options: WriteOptions,
+) !void
+{
+    var writer = try Writer.create(allocator, dir, sub_path, options);
+    defer writer.deinit();
+
+    for (po_map.operators, 0..)
+        |segment_ops, ind|
+    {
+        try writer.append_segment(
+            po_map.end_points[ind],
+            po_map.end_points[ind + 1],
+            segment_ops,
+        );
+    }
+
+    try writer.finish();
+}
+
+/// a loaded page.  Valid until the page is evicted or the sweep that
+/// returned it moves on.
+pub const Page = struct {
+    /// index of the page
+    index: usize,
+    /// index in the whole map of the first segment of the page
+    first_segment: u64,
+    /// Sample.destination indexes the destinations of the whole map
+    code: evaluation_program.Code,
+};
+
+/// read page entry of file into bytes, which is at least entry.size long
+fn read_page(
+    file: std.fs.File,
+    index: usize,
+    entry: PageEntry,
+    bytes: []align(ALIGNMENT) u8,
+) !Page
+{
+    const size: usize = @intCast(entry.size);
+    if (size > bytes.len or size < @sizeOf(PageHeader)) {
+        return error.Truncated;
+    }
+
+    if (try file.preadAll(bytes[0..size], entry.offset) != size) {
+        return error.Truncated;
+    }
+
+    const page_header = table(PageHeader, bytes, 0, 1)[0];
+    const layout = PageLayout.init(page_header);
+    if (layout.size != size) {
+        return error.Truncated;
+    }
+
+    const segments: usize = page_header.segment_count;
+
+    return .{
+        .index = index,
+        .first_segment = entry.first_segment,
+        .code = .{
+            .end_points = table(
+                opentime.Ordinate,
+                bytes,
+                layout.end_points,
+                segments + 1,
+            ),
+            .segment_starts = table(
+                u32,
+                bytes,
+                layout.segment_starts,
+                segments + 1,
+            ),
+            .instructions = table(
+                Instruction,
+                bytes,
+                layout.instructions,
+                page_header.instruction_count,
+            ),
+            .knots = table(
+                curve.ControlPoint,
+                bytes,
+                layout.knots,
+                page_header.knot_count,
+            ),
+        },
+    };
+}
+
+/// knobs for reading
+pub const ReadOptions = struct {
+    /// number of pages kept in memory
+    cache_pages: usize = 16,
+};
+
+/// counters of a PagedOperatorMap
+pub const Stats = struct {
+    /// page lookups answered from memory
+    hits: usize = 0,
+    /// pages read from the file, including by sweeps
+    page_reads: usize = 0,
+    /// bytes of page buffers currently allocated, including sweeps
+    resident_bytes: usize = 0,
+};
+
+const CachedPage = struct {
+    bytes: []align(ALIGNMENT) u8,
+    page: Page,
+};
+
+/// least recently used first
+const PageList = std.DoublyLinkedList(CachedPage);
+
+/// Reader of a file written by Writer.
+pub const PagedOperatorMap = struct {
+    allocator: std.mem.Allocator,
+    file: std.fs.File,
+    options: ReadOptions,
+    header: Header,
+    index: []PageEntry,
+
+    cached: std.AutoHashMapUnmanaged(usize, *PageList.Node) = .{},
+    lru: PageList = .{},
+    stats: Stats = .{},
+
+    /// open sub_path in dir and read its header and page index
+    pub fn open(
+        allocator: std.mem.Allocator,
+        dir: std.fs.Dir,
+        sub_path: []const u8,
+        options: ReadOptions,
+    ) !PagedOperatorMap
+    {
+        std.debug.assert(options.cache_pages > 0);
+
+        const file = try dir.openFile(sub_path, .{});
+        errdefer file.close();
+
+        var header: Header = undefined;
+        if (try file.preadAll(std.mem.asBytes(&header), 0) != @sizeOf(Header)) {
+            return error.Truncated;
+        }
+        if (!std.mem.eql(u8, &header.magic, &MAGIC)) {
+            return error.BadMagic;
+        }
+        if (header.layout != shared_operator_map.LAYOUT) {
+            return error.LayoutMismatch;
+        }
+        if (header.index.len != header.page_count) {
+            return error.Truncated;
+        }
+
+        const index = try allocator.alloc(
+            PageEntry,
+            @intCast(header.page_count),
+        );
+        errdefer allocator.free(index);
+
+        const index_bytes = std.mem.sliceAsBytes(index);
+        if (
+            try file.preadAll(index_bytes, header.index.offset)
+            != index_bytes.len
+        )
+        {
+            return error.Truncated;
+        }
+
+        return .{
+            .allocator = allocator,
+            .file = file,
+            .options = options,
+            .header = header,
+            .index = index,
+        };
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        while (self.lru.pop())
+            |node|
+        {
+            self.allocator.free(node.data.bytes);
+            self.allocator.destroy(node);
+        }
+        self.cached.deinit(self.allocator);
+        self.allocator.free(self.index);
+        self.file.close();
+    }
+
+    pub fn segment_count(
+        self: @This(),
+    ) usize
+    {
+        return @intCast(self.header.segment_count);
+    }
+
+    pub fn destination_count(
+        self: @This(),
+    ) usize
+    {
+        return @intCast(self.header.destination_count);
+    }
+
+    /// the presentation range covered by the map
+    pub fn extents(
+        self: @This(),
+    ) ?opentime.ContinuousInterval
+    {
+        if (self.index.len == 0) {
+            return null;
+        }
+
+        return .{
+            .start = self.index[0].range().start,
+            .end = self.index[self.index.len - 1].range().end,
+        };
+    }
+
+    /// index of the page containing ord, the last page includes its end
+    pub fn page_at(
+        self: @This(),
+        ord: opentime.Ordinate,
+    ) ?usize
+    {
+        const bounds = self.extents() orelse return null;
+        if (ord.lt(bounds.start) or bounds.end.lt(ord)) {
+            return null;
+        }
+
+        // first page that ends after ord
+        var lo: usize = 0;
+        var hi: usize = self.index.len;
+        while (lo < hi)
+        {
+            const mid = lo + (hi - lo) / 2;
+            if (self.index[mid].range().end.lteq(ord)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        return @min(lo, self.index.len - 1);
+    }
+
+    /// page page_index, read from the file if it is not in memory
+    pub fn page(
+        self: *@This(),
+        page_index: usize,
+    ) !Page
+    {
+        if (self.cached.get(page_index))
+            |node|
+        {
+            self.lru.remove(node);
+            self.lru.append(node);
+            self.stats.hits += 1;
+            return node.data.page;
+        }
+
+        // recycle the least recently used buffer once the cache is full
+        const node = if (self.cached.count() < self.options.cache_pages) blk: {
+            const new_node = try self.allocator.create(PageList.Node);
+            errdefer self.allocator.destroy(new_node);
+
+            new_node.* = .{
+                .data = .{
+                    .bytes = try self.allocator.alignedAlloc(
+                        u8,
+                        ALIGNMENT,
+                        @intCast(self.header.max_page_bytes),
+                    ),
+                    .page = undefined,
+                },
+            };
+            self.stats.resident_bytes += new_node.data.bytes.len;
+            break :blk new_node;
+        } else blk: {
+            const oldest = self.lru.popFirst().?;
+            _ = self.cached.remove(oldest.data.page.index);
+            break :blk oldest;
+        };
+        errdefer {
+            self.stats.resident_bytes -= node.data.bytes.len;
+            self.allocator.free(node.data.bytes);
+            self.allocator.destroy(node);
+        }
+
+        node.data.page = try read_page(
+            self.file,
+            page_index,
+            self.index[page_index],
+            node.data.bytes,
+        );
+        self.stats.page_reads += 1;
+
+        try self.cached.put(self.allocator, page_index, node);
+        self.lru.append(node);
+
+        return node.data.page;
+    }
+
+    /// write one Sample per operator visible at ord into result, like
+    /// EvaluationProgram.evaluate_into
+    pub fn evaluate_into(
+        self: *@This(),
+        ord: opentime.Ordinate,
+        result: []evaluation_program.Sample,
+    ) !usize
+    {
+        const page_index = self.page_at(ord) orelse return 0;
+        const pg = try self.page(page_index);
+        return pg.code.evaluate_into(ord, result);
+    }
+
+    /// name of a destination, read from the file into buffer
+    pub fn destination_name(
+        self: @This(),
+        destination: u32,
+        buffer: []u8,
+    ) ![]u8
+    {
+        if (destination >= self.header.destination_count) {
+            return error.OutOfBounds;
+        }
+
+        var offsets: [2]u32 = undefined;
+        const offsets_bytes = std.mem.asBytes(&offsets);
+        if (
+            try self.file.preadAll(
+                offsets_bytes,
+                self.header.name_offsets.offset
+                + @as(u64, destination) * @sizeOf(u32),
+            ) != offsets_bytes.len
+        )
+        {
+            return error.Truncated;
+        }
+
+        const len = offsets[1] - offsets[0];
+        if (len > buffer.len) {
+            return error.NoSpaceLeft;
+        }
+
+        const name = buffer[0..len];
+        if (
+            try self.file.preadAll(name, self.header.names.offset + offsets[0])
+            != len
+        )
+        {
+            return error.Truncated;
+        }
+
+        return name;
+    }
+
+    /// stream the pages overlapping range in order
+    pub fn sweep(
+        self: *@This(),
+        range: opentime.ContinuousInterval,
+    ) !Sweep
+    {
+        const bounds = self.extents() orelse return .{ .map = self };
+
+        const clamped = opentime.interval.intersect(range, bounds) orelse {
+            return .{ .map = self };
+        };
+
+        // the pages starting before the end of the range, and at least the
+        // one containing an instant
+        const first_page = self.page_at(clamped.start).?;
+        var end_page = first_page + 1;
+        while (
+            end_page < self.index.len
+            and self.index[end_page].range().start.lt(clamped.end)
+        ) : (end_page += 1)
+        {}
+
+        const bytes = try self.allocator.alignedAlloc(
+            u8,
+            ALIGNMENT,
+            @intCast(self.header.max_page_bytes),
+        );
+        self.stats.resident_bytes += bytes.len;
+
+        return .{
+            .map = self,
+            .bytes = bytes,
+            .next_page = first_page,
+            .end_page = end_page,
+        };
+    }
+};
+
+/// Sequential pass over a range of pages, see PagedOperatorMap.sweep.
+pub const Sweep = struct {
+    map: *PagedOperatorMap,
+    bytes: []align(ALIGNMENT) u8 = &.{},
+    next_page: usize = 0,
+    end_page: usize = 0,
+
+    /// the next page of the range, or null once it is done.  Invalidates
+    /// the previous page.
+    pub fn next(
+        self: *@This(),
+    ) !?Page
+    {
+        if (self.next_page >= self.end_page) {
+            return null;
+        }
+
+        const result = try read_page(
+            self.map.file,
+            self.next_page,
+            self.map.index[self.next_page],
+            self.bytes,
+        );
+        self.map.stats.page_reads += 1;
+        self.next_page += 1;
+
+        return result;
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        if (self.bytes.len > 0)
+        {
+            self.map.stats.resident_bytes -= self.bytes.len;
+            self.map.allocator.free(self.bytes);
+        }
+    }
+};
+
+test "PagedOperatorMap: matches the EvaluationProgram"
+{
+    const allocator = std.testing.allocator;
+
+    const timeline_generator = @import("timeline_generator.zig");
+    const topological_map_m = @import("topological_map.zig");
+
+    const gen = try timeline_generator.generate(
+        allocator,
+        .{
+            .track_count = 2,
+            .clips_per_track = 32,
+            .gap_ratio = 0.25,
+            .warp_density = 0.5,
+            .seed = 100,
+        },
+    );
+    defer gen.deinit();
+
+    const map = try topological_map_m.build_topological_map(
+        allocator,
+        gen.ref(),
+    );
+    defer map.deinit();
+
+    const po_map = try core.projection_map_to_media_from(
+        allocator,
+        map,
+        try gen.ref().space(.presentation),
+    );
+    defer po_map.deinit();
+
+    const program = try evaluation_program.EvaluationProgram.compile(
+        allocator,
+        po_map,
+    );
+    defer program.deinit();
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const SEGMENTS_PER_PAGE = 4;
+    try write_map(
+        allocator,
+        po_map,
+        tmp.dir,
+        "map.wrklpgm",
+        .{ .segments_per_page = SEGMENTS_PER_PAGE },
+    );
+
+    var paged = try PagedOperatorMap.open(
+        allocator,
+        tmp.dir,
+        "map.wrklpgm",
+        .{ .cache_pages = 2 },
+    );
+    defer paged.deinit();
+
+    try std.testing.expectEqual(program.segment_count(), paged.segment_count());
+    try std.testing.expectEqual(
+        (program.segment_count() + SEGMENTS_PER_PAGE - 1) / SEGMENTS_PER_PAGE,
+        paged.index.len,
+    );
+
+    var expected: [16]evaluation_program.Sample = undefined;
+    var samples: [16]evaluation_program.Sample = undefined;
+    var name_buffer: [256]u8 = undefined;
+
+    // the middle of every segment, and the end of the map
+    for (0..program.segment_count() + 1)
+        |ind|
+    {
+        const ord = if (ind < program.segment_count())
+            program.end_points[ind].add(program.end_points[ind + 1]).div(2)
+        else
+            program.end_points[ind];
+
+        const count = program.evaluate_into(ord, &expected);
+        try std.testing.expectEqual(
+            count,
+            try paged.evaluate_into(ord, &samples),
+        );
+
+        for (expected[0..count], samples[0..count])
+            |want, got|
+        {
+            try std.testing.expectEqual(want.result, got.result);
+            try std.testing.expectEqualStrings(
+                program.destinations[want.destination].ref.name() orelse "",
+                try paged.destination_name(got.destination, &name_buffer),
+            );
+        }
+    }
+
+    // memory is bounded by the cache, not the map
+    try std.testing.expect(
+        paged.stats.resident_bytes <= 2 * paged.header.max_page_bytes
+    );
+    try std.testing.expect(paged.stats.hits > 0);
+
+    // outside of the map
+    try std.testing.expectEqual(
+        0,
+        try paged.evaluate_into(program.end_points[0].sub(1), &samples),
+    );
+
+    // a sweep over everything visits every segment once, in order
+    var sweep = try paged.sweep(paged.extents().?);
+    defer sweep.deinit();
+
+    var segments: usize = 0;
+    while (try sweep.next())
+        |pg|
+    {
+        try std.testing.expectEqual(segments, pg.first_segment);
+        try std.testing.expect(
+            pg.code.end_points[0].eql(program.end_points[segments])
+        );
+        segments += pg.code.segment_count();
+    }
+    try std.testing.expectEqual(program.segment_count(), segments);
+
+    // a range ending on a page boundary does not read the next page
+    if (paged.index.len > 1)
+    {
+        var first = try paged.sweep(
+            .{
+                .start = paged.index[0].range().start,
+                .end = paged.index[0].range().end,
+            }
+        );
+        defer first.deinit();
+
+        try std.testing.expectEqual(0, (try first.next()).?.index);
+        try std.testing.expect(try first.next() == null);
+    }
+}
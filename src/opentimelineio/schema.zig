@@ -337,9 +337,11 @@ pub const Track = struct {
         const child = self.child_ptr_from_index(
             child_index - 1
         );
+        // the presentation space is what is laid out in the track (for a
+        // warp this differs from the media space)
         const child_range = try child.bounds_of(
             allocator,
-            .media
+            .presentation
         );
         const child_duration = child_range.duration();
 
@@ -453,9 +455,9 @@ pub const Stack = struct {
         for (self.children.items) 
             |it| 
         {
-            const it_bound = (
-                (try it.topology(allocator)).input_bounds()
-            );
+            const topo = try it.topology(allocator);
+            defer topo.deinit(allocator);
+            const it_bound = topo.input_bounds();
             if (bounds) 
                 |b| 
             {
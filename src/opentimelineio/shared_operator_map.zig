@@ -0,0 +1,587 @@
+//! Relocatable, read-only layout of a compiled ProjectionOperatorMap.
+//!
+//! An EvaluationProgram is already a handful of flat tables; this module
+//! writes them back to back into one buffer with offsets instead of
+//! pointers:
+//!
+//!     Header           magic, layout hash, total size, one Section per table
+//!     end_points       []Ordinate
+//!     segment_starts   []u32
+//!     instructions     []Instruction
+//!     knots            []ControlPoint
+//!     name_offsets     []u32, destination i is names[off[i]..off[i+1]]
+//!     names            []u8
+//!
+//! The buffer can live in a file or in a shared mapping.  Attaching to it
+//! validates the header and slices the tables in place, so any number of
+//! processes can evaluate the same map from one copy.  Destinations are
+//! referenced by name, since the objects behind a ComposedValueRef only
+//! exist in the process that built the map.
+//!
+//! The tables are stored in native layout, so a buffer is only readable by
+//! builds with the same LAYOUT hash.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+
+const evaluation_program = @import("evaluation_program.zig");
+const EvaluationProgram = evaluation_program.EvaluationProgram;
+const Instruction = evaluation_program.Instruction;
+
+pub const MAGIC = "WRKLOPM1".*;
+
+/// bump when the set or order of sections changes
+const VERSION: u64 = 1;
+
+/// alignment of the buffer and of every section in it
+pub const ALIGNMENT = @max(
+    16,
+    @alignOf(Header),
+    @alignOf(opentime.Ordinate),
+    @alignOf(Instruction),
+    @alignOf(curve.ControlPoint),
+);
+
+/// hash of everything the in memory layout of the tables depends on
+pub const LAYOUT: u64 = blk: {
+    @setEvalBranchQuota(100_000);
+
+    var hasher = std.hash.Fnv1a_64.init();
+    hasher.update(std.mem.asBytes(&VERSION));
+    hasher.update(@tagName(@import("builtin").cpu.arch.endian()));
+
+    inline for ([_]type{ opentime.Ordinate, Instruction, curve.ControlPoint })
+        |T|
+    {
+        hash_layout(&hasher, T);
+    }
+
+    break :blk hasher.final();
+};
+
+/// hash the size, alignment and fields of T, recursing into the types of
+/// the fields, and the values of enums
+fn hash_layout(
+    comptime hasher: *std.hash.Fnv1a_64,
+    comptime T: type,
+) void
+{
+    const size: u64 = @sizeOf(T);
+    const alignment: u64 = @alignOf(T);
+    hasher.update(std.mem.asBytes(&size));
+    hasher.update(std.mem.asBytes(&alignment));
+
+    switch (@typeInfo(T)) {
+        .Struct => |info| {
+            inline for (info.fields)
+                |field|
+            {
+                const offset: u64 = @offsetOf(T, field.name);
+                hasher.update(field.name);
+                hasher.update(std.mem.asBytes(&offset));
+                hash_layout(hasher, field.type);
+            }
+        },
+        .Enum => |info| {
+            hash_layout(hasher, info.tag_type);
+            inline for (info.fields)
+                |field|
+            {
+                const value: u64 = field.value;
+                hasher.update(field.name);
+                hasher.update(std.mem.asBytes(&value));
+            }
+        },
+        else => hasher.update(@typeName(T)),
+    }
+}
+
+pub const SectionId = enum(u8) {
+    end_points,
+    segment_starts,
+    instructions,
+    knots,
+    name_offsets,
+    names,
+};
+
+const SECTION_COUNT = std.meta.fields(SectionId).len;
+
+/// a table inside the buffer, offset in bytes from the start of the buffer
+/// and len in elements
+pub const Section = extern struct {
+    offset: u64 = 0,
+    len: u64 = 0,
+};
+
+pub const Header = extern struct {
+    magic: [8]u8 = MAGIC,
+    layout: u64 = LAYOUT,
+    total_size: u64 = 0,
+    sections: [SECTION_COUNT]Section = [_]Section{ .{} } ** SECTION_COUNT,
+
+    fn section(
+        self: @This(),
+        id: SectionId,
+    ) Section
+    {
+        return self.sections[@intFromEnum(id)];
+    }
+};
+
+pub const AttachError = error{
+    BadMagic,
+    LayoutMismatch,
+    Truncated,
+};
+
+/// header describing where each table of program goes
+fn plan(
+    program: EvaluationProgram,
+) Header
+{
+    var header = Header{};
+
+    var name_bytes: usize = 0;
+    for (program.destinations)
+        |destination|
+    {
+        name_bytes += (destination.ref.name() orelse "").len;
+    }
+
+    const lens = [SECTION_COUNT]usize{
+        program.end_points.len,
+        program.segment_starts.len,
+        program.instructions.len,
+        program.knots.len,
+        program.destinations.len + 1,
+        name_bytes,
+    };
+    const sizes = [SECTION_COUNT]usize{
+        @sizeOf(opentime.Ordinate),
+        @sizeOf(u32),
+        @sizeOf(Instruction),
+        @sizeOf(curve.ControlPoint),
+        @sizeOf(u32),
+        @sizeOf(u8),
+    };
+
+    var offset = std.mem.alignForward(usize, @sizeOf(Header), ALIGNMENT);
+    for (&header.sections, lens, sizes)
+        |*sec, len, size|
+    {
+        sec.* = .{ .offset = offset, .len = len };
+        offset = std.mem.alignForward(usize, offset + len * size, ALIGNMENT);
+    }
+    header.total_size = offset;
+
+    return header;
+}
+
+/// number of bytes write_into needs for program
+pub fn serialized_size(
+    program: EvaluationProgram,
+) usize
+{
+    return @intCast(plan(program).total_size);
+}
+
+/// slice of the section sec of buffer as a []T
+fn section_slice(
+    comptime T: type,
+    buffer: anytype,
+    sec: Section,
+) AttachError!(
+    if (@typeInfo(@TypeOf(buffer)).Pointer.is_const) []const T else []T
+)
+{
+    if (
+        sec.offset % @alignOf(T) != 0
+        or sec.offset > buffer.len
+        or sec.len > (buffer.len - sec.offset) / @sizeOf(T)
+    )
+    {
+        return error.Truncated;
+    }
+
+    const start: usize = @intCast(sec.offset);
+    const len: usize = @intCast(sec.len);
+
+    return @as(
+        if (@typeInfo(@TypeOf(buffer)).Pointer.is_const) [*]const T else [*]T,
+        @ptrCast(@alignCast(buffer.ptr + start)),
+    )[0..len];
+}
+
+/// lay program out into buffer, returns the number of bytes written.
+/// Returns error.NoSpaceLeft if buffer is shorter than serialized_size.
+pub fn write_into(
+    program: EvaluationProgram,
+    buffer: []align(ALIGNMENT) u8,
+) error{NoSpaceLeft}!usize
+{
+    const header = plan(program);
+    const total: usize = @intCast(header.total_size);
+    if (buffer.len < total) {
+        return error.NoSpaceLeft;
+    }
+
+    const out = buffer[0..total];
+    @memset(out, 0);
+    @memcpy(out[0..@sizeOf(Header)], std.mem.asBytes(&header));
+
+    // the plan always fits into out, so none of these can fail
+    @memcpy(
+        section_slice(opentime.Ordinate, out, header.section(.end_points))
+            catch unreachable,
+        program.end_points,
+    );
+    @memcpy(
+        section_slice(u32, out, header.section(.segment_starts))
+            catch unreachable,
+        program.segment_starts,
+    );
+    @memcpy(
+        section_slice(Instruction, out, header.section(.instructions))
+            catch unreachable,
+        program.instructions,
+    );
+    @memcpy(
+        section_slice(curve.ControlPoint, out, header.section(.knots))
+            catch unreachable,
+        program.knots,
+    );
+
+    const name_offsets = section_slice(
+        u32,
+        out,
+        header.section(.name_offsets),
+    ) catch unreachable;
+    const names = section_slice(
+        u8,
+        out,
+        header.section(.names),
+    ) catch unreachable;
+
+    var written: usize = 0;
+    for (program.destinations, 0..)
+        |destination, ind|
+    {
+        const name = destination.ref.name() orelse "";
+        name_offsets[ind] = @intCast(written);
+        @memcpy(names[written..written + name.len], name);
+        written += name.len;
+    }
+    name_offsets[program.destinations.len] = @intCast(written);
+
+    return total;
+}
+
+/// write the layout of program to sub_path in dir
+pub fn write_file(
+    allocator: std.mem.Allocator,
+    program: EvaluationProgram,
+    dir: std.fs.Dir,
+    sub_path: []const u8,
+) !void
+{
+    const buffer = try allocator.alignedAlloc(
+        u8,
+        ALIGNMENT,
+        serialized_size(program),
+    );
+    defer allocator.free(buffer);
+
+    const len = try write_into(program, buffer);
+
+    const file = try dir.createFile(sub_path, .{});
+    defer file.close();
+    try file.writeAll(buffer[0..len]);
+}
+
+/// Read-only view of a layout written by write_into.  Does not own the
+/// memory it was attached to, which must outlive it.
+pub const SharedOperatorMap = struct {
+    /// evaluate with code.evaluate_into etc, Sample.destination indexes
+    /// destination_name
+    code: evaluation_program.Code,
+    name_offsets: []const u32,
+    names: []const u8,
+
+    /// check the header of bytes and slice the tables out of it, without
+    /// copying them.  The tables themselves are trusted to be what
+    /// write_into produced.
+    pub fn attach(
+        bytes: []align(ALIGNMENT) const u8,
+    ) AttachError!SharedOperatorMap
+    {
+        if (bytes.len < @sizeOf(Header)) {
+            return error.Truncated;
+        }
+
+        const header: *const Header = @ptrCast(bytes.ptr);
+        if (!std.mem.eql(u8, &header.magic, &MAGIC)) {
+            return error.BadMagic;
+        }
+        if (header.layout != LAYOUT) {
+            return error.LayoutMismatch;
+        }
+        if (header.total_size > bytes.len) {
+            return error.Truncated;
+        }
+
+        const used = bytes[0..@intCast(header.total_size)];
+
+        const result = SharedOperatorMap{
+            .code = .{
+                .end_points = try section_slice(
+                    opentime.Ordinate,
+                    used,
+                    header.section(.end_points),
+                ),
+                .segment_starts = try section_slice(
+                    u32,
+                    used,
+                    header.section(.segment_starts),
+                ),
+                .instructions = try section_slice(
+                    Instruction,
+                    used,
+                    header.section(.instructions),
+                ),
+                .knots = try section_slice(
+                    curve.ControlPoint,
+                    used,
+                    header.section(.knots),
+                ),
+            },
+            .name_offsets = try section_slice(
+                u32,
+                used,
+                header.section(.name_offsets),
+            ),
+            .names = try section_slice(u8, used, header.section(.names)),
+        };
+
+        // constant time consistency checks of the table sizes
+        const segment_starts = result.code.segment_starts;
+        if (
+            segment_starts.len != result.code.end_points.len
+            or result.name_offsets.len == 0
+            or result.name_offsets[result.name_offsets.len - 1]
+                != result.names.len
+            or (
+                segment_starts.len > 0
+                and segment_starts[segment_starts.len - 1]
+                    != result.code.instructions.len
+            )
+        )
+        {
+            return error.Truncated;
+        }
+
+        return result;
+    }
+
+    pub fn destination_count(
+        self: @This(),
+    ) usize
+    {
+        return self.name_offsets.len - 1;
+    }
+
+    /// name of the destination space of a Sample
+    pub fn destination_name(
+        self: @This(),
+        destination: u32,
+    ) []const u8
+    {
+        return self.names[
+            self.name_offsets[destination]..self.name_offsets[destination + 1]
+        ];
+    }
+};
+
+/// A layout mapped into memory with mmap.  Mappings of the same file share
+/// their pages between processes, and an anonymous mapping is shared with
+/// every process forked after it was made.
+pub const MappedRegion = struct {
+    bytes: []align(std.mem.page_size) u8,
+
+    /// map the layout at sub_path in dir read only
+    pub fn open_file(
+        dir: std.fs.Dir,
+        sub_path: []const u8,
+    ) !MappedRegion
+    {
+        const file = try dir.openFile(sub_path, .{});
+        defer file.close();
+
+        const size = try file.getEndPos();
+        if (size < @sizeOf(Header)) {
+            return error.Truncated;
+        }
+
+        return .{
+            .bytes = try std.posix.mmap(
+                null,
+                @intCast(size),
+                std.posix.PROT.READ,
+                .{ .TYPE = .SHARED },
+                file.handle,
+                0,
+            ),
+        };
+    }
+
+    /// lay program out into a new anonymous shared mapping
+    pub fn init_anonymous(
+        program: EvaluationProgram,
+    ) !MappedRegion
+    {
+        const bytes = try std.posix.mmap(
+            null,
+            serialized_size(program),
+            std.posix.PROT.READ | std.posix.PROT.WRITE,
+            .{ .TYPE = .SHARED, .ANONYMOUS = true },
+            -1,
+            0,
+        );
+        errdefer std.posix.munmap(bytes);
+
+        _ = try write_into(program, bytes);
+
+        return .{ .bytes = bytes };
+    }
+
+    pub fn deinit(
+        self: @This(),
+    ) void
+    {
+        std.posix.munmap(self.bytes);
+    }
+
+    pub fn attach(
+        self: @This(),
+    ) AttachError!SharedOperatorMap
+    {
+        return SharedOperatorMap.attach(self.bytes);
+    }
+};
+
+test "SharedOperatorMap: matches the EvaluationProgram"
+{
+    const allocator = std.testing.allocator;
+
+    const core = @import("core.zig");
+    const timeline_generator = @import("timeline_generator.zig");
+    const topological_map_m = @import("topological_map.zig");
+
+    const gen = try timeline_generator.generate(
+        allocator,
+        .{
+            .track_count = 2,
+            .clips_per_track = 16,
+            .gap_ratio = 0.25,
+            .warp_density = 0.5,
+            .seed = 97,
+        },
+    );
+    defer gen.deinit();
+
+    const map = try topological_map_m.build_topological_map(
+        allocator,
+        gen.ref(),
+    );
+    defer map.deinit();
+
+    const po_map = try core.projection_map_to_media_from(
+        allocator,
+        map,
+        try gen.ref().space(.presentation),
+    );
+    defer po_map.deinit();
+
+    const program = try EvaluationProgram.compile(allocator, po_map);
+    defer program.deinit();
+
+    const buffer = try allocator.alignedAlloc(
+        u8,
+        ALIGNMENT,
+        serialized_size(program),
+    );
+    defer allocator.free(buffer);
+
+    try std.testing.expectEqual(buffer.len, try write_into(program, buffer));
+    try std.testing.expectError(
+        error.NoSpaceLeft,
+        write_into(program, buffer[0..buffer.len - ALIGNMENT]),
+    );
+
+    const region = try MappedRegion.init_anonymous(program);
+    defer region.deinit();
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try write_file(allocator, program, tmp.dir, "map.wrklopm");
+    const file_region = try MappedRegion.open_file(tmp.dir, "map.wrklopm");
+    defer file_region.deinit();
+
+    for ([_]SharedOperatorMap{
+        try SharedOperatorMap.attach(buffer),
+        try region.attach(),
+        try file_region.attach(),
+    })
+        |shared|
+    {
+        try std.testing.expectEqual(
+            program.segment_count(),
+            shared.code.segment_count(),
+        );
+        try std.testing.expectEqual(
+            program.destinations.len,
+            shared.destination_count(),
+        );
+
+        var expected: [16]evaluation_program.Sample = undefined;
+        var samples: [16]evaluation_program.Sample = undefined;
+
+        for (0..program.segment_count())
+            |ind|
+        {
+            const ord = program.end_points[ind].add(
+                program.end_points[ind + 1]
+            ).div(2);
+
+            const count = program.evaluate_into(ord, &expected);
+            try std.testing.expectEqual(
+                count,
+                shared.code.evaluate_into(ord, &samples),
+            );
+
+            for (expected[0..count], samples[0..count])
+                |want, got|
+            {
+                try std.testing.expectEqual(want, got);
+                try std.testing.expectEqualStrings(
+                    program.destinations[want.destination].ref.name() orelse "",
+                    shared.destination_name(got.destination),
+                );
+            }
+        }
+    }
+
+    // a damaged header is rejected
+    buffer[0] = 'X';
+    try std.testing.expectError(
+        error.BadMagic,
+        SharedOperatorMap.attach(buffer),
+    );
+    buffer[0] = MAGIC[0];
+    try std.testing.expectError(
+        error.Truncated,
+        SharedOperatorMap.attach(buffer[0..buffer.len - 1]),
+    );
+}
@@ -0,0 +1,963 @@
+//! Structural diff of two revisions of a timeline.
+//!
+//! Answers "which ranges of the presentation space have to be rendered
+//! again" when a revised timeline replaces one that was already rendered:
+//!
+//! 1. Alignment: the two trees are walked together.  The children of every
+//!    pair of containers are aligned by a hash of their content (kind, name,
+//!    bounds, media, warps and children), falling back to their name, so
+//!    that an edited clip or track still pairs with its previous revision.
+//!    The common prefix and suffix of the children are paired directly.
+//! 2. Comparison: the segment end points of both ProjectionOperatorMaps are
+//!    merged.  Over each merged piece the operators of the two segments must
+//!    have paired destinations and the same topology over the piece,
+//!    otherwise the piece is reported as changed.
+//!
+//! The diff is conservative: anything that can not be paired, including
+//! children that moved past others in a track, counts as changed.  Clip
+//! parameters are not compared.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const topology_m = @import("topology");
+
+const core = @import("core.zig");
+const schema = @import("schema.zig");
+const topological_map_m = @import("topological_map.zig");
+
+/// Pairs of objects in two revisions of a timeline that are the same item.
+pub const Alignment = struct {
+    allocator: std.mem.Allocator,
+    /// object in the new revision -> object in the old revision
+    new_to_old: std.AutoHashMapUnmanaged(
+        core.ComposedValueRef,
+        core.ComposedValueRef,
+    ) = .{},
+
+    /// align the trees under old_root and new_root
+    pub fn init(
+        allocator: std.mem.Allocator,
+        old_root: core.ComposedValueRef,
+        new_root: core.ComposedValueRef,
+    ) !Alignment
+    {
+        var result = Alignment{ .allocator = allocator };
+        errdefer result.deinit();
+
+        // every subtree is hashed once, however deep it sits
+        var hashes = HashCache{ .allocator = allocator };
+        defer hashes.deinit();
+
+        try result.pair(&hashes, old_root, new_root);
+
+        return result;
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        self.new_to_old.deinit(self.allocator);
+    }
+
+    /// the object in the old revision paired with new_ref
+    pub fn old_of(
+        self: @This(),
+        new_ref: core.ComposedValueRef,
+    ) ?core.ComposedValueRef
+    {
+        return self.new_to_old.get(new_ref);
+    }
+
+    /// number of paired objects
+    pub fn count(
+        self: @This(),
+    ) usize
+    {
+        return self.new_to_old.count();
+    }
+
+    fn pair(
+        self: *@This(),
+        hashes: *HashCache,
+        old_ref: core.ComposedValueRef,
+        new_ref: core.ComposedValueRef,
+    ) std.mem.Allocator.Error!void
+    {
+        if (std.meta.activeTag(old_ref) != std.meta.activeTag(new_ref)) {
+            return;
+        }
+
+        try self.new_to_old.put(self.allocator, new_ref, old_ref);
+
+        switch (old_ref) {
+            .timeline_ptr => |old_tl| try self.pair(
+                hashes,
+                core.ComposedValueRef.init(&old_tl.tracks),
+                core.ComposedValueRef.init(&new_ref.timeline_ptr.tracks),
+            ),
+            .stack_ptr => |old_st| try self.align_children(
+                hashes,
+                old_st.children.items,
+                new_ref.stack_ptr.children.items,
+            ),
+            .track_ptr => |old_tr| try self.align_children(
+                hashes,
+                old_tr.children.items,
+                new_ref.track_ptr.children.items,
+            ),
+            .warp_ptr => |old_wp| try self.pair(
+                hashes,
+                old_wp.child,
+                new_ref.warp_ptr.child,
+            ),
+            .clip_ptr, .gap_ptr => {},
+        }
+    }
+
+    /// pair the children of two containers, keeping their order
+    fn align_children(
+        self: *@This(),
+        hashes: *HashCache,
+        old_children: []const core.ComposableValue,
+        new_children: []const core.ComposableValue,
+    ) std.mem.Allocator.Error!void
+    {
+        const old_keys = try child_keys(self.allocator, hashes, old_children);
+        defer self.allocator.free(old_keys);
+        const new_keys = try child_keys(self.allocator, hashes, new_children);
+        defer self.allocator.free(new_keys);
+
+        // common prefix and suffix
+        var prefix: usize = 0;
+        while (
+            prefix < old_keys.len
+            and prefix < new_keys.len
+            and old_keys[prefix].content == new_keys[prefix].content
+        ) : (prefix += 1)
+        {
+            try self.pair(
+                hashes,
+                core.ComposedValueRef.init(&old_children[prefix]),
+                core.ComposedValueRef.init(&new_children[prefix]),
+            );
+        }
+
+        var suffix: usize = 0;
+        while (
+            suffix < old_keys.len - prefix
+            and suffix < new_keys.len - prefix
+            and (
+                old_keys[old_keys.len - 1 - suffix].content
+                == new_keys[new_keys.len - 1 - suffix].content
+            )
+        ) : (suffix += 1)
+        {
+            try self.pair(
+                hashes,
+                core.ComposedValueRef.init(
+                    &old_children[old_children.len - 1 - suffix]
+                ),
+                core.ComposedValueRef.init(
+                    &new_children[new_children.len - 1 - suffix]
+                ),
+            );
+        }
+
+        const old_middle = old_keys[prefix..old_keys.len - suffix];
+        const new_middle = new_keys[prefix..new_keys.len - suffix];
+        if (old_middle.len == 0 or new_middle.len == 0) {
+            return;
+        }
+
+        // greedily pair each new child with the next old child that has the
+        // same content, or else the same name
+        const by_content = try sorted_index(
+            self.allocator,
+            old_middle,
+            .content,
+        );
+        defer self.allocator.free(by_content);
+        const by_name = try sorted_index(self.allocator, old_middle, .name);
+        defer self.allocator.free(by_name);
+
+        var next_old: usize = 0;
+        for (new_middle, 0..)
+            |key, new_ind|
+        {
+            const maybe_old_ind = (
+                first_at_or_after(by_content, key.content, next_old)
+                orelse if (key.name) |name| (
+                    first_at_or_after(by_name, name, next_old)
+                ) else null
+            );
+
+            if (maybe_old_ind)
+                |old_ind|
+            {
+                try self.pair(
+                    hashes,
+                    core.ComposedValueRef.init(&old_children[prefix + old_ind]),
+                    core.ComposedValueRef.init(&new_children[prefix + new_ind]),
+                );
+                next_old = old_ind + 1;
+            }
+        }
+    }
+};
+
+const ChildKey = struct {
+    content: u64,
+    /// hash of the name, if the child has one
+    name: ?u64,
+};
+
+fn child_keys(
+    allocator: std.mem.Allocator,
+    hashes: *HashCache,
+    children: []const core.ComposableValue,
+) ![]ChildKey
+{
+    const keys = try allocator.alloc(ChildKey, children.len);
+    errdefer allocator.free(keys);
+
+    for (keys, children)
+        |*key, *child|
+    {
+        const ref = core.ComposedValueRef.init(child);
+        key.* = .{
+            .content = try hashes.child_hash(ref),
+            .name = (
+                if (ref.name()) |name| std.hash.Wyhash.hash(0, name) else null
+            ),
+        };
+    }
+
+    return keys;
+}
+
+const IndexEntry = struct {
+    hash: u64,
+    index: usize,
+
+    fn less_than(
+        _: void,
+        lhs: IndexEntry,
+        rhs: IndexEntry,
+    ) bool
+    {
+        if (lhs.hash != rhs.hash) {
+            return lhs.hash < rhs.hash;
+        }
+        return lhs.index < rhs.index;
+    }
+};
+
+/// (hash, index) of keys sorted by hash then index, skipping unnamed keys
+/// when indexing by name
+fn sorted_index(
+    allocator: std.mem.Allocator,
+    keys: []const ChildKey,
+    comptime field: enum { content, name },
+) ![]IndexEntry
+{
+    var entries = std.ArrayList(IndexEntry).init(allocator);
+    errdefer entries.deinit();
+
+    for (keys, 0..)
+        |key, ind|
+    {
+        const maybe_hash: ?u64 = switch (field) {
+            .content => key.content,
+            .name => key.name,
+        };
+        if (maybe_hash)
+            |hash|
+        {
+            try entries.append(.{ .hash = hash, .index = ind });
+        }
+    }
+
+    std.mem.sort(IndexEntry, entries.items, {}, IndexEntry.less_than);
+
+    return try entries.toOwnedSlice();
+}
+
+/// smallest index >= min_index with the given hash
+fn first_at_or_after(
+    entries: []const IndexEntry,
+    hash: u64,
+    min_index: usize,
+) ?usize
+{
+    const target = IndexEntry{ .hash = hash, .index = min_index };
+
+    // first entry that is not less than target
+    var lo: usize = 0;
+    var hi: usize = entries.len;
+    while (lo < hi)
+    {
+        const mid = lo + (hi - lo) / 2;
+        if (IndexEntry.less_than({}, entries[mid], target)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < entries.len and entries[lo].hash == hash) {
+        return entries[lo].index;
+    }
+    return null;
+}
+
+/// hash of everything about ref that affects what it presents
+pub fn content_hash(
+    ref: core.ComposedValueRef,
+) u64
+{
+    return subtree_hash(Uncached{}, ref) catch unreachable;
+}
+
+/// content hashes of the objects of a tree, each computed once from the
+/// cached hashes of its children
+const HashCache = struct {
+    allocator: std.mem.Allocator,
+    hashes: std.AutoHashMapUnmanaged(core.ComposedValueRef, u64) = .{},
+
+    fn deinit(
+        self: *@This(),
+    ) void
+    {
+        self.hashes.deinit(self.allocator);
+    }
+
+    fn child_hash(
+        self: *@This(),
+        ref: core.ComposedValueRef,
+    ) std.mem.Allocator.Error!u64
+    {
+        if (self.hashes.get(ref))
+            |hash|
+        {
+            return hash;
+        }
+
+        const hash = try subtree_hash(self, ref);
+        try self.hashes.put(self.allocator, ref, hash);
+        return hash;
+    }
+};
+
+/// rehashes every subtree, for a single content_hash
+const Uncached = struct {
+    fn child_hash(
+        _: Uncached,
+        ref: core.ComposedValueRef,
+    ) std.mem.Allocator.Error!u64
+    {
+        return try subtree_hash(Uncached{}, ref);
+    }
+};
+
+/// hash of the fields of ref and the hashes of its children, which come from
+/// source.child_hash
+fn subtree_hash(
+    source: anytype,
+    ref: core.ComposedValueRef,
+) std.mem.Allocator.Error!u64
+{
+    var hasher = std.hash.Wyhash.init(0);
+
+    hash_tag(&hasher, ref);
+    hash_bytes(&hasher, ref.name());
+
+    switch (ref) {
+        .clip_ptr => |cl| {
+            hash_interval(&hasher, cl.bounds_s);
+            hash_media(&hasher, cl.media);
+        },
+        .gap_ptr => |gp| {
+            hasher.update(std.mem.asBytes(&gp.duration_seconds));
+        },
+        .warp_ptr => |wp| {
+            hasher.update(std.mem.asBytes(&wp.interpolating));
+            hash_topology(&hasher, wp.transform);
+            try hash_child(&hasher, source, wp.child);
+        },
+        .track_ptr => |tr| {
+            for (tr.children.items)
+                |*child|
+            {
+                try hash_child(
+                    &hasher,
+                    source,
+                    core.ComposedValueRef.init(child),
+                );
+            }
+        },
+        .stack_ptr => |st| {
+            for (st.children.items)
+                |*child|
+            {
+                try hash_child(
+                    &hasher,
+                    source,
+                    core.ComposedValueRef.init(child),
+                );
+            }
+        },
+        .timeline_ptr => |tl| {
+            try hash_child(
+                &hasher,
+                source,
+                core.ComposedValueRef.init(&tl.tracks),
+            );
+        },
+    }
+
+    return hasher.final();
+}
+
+fn hash_child(
+    hasher: *std.hash.Wyhash,
+    source: anytype,
+    child: core.ComposedValueRef,
+) std.mem.Allocator.Error!void
+{
+    const hash = try source.child_hash(child);
+    hasher.update(std.mem.asBytes(&hash));
+}
+
+/// the active tag of a union, widened so that no padding bits are hashed
+fn hash_tag(
+    hasher: *std.hash.Wyhash,
+    value: anytype,
+) void
+{
+    const tag: u32 = @intFromEnum(std.meta.activeTag(value));
+    hasher.update(std.mem.asBytes(&tag));
+}
+
+fn hash_bytes(
+    hasher: *std.hash.Wyhash,
+    maybe_bytes: ?[]const u8,
+) void
+{
+    hasher.update(std.mem.asBytes(&(maybe_bytes != null)));
+    if (maybe_bytes)
+        |bytes|
+    {
+        hasher.update(std.mem.asBytes(&bytes.len));
+        hasher.update(bytes);
+    }
+}
+
+fn hash_interval(
+    hasher: *std.hash.Wyhash,
+    maybe_interval: ?opentime.ContinuousInterval,
+) void
+{
+    hasher.update(std.mem.asBytes(&(maybe_interval != null)));
+    if (maybe_interval)
+        |interval|
+    {
+        hasher.update(std.mem.asBytes(&interval));
+    }
+}
+
+fn hash_media(
+    hasher: *std.hash.Wyhash,
+    media: schema.MediaReference,
+) void
+{
+    hash_tag(hasher, media.ref);
+    switch (media.ref) {
+        .external => |ext| hash_bytes(hasher, ext.target_uri),
+        .signal => |sig| {
+            const gen = sig.signal_generator;
+            hasher.update(std.mem.asBytes(&gen.frequency_hz));
+            hasher.update(std.mem.asBytes(&gen.amplitude));
+            hasher.update(std.mem.asBytes(&gen.duration_s));
+            const signal: u32 = @intFromEnum(gen.signal);
+            hasher.update(std.mem.asBytes(&signal));
+        },
+        .empty => {},
+    }
+
+    hash_interval(hasher, media.bounds_s);
+
+    hasher.update(std.mem.asBytes(&(media.discrete_info != null)));
+    if (media.discrete_info)
+        |info|
+    {
+        switch (info.sample_rate_hz) {
+            .Int => |rate| {
+                hasher.update(std.mem.asBytes(&rate));
+            },
+            .Rat => |rate| {
+                hasher.update(std.mem.asBytes(&rate.num));
+                hasher.update(std.mem.asBytes(&rate.den));
+            },
+        }
+        hasher.update(std.mem.asBytes(&info.start_index));
+    }
+
+    hasher.update(std.mem.asBytes(&media.interpolating));
+}
+
+fn hash_topology(
+    hasher: *std.hash.Wyhash,
+    topo: topology_m.Topology,
+) void
+{
+    for (topo.mappings)
+        |m|
+    {
+        hash_tag(hasher, m);
+        switch (m) {
+            .empty => |e| {
+                hasher.update(std.mem.asBytes(&e.defined_range));
+            },
+            .affine => |aff| {
+                hasher.update(std.mem.asBytes(&aff.input_bounds_val));
+                hasher.update(std.mem.asBytes(&aff.input_to_output_xform));
+            },
+            .linear => |lin| {
+                hasher.update(
+                    std.mem.sliceAsBytes(lin.input_to_output_curve.knots)
+                );
+            },
+        }
+    }
+}
+
+/// true if a and b consist of the same mappings
+fn topology_eql(
+    a: topology_m.Topology,
+    b: topology_m.Topology,
+) bool
+{
+    if (a.mappings.len != b.mappings.len) {
+        return false;
+    }
+
+    for (a.mappings, b.mappings)
+        |a_m, b_m|
+    {
+        if (std.meta.activeTag(a_m) != std.meta.activeTag(b_m)) {
+            return false;
+        }
+
+        const same = switch (a_m) {
+            .empty => |e| std.meta.eql(e.defined_range, b_m.empty.defined_range),
+            .affine => |aff| std.meta.eql(aff, b_m.affine),
+            .linear => |lin| std.mem.eql(
+                u8,
+                std.mem.sliceAsBytes(lin.input_to_output_curve.knots),
+                std.mem.sliceAsBytes(b_m.linear.input_to_output_curve.knots),
+            ),
+        };
+        if (!same) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// hash of the media of ref, null if it has none
+fn destination_media_hash(
+    ref: core.ComposedValueRef,
+) ?u64
+{
+    const cl = switch (ref) {
+        .clip_ptr => |clip| clip,
+        else => return null,
+    };
+
+    var hasher = std.hash.Wyhash.init(0);
+    hash_media(&hasher, cl.media);
+    return hasher.final();
+}
+
+/// true if the two operators present the same media the same way over piece
+fn operators_eql(
+    allocator: std.mem.Allocator,
+    alignment: Alignment,
+    old_op: core.ProjectionOperator,
+    new_op: core.ProjectionOperator,
+    piece: opentime.ContinuousInterval,
+) !bool
+{
+    const paired = alignment.old_of(new_op.destination.ref) orelse return false;
+    if (
+        !std.meta.eql(paired, old_op.destination.ref)
+        or old_op.destination.label != new_op.destination.label
+    )
+    {
+        return false;
+    }
+
+    // a destination paired by name can still point at other media
+    if (
+        !std.meta.eql(
+            destination_media_hash(old_op.destination.ref),
+            destination_media_hash(new_op.destination.ref),
+        )
+    )
+    {
+        return false;
+    }
+
+    if (topology_eql(old_op.src_to_dst_topo, new_op.src_to_dst_topo)) {
+        return true;
+    }
+
+    // the segments of the two maps can be split differently, compare only
+    // the piece they share
+    const old_trimmed = try old_op.src_to_dst_topo.trim_in_input_space(
+        allocator,
+        piece,
+    );
+    defer old_trimmed.deinit(allocator);
+    const new_trimmed = try new_op.src_to_dst_topo.trim_in_input_space(
+        allocator,
+        piece,
+    );
+    defer new_trimmed.deinit(allocator);
+
+    return topology_eql(old_trimmed, new_trimmed);
+}
+
+/// index of the segment of end_points containing [piece_start, ...), moving
+/// cursor forward
+fn segment_for(
+    end_points: []const opentime.Ordinate,
+    cursor: *usize,
+    piece_start: opentime.Ordinate,
+) ?usize
+{
+    if (end_points.len < 2 or piece_start.lt(end_points[0])) {
+        return null;
+    }
+
+    while (
+        cursor.* + 1 < end_points.len
+        and end_points[cursor.* + 1].lteq(piece_start)
+    )
+    {
+        cursor.* += 1;
+    }
+
+    if (cursor.* + 1 >= end_points.len) {
+        return null;
+    }
+    return cursor.*;
+}
+
+/// Presentation ranges over which old_map and new_map differ, sorted and
+/// coalesced.  alignment pairs the objects of new_map with those of
+/// old_map.  Caller owns the result.
+pub fn changed_ranges(
+    allocator: std.mem.Allocator,
+    alignment: Alignment,
+    old_map: core.ProjectionOperatorMap,
+    new_map: core.ProjectionOperatorMap,
+) ![]opentime.ContinuousInterval
+{
+    // union of the end points of both maps
+    var points = std.ArrayList(opentime.Ordinate).init(allocator);
+    defer points.deinit();
+    {
+        var old_ind: usize = 0;
+        var new_ind: usize = 0;
+        while (
+            old_ind < old_map.end_points.len
+            or new_ind < new_map.end_points.len
+        )
+        {
+            const next = if (old_ind >= old_map.end_points.len)
+                new_map.end_points[new_ind]
+            else if (new_ind >= new_map.end_points.len)
+                old_map.end_points[old_ind]
+            else
+                opentime.min(
+                    old_map.end_points[old_ind],
+                    new_map.end_points[new_ind],
+                );
+
+            if (
+                old_ind < old_map.end_points.len
+                and old_map.end_points[old_ind].eql(next)
+            ) {
+                old_ind += 1;
+            }
+            if (
+                new_ind < new_map.end_points.len
+                and new_map.end_points[new_ind].eql(next)
+            ) {
+                new_ind += 1;
+            }
+
+            try points.append(next);
+        }
+    }
+
+    var changes = std.ArrayList(opentime.ContinuousInterval).init(allocator);
+    errdefer changes.deinit();
+
+    var old_cursor: usize = 0;
+    var new_cursor: usize = 0;
+
+    if (points.items.len > 1)
+    {
+        for (points.items[0..points.items.len - 1], points.items[1..])
+            |start, end|
+        {
+            const piece = opentime.ContinuousInterval{
+                .start = start,
+                .end = end,
+            };
+
+            const maybe_old_seg = segment_for(
+                old_map.end_points,
+                &old_cursor,
+                start,
+            );
+            const maybe_new_seg = segment_for(
+                new_map.end_points,
+                &new_cursor,
+                start,
+            );
+
+            const old_ops: []const core.ProjectionOperator = (
+                if (maybe_old_seg) |seg| old_map.operators[seg] else &.{}
+            );
+            const new_ops: []const core.ProjectionOperator = (
+                if (maybe_new_seg) |seg| new_map.operators[seg] else &.{}
+            );
+
+            var same = old_ops.len == new_ops.len;
+            if (same)
+            {
+                for (old_ops, new_ops)
+                    |old_op, new_op|
+                {
+                    if (
+                        !try operators_eql(
+                            allocator,
+                            alignment,
+                            old_op,
+                            new_op,
+                            piece,
+                        )
+                    )
+                    {
+                        same = false;
+                        break;
+                    }
+                }
+            }
+
+            if (same) {
+                continue;
+            }
+
+            if (
+                changes.items.len > 0
+                and changes.items[changes.items.len - 1].end.eql(start)
+            )
+            {
+                changes.items[changes.items.len - 1].end = end;
+            }
+            else
+            {
+                try changes.append(piece);
+            }
+        }
+    }
+
+    return try changes.toOwnedSlice();
+}
+
+/// Presentation ranges of new_timeline that differ from old_timeline.
+/// Caller owns the result.
+pub fn diff_timelines(
+    allocator: std.mem.Allocator,
+    old_timeline: *const schema.Timeline,
+    new_timeline: *const schema.Timeline,
+) ![]opentime.ContinuousInterval
+{
+    const old_ref = core.ComposedValueRef.init(old_timeline);
+    const new_ref = core.ComposedValueRef.init(new_timeline);
+
+    var alignment = try Alignment.init(allocator, old_ref, new_ref);
+    defer alignment.deinit();
+
+    const old_map = try topological_map_m.build_topological_map(
+        allocator,
+        old_ref,
+    );
+    defer old_map.deinit();
+    const old_po_map = try core.projection_map_to_media_from(
+        allocator,
+        old_map,
+        try old_ref.space(.presentation),
+    );
+    defer old_po_map.deinit();
+
+    const new_map = try topological_map_m.build_topological_map(
+        allocator,
+        new_ref,
+    );
+    defer new_map.deinit();
+    const new_po_map = try core.projection_map_to_media_from(
+        allocator,
+        new_map,
+        try new_ref.space(.presentation),
+    );
+    defer new_po_map.deinit();
+
+    return try changed_ranges(allocator, alignment, old_po_map, new_po_map);
+}
+
+test "timeline_diff: only the edited clip is changed"
+{
+    const allocator = std.testing.allocator;
+
+    const timeline_generator = @import("timeline_generator.zig");
+    const params = timeline_generator.Parameters{
+        .track_count = 2,
+        .clips_per_track = 16,
+        .gap_ratio = 0.25,
+        .warp_density = 0.5,
+        .seed = 99,
+    };
+
+    const old_gen = try timeline_generator.generate(allocator, params);
+    defer old_gen.deinit();
+    const new_gen = try timeline_generator.generate(allocator, params);
+    defer new_gen.deinit();
+
+    // identical revisions
+    {
+        const changes = try diff_timelines(
+            allocator,
+            old_gen.timeline,
+            new_gen.timeline,
+        );
+        defer allocator.free(changes);
+
+        try std.testing.expectEqual(0, changes.len);
+    }
+
+    // swap the media of one clip, keeping its name and timing
+    {
+        const swap_gen = try timeline_generator.generate(allocator, params);
+        defer swap_gen.deinit();
+
+        const clip = first_trimmed_clip(swap_gen.timeline) orelse {
+            return error.SkipZigTest;
+        };
+        clip.media.ref = .{ .external = .{ .target_uri = "swapped.mov" } };
+
+        const changes = try diff_timelines(
+            allocator,
+            old_gen.timeline,
+            swap_gen.timeline,
+        );
+        defer allocator.free(changes);
+
+        try std.testing.expect(changes.len > 0);
+
+        var changed_duration: opentime.Ordinate.BaseType = 0;
+        for (changes)
+            |change|
+        {
+            changed_duration += change.duration().as(
+                opentime.Ordinate.BaseType
+            );
+        }
+        try std.testing.expect(
+            changed_duration
+            <= clip.bounds_s.?.duration().as(opentime.Ordinate.BaseType)
+            + 1e-9
+        );
+    }
+
+    // slip the media of one clip, its duration and so the timing of the
+    // rest of the timeline stays the same
+    const clip = first_trimmed_clip(new_gen.timeline) orelse {
+        return error.SkipZigTest;
+    };
+    const bounds = clip.bounds_s.?;
+    clip.bounds_s = .{
+        .start = bounds.start.add(0.25),
+        .end = bounds.end.add(0.25),
+    };
+
+    var alignment = try Alignment.init(
+        allocator,
+        old_gen.ref(),
+        new_gen.ref(),
+    );
+    defer alignment.deinit();
+    try std.testing.expect(
+        content_hash(old_gen.ref()) != content_hash(new_gen.ref())
+    );
+
+    // the cache Alignment uses agrees with hashing from scratch
+    var hashes = HashCache{ .allocator = allocator };
+    defer hashes.deinit();
+    try std.testing.expectEqual(
+        content_hash(new_gen.ref()),
+        try hashes.child_hash(new_gen.ref()),
+    );
+    try std.testing.expect(
+        alignment.old_of(core.ComposedValueRef.init(clip)) != null
+    );
+
+    const changes = try diff_timelines(
+        allocator,
+        old_gen.timeline,
+        new_gen.timeline,
+    );
+    defer allocator.free(changes);
+
+    try std.testing.expect(changes.len > 0);
+
+    var changed_duration: opentime.Ordinate.BaseType = 0;
+    for (changes)
+        |change|
+    {
+        changed_duration += change.duration().as(opentime.Ordinate.BaseType);
+    }
+    try std.testing.expect(changed_duration > 0);
+    try std.testing.expect(
+        changed_duration
+        <= bounds.duration().as(opentime.Ordinate.BaseType) + 1e-9
+    );
+}
+
+/// the first clip with bounds on the first track of timeline
+fn first_trimmed_clip(
+    timeline: *schema.Timeline,
+) ?*schema.Clip
+{
+    const track = &timeline.tracks.children.items[0].track;
+    for (track.children.items)
+        |*child|
+    {
+        switch (child.*) {
+            .clip => |*cl| {
+                if (cl.bounds_s != null) {
+                    return cl;
+                }
+            },
+            else => {},
+        }
+    }
+    return null;
+}
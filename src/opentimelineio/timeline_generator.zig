@@ -0,0 +1,459 @@
+//! Synthetic timeline generator for scale testing.
+//!
+//! Builds reproducible timelines of arbitrary size from a fixed seed, with
+//! control over the number of tracks, clips per track, gaps, nesting and
+//! warps.  All storage for a generated timeline lives in a single arena so
+//! that very large documents (10^6 clips) can be torn down in O(1).
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+const topology_m = @import("topology");
+
+const schema = @import("schema.zig");
+const core = @import("core.zig");
+const topological_map_m = @import("topological_map.zig");
+
+/// knobs for the generator
+pub const Parameters = struct {
+    /// number of tracks in the top level stack of the timeline
+    track_count: usize = 1,
+    /// number of clips (not counting gaps) in every track
+    clips_per_track: usize = 10,
+    /// probability [0, 1] of inserting a gap before each clip
+    gap_ratio: f64 = 0,
+    /// number of nested Stack{Track{...}} levels appended to each track.
+    /// Every nested track is generated with the same parameters.
+    nesting_depth: usize = 0,
+    /// probability [0, 1] that a clip is wrapped in a warp
+    warp_density: f64 = 0,
+    /// number of knots in the bezier curve of each warp.  Less than 2
+    /// produces linear (constant speed) warps.
+    bezier_knots: usize = 0,
+    /// seed for the pseudo random number generator
+    seed: u64 = 0,
+
+    /// rate of the presentation space and clip media
+    rate_hz: u32 = 24,
+    /// shortest clip/gap in frames
+    min_item_frames: u32 = 12,
+    /// longest clip/gap in frames
+    max_item_frames: u32 = 240,
+    /// give every item a name ("clip_12", "gap_3"...)
+    with_names: bool = true,
+};
+
+/// counts of what was generated
+pub const Counts = struct {
+    tracks: usize = 0,
+    stacks: usize = 0,
+    clips: usize = 0,
+    gaps: usize = 0,
+    warps: usize = 0,
+};
+
+/// A generated timeline and the arena that owns all of its storage.
+pub const GeneratedTimeline = struct {
+    arena: *std.heap.ArenaAllocator,
+    timeline: *schema.Timeline,
+    counts: Counts,
+
+    /// reference to the timeline for building maps and operators
+    pub fn ref(
+        self: @This(),
+    ) core.ComposedValueRef
+    {
+        return core.ComposedValueRef.init(self.timeline);
+    }
+
+    /// free everything, including the timeline
+    pub fn deinit(
+        self: @This(),
+    ) void
+    {
+        const parent_allocator = self.arena.child_allocator;
+        self.arena.deinit();
+        parent_allocator.destroy(self.arena);
+    }
+};
+
+/// build a timeline in memory according to params.  The same params (and
+/// seed) always produce the same timeline.
+pub fn generate(
+    allocator: std.mem.Allocator,
+    params: Parameters,
+) !GeneratedTimeline
+{
+    if (
+        params.min_item_frames == 0
+        or params.min_item_frames > params.max_item_frames
+        or params.rate_hz == 0
+    )
+    {
+        return error.InvalidGeneratorParameters;
+    }
+
+    const arena = try allocator.create(std.heap.ArenaAllocator);
+    arena.* = std.heap.ArenaAllocator.init(allocator);
+    errdefer {
+        arena.deinit();
+        allocator.destroy(arena);
+    }
+
+    var prng = std.Random.DefaultPrng.init(params.seed);
+
+    var builder = Builder{
+        .allocator = arena.allocator(),
+        .random = prng.random(),
+        .params = params,
+    };
+
+    const tl = try builder.allocator.create(schema.Timeline);
+    tl.* = try schema.Timeline.init(builder.allocator);
+    tl.name = try builder.name("timeline", 0);
+    tl.discrete_info.presentation = .{
+        .sample_rate_hz = .{ .Int = params.rate_hz },
+    };
+
+    try tl.tracks.children.ensureTotalCapacity(params.track_count);
+    for (0..params.track_count)
+        |_|
+    {
+        try tl.tracks.append(try builder.track(0));
+    }
+
+    return .{
+        .arena = arena,
+        .timeline = tl,
+        .counts = builder.counts,
+    };
+}
+
+/// internal state of the generator
+const Builder = struct {
+    allocator: std.mem.Allocator,
+    random: std.Random,
+    params: Parameters,
+    counts: Counts = .{},
+
+    fn name(
+        self: *@This(),
+        comptime prefix: []const u8,
+        index: usize,
+    ) !?[]const u8
+    {
+        if (self.params.with_names == false) {
+            return null;
+        }
+
+        return try std.fmt.allocPrint(
+            self.allocator,
+            prefix ++ "_{d}",
+            .{ index },
+        );
+    }
+
+    /// random duration in seconds, in whole frames
+    fn duration(
+        self: *@This(),
+    ) opentime.Ordinate
+    {
+        const frames = self.random.intRangeAtMost(
+            u32,
+            self.params.min_item_frames,
+            self.params.max_item_frames,
+        );
+
+        return opentime.Ordinate.init(frames).div(self.params.rate_hz);
+    }
+
+    fn chance(
+        self: *@This(),
+        probability: f64,
+    ) bool
+    {
+        return probability > 0 and self.random.float(f64) < probability;
+    }
+
+    fn track(
+        self: *@This(),
+        depth: usize,
+    ) !schema.Track
+    {
+        var tr = schema.Track.init(self.allocator);
+        tr.name = try self.name("track", self.counts.tracks);
+        self.counts.tracks += 1;
+
+        try tr.children.ensureTotalCapacity(
+            self.params.clips_per_track
+            + @as(
+                usize,
+                @intFromFloat(
+                    @ceil(
+                        @as(f64, @floatFromInt(self.params.clips_per_track))
+                        * std.math.clamp(self.params.gap_ratio, 0, 1)
+                    )
+                ),
+            )
+            + 1
+        );
+
+        for (0..self.params.clips_per_track)
+            |_|
+        {
+            if (self.chance(self.params.gap_ratio))
+            {
+                try tr.append(
+                    schema.Gap{
+                        .name = try self.name("gap", self.counts.gaps),
+                        .duration_seconds = self.duration(),
+                    }
+                );
+                self.counts.gaps += 1;
+            }
+
+            const cl = try self.clip();
+
+            if (self.chance(self.params.warp_density))
+            {
+                try tr.append(try self.warp(cl));
+            }
+            else
+            {
+                try tr.append(cl);
+            }
+        }
+
+        if (depth < self.params.nesting_depth)
+        {
+            var st = schema.Stack.init(self.allocator);
+            st.name = try self.name("stack", self.counts.stacks);
+            self.counts.stacks += 1;
+
+            try st.append(try self.track(depth + 1));
+            try tr.append(st);
+        }
+
+        return tr;
+    }
+
+    fn clip(
+        self: *@This(),
+    ) !schema.Clip
+    {
+        // start the cut somewhere in the first 1000 frames of the media
+        const start = opentime.Ordinate.init(
+            self.random.uintLessThan(u32, 1000)
+        ).div(self.params.rate_hz);
+
+        const result = schema.Clip{
+            .name = try self.name("clip", self.counts.clips),
+            .bounds_s = .{
+                .start = start,
+                .end = start.add(self.duration()),
+            },
+            .media = .{
+                .discrete_info = .{
+                    .sample_rate_hz = .{ .Int = self.params.rate_hz },
+                },
+            },
+        };
+        self.counts.clips += 1;
+
+        return result;
+    }
+
+    /// wrap child in a warp that plays it back at a random speed, either
+    /// linearly or along an eased bezier curve
+    fn warp(
+        self: *@This(),
+        child: schema.Clip,
+    ) !schema.Warp
+    {
+        const child_ptr = try self.allocator.create(schema.Clip);
+        child_ptr.* = child;
+
+        const child_range = child.bounds_s.?;
+
+        // speed in [0.5, 2)
+        const speed = 0.5 + self.random.float(f64) * 1.5;
+        const warp_range = opentime.ContinuousInterval{
+            .start = opentime.Ordinate.ZERO,
+            .end = child_range.duration().div(speed),
+        };
+
+        const xform = (
+            if (self.params.bezier_knots < 2) try (
+                topology_m.Topology.init_from_linear_monotonic(
+                    self.allocator,
+                    .{
+                        .knots = &.{
+                            .{
+                                .in = warp_range.start,
+                                .out = child_range.start,
+                            },
+                            .{
+                                .in = warp_range.end,
+                                .out = child_range.end,
+                            },
+                        },
+                    },
+                )
+            )
+            else try self.bezier_transform(warp_range, child_range)
+        );
+
+        const result = schema.Warp{
+            .name = try self.name("warp", self.counts.warps),
+            .child = core.ComposedValueRef.init(child_ptr),
+            .transform = xform,
+        };
+        self.counts.warps += 1;
+
+        return result;
+    }
+
+    /// a monotonically increasing bezier from input_range to output_range
+    /// with bezier_knots knots evenly spaced in input and randomly spaced in
+    /// output
+    fn bezier_transform(
+        self: *@This(),
+        input_range: opentime.ContinuousInterval,
+        output_range: opentime.ContinuousInterval,
+    ) !topology_m.Topology
+    {
+        const knot_count = self.params.bezier_knots;
+
+        // random positive weights for each span, normalized into the output
+        const weights = try self.allocator.alloc(f64, knot_count - 1);
+        defer self.allocator.free(weights);
+
+        var total: f64 = 0;
+        for (weights)
+            |*w|
+        {
+            w.* = 0.25 + self.random.float(f64);
+            total += w.*;
+        }
+
+        const segments = try self.allocator.alloc(
+            curve.Bezier.Segment,
+            knot_count - 1,
+        );
+        defer self.allocator.free(segments);
+
+        const in_step = input_range.duration().div(knot_count - 1);
+        const out_duration = output_range.duration();
+
+        var p0 = curve.ControlPoint{
+            .in = input_range.start,
+            .out = output_range.start,
+        };
+        for (segments, weights, 1..)
+            |*seg, w, ind|
+        {
+            const p3 = curve.ControlPoint{
+                .in = (
+                    if (ind == knot_count - 1) input_range.end
+                    else input_range.start.add(in_step.mul(ind))
+                ),
+                .out = (
+                    if (ind == knot_count - 1) output_range.end
+                    else p0.out.add(out_duration.mul(w / total))
+                ),
+            };
+            const third = p3.in.sub(p0.in).div(3);
+
+            // ease in/out: tangents are flat at each knot, so each segment
+            // (and the curve) stays monotonic
+            seg.* = .{
+                .p0 = p0,
+                .p1 = .{ .in = p0.in.add(third), .out = p0.out },
+                .p2 = .{ .in = p3.in.sub(third), .out = p3.out },
+                .p3 = p3,
+            };
+
+            p0 = p3;
+        }
+
+        return try topology_m.Topology.init_bezier(
+            self.allocator,
+            segments,
+        );
+    }
+};
+
+test "timeline_generator: counts and determinism"
+{
+    const params = Parameters{
+        .track_count = 3,
+        .clips_per_track = 20,
+        .gap_ratio = 0.25,
+        .nesting_depth = 2,
+        .warp_density = 0.2,
+        .seed = 1234,
+    };
+
+    const fst = try generate(std.testing.allocator, params);
+    defer fst.deinit();
+
+    const snd = try generate(std.testing.allocator, params);
+    defer snd.deinit();
+
+    // every nested level repeats the clips of the track above it
+    try std.testing.expectEqual(3 * 20 * 3, fst.counts.clips);
+    try std.testing.expectEqual(3 * 3, fst.counts.tracks);
+    try std.testing.expectEqual(3 * 2, fst.counts.stacks);
+
+    try std.testing.expectEqual(fst.counts, snd.counts);
+
+    const fst_bounds = try fst.ref().bounds_of(
+        std.testing.allocator,
+        .presentation,
+    );
+    const snd_bounds = try snd.ref().bounds_of(
+        std.testing.allocator,
+        .presentation,
+    );
+    try opentime.expectOrdinateEqual(fst_bounds.end, snd_bounds.end);
+}
+
+test "timeline_generator: projection through generated warps"
+{
+    const allocator = std.testing.allocator;
+
+    inline for (&.{ 0, 4 })
+        |knots|
+    {
+        const gen = try generate(
+            allocator,
+            .{
+                .track_count = 1,
+                .clips_per_track = 8,
+                .warp_density = 1,
+                .bezier_knots = knots,
+                .seed = 7,
+            },
+        );
+        defer gen.deinit();
+
+        try std.testing.expectEqual(8, gen.counts.warps);
+
+        const map = try topological_map_m.build_topological_map(
+            allocator,
+            gen.ref(),
+        );
+        defer map.deinit();
+
+        const proj_map = try core.projection_map_to_media_from(
+            allocator,
+            map,
+            try gen.ref().space(.presentation),
+        );
+        defer proj_map.deinit();
+
+        // one segment per warp, plus any splits from the bezier pieces
+        try std.testing.expect(proj_map.end_points.len >= 9);
+    }
+}
@@ -8,8 +8,11 @@ const string = @import("string_stuff");
 const schema = @import("schema.zig");
 const core = @import("core.zig");
 const topology_m = @import("topology");
+const allocation_tracker = @import("allocation_tracker");
+const tracing = @import("tracing");
 
 /// for VERY LARGE files, turn this off so that dot can process the graphs
+/// (default for DotGraphOptions.binary_treecode_labels)
 const LABEL_HAS_BINARY_TREECODE = true;
 
 /// annotate the graph algorithms
@@ -24,6 +27,67 @@ const T_CTI_1_10 = opentime.ContinuousInterval {
     .end = T_ORD_10,
 };
 
+/// occupancy and probe lengths of a std.HashMap
+pub const HashMapStats = struct {
+    count: usize = 0,
+    capacity: usize = 0,
+    /// count / capacity
+    load_factor: f64 = 0,
+    /// distance of an entry from the slot its hash maps to.  std.HashMap
+    /// probes linearly, so this is the number of extra slots a lookup of
+    /// that entry has to look at.
+    max_probe_length: usize = 0,
+    mean_probe_length: f64 = 0,
+
+    /// measure a (managed) std.HashMap
+    pub fn init(
+        map: anytype,
+    ) HashMapStats
+    {
+        const capacity: usize = map.capacity();
+
+        var result = HashMapStats{
+            .count = map.count(),
+            .capacity = capacity,
+        };
+
+        if (capacity == 0 or result.count == 0) {
+            return result;
+        }
+
+        result.load_factor = (
+            @as(f64, @floatFromInt(result.count))
+            / @as(f64, @floatFromInt(capacity))
+        );
+
+        // the iterator walks the slots in order and leaves `index` one past
+        // the slot of the entry it returned
+        const mask = capacity - 1;
+        var total_probe_length: usize = 0;
+        var iter = map.unmanaged.iterator();
+        while (iter.next())
+            |entry|
+        {
+            const slot: usize = iter.index - 1;
+            const home: usize = @truncate(map.ctx.hash(entry.key_ptr.*) & mask);
+            const probe_length = (slot -% home) & mask;
+
+            total_probe_length += probe_length;
+            result.max_probe_length = @max(
+                result.max_probe_length,
+                probe_length,
+            );
+        }
+
+        result.mean_probe_length = (
+            @as(f64, @floatFromInt(total_probe_length))
+            / @as(f64, @floatFromInt(result.count))
+        );
+
+        return result;
+    }
+};
+
 /// Topological Map of a Timeline.  Can be used to build projection operators
 /// to transform between various coordinate spaces within the map.
 pub const TopologicalMap = struct {
@@ -33,6 +97,31 @@ pub const TopologicalMap = struct {
     ),
     map_code_to_space:treecode.TreecodeHashMap(core.SpaceReference),
 
+    /// the spaces of the map, indexed by SpaceId
+    nodes: std.MultiArrayList(SpaceNode) = .{},
+    map_space_to_id: std.AutoHashMap(core.SpaceReference, SpaceId),
+    allocator: std.mem.Allocator,
+
+    /// dense index of a space in the map, assigned in build order.  Look one
+    /// up once with space_id, then walk the map by indexing.
+    pub const SpaceId = u32;
+
+    /// per space data, stored as parallel arrays in nodes
+    pub const SpaceNode = struct {
+        space: core.SpaceReference,
+        /// the code owned by map_space_to_code
+        code: treecode.Treecode,
+        parent: ?SpaceId = null,
+        /// children by the next step of their treecode
+        children: [2]?SpaceId = .{ null, null },
+    };
+
+    /// one step along a path through the map
+    pub const PathStep = struct {
+        id: SpaceId,
+        step: u1,
+    };
+
     pub fn init(
         allocator: std.mem.Allocator,
     ) !TopologicalMap 
@@ -45,6 +134,11 @@ pub const TopologicalMap = struct {
             .map_code_to_space = treecode.TreecodeHashMap(
                 core.SpaceReference,
             ).init(allocator),
+            .map_space_to_id = std.AutoHashMap(
+                core.SpaceReference,
+                SpaceId,
+            ).init(allocator),
+            .allocator = allocator,
         };
     }
 
@@ -76,6 +170,174 @@ pub const TopologicalMap = struct {
         // free the guts
         mutable_self.map_space_to_code.deinit();
         mutable_self.map_code_to_space.deinit();
+        mutable_self.map_space_to_id.deinit();
+        mutable_self.nodes.deinit(self.allocator);
+    }
+
+    /// add a space to the map at a copy of code
+    fn insert_space(
+        self: *@This(),
+        space_ref: core.SpaceReference,
+        code: treecode.Treecode,
+    ) !void
+    {
+        const space_code = try code.clone();
+        try self.map_space_to_code.put(space_ref, space_code);
+        try self.map_code_to_space.put(try code.clone(), space_ref);
+
+        const id: SpaceId = @intCast(self.nodes.len);
+        try self.nodes.append(
+            self.allocator,
+            .{
+                .space = space_ref,
+                .code = space_code,
+            },
+        );
+        try self.map_space_to_id.put(space_ref, id);
+    }
+
+    /// fill in the parent and children of every node once all of the spaces
+    /// have been inserted
+    fn link_spaces(
+        self: *@This(),
+    ) !void
+    {
+        const codes = self.nodes.items(.code);
+        const parents = self.nodes.items(.parent);
+        const children = self.nodes.items(.children);
+
+        for (codes, 0..)
+            |code, parent_id|
+        {
+            for ([_]u1{ 0, 1 })
+                |step|
+            {
+                var child_code = try code.clone();
+                defer child_code.deinit();
+                try child_code.append(step);
+
+                const child_space = (
+                    self.map_code_to_space.get(child_code) orelse continue
+                );
+                const child_id = self.map_space_to_id.get(child_space).?;
+
+                children[parent_id][step] = child_id;
+                parents[child_id] = @intCast(parent_id);
+            }
+        }
+    }
+
+    /// the id of space in this map, if it is in the map
+    pub fn space_id(
+        self: @This(),
+        space: core.SpaceReference,
+    ) ?SpaceId
+    {
+        return self.map_space_to_id.get(space);
+    }
+
+    /// the space with the given id
+    pub fn space_of(
+        self: @This(),
+        id: SpaceId,
+    ) core.SpaceReference
+    {
+        return self.nodes.items(.space)[id];
+    }
+
+    /// the treecode of the space with the given id
+    pub fn code_of(
+        self: @This(),
+        id: SpaceId,
+    ) treecode.Treecode
+    {
+        return self.nodes.items(.code)[id];
+    }
+
+    /// the id of the parent of the space with the given id, null for the root
+    pub fn parent_of(
+        self: @This(),
+        id: SpaceId,
+    ) ?SpaceId
+    {
+        return self.nodes.items(.parent)[id];
+    }
+
+    /// the next space on the path from `from` down to `to`, or null if they
+    /// are the same space.  `to` must be below `from`.
+    pub fn next_step_towards(
+        self: @This(),
+        from: SpaceId,
+        to: SpaceId,
+    ) !?PathStep
+    {
+        if (from == to) {
+            return null;
+        }
+
+        const codes = self.nodes.items(.code);
+        const step = try codes[from].next_step_towards(codes[to]);
+
+        return .{
+            .id = (
+                self.nodes.items(.children)[from][step] 
+                orelse return error.TreeCodeNotInMap
+            ),
+            .step = step,
+        };
+    }
+
+    /// size summary of a TopologicalMap, see stats()
+    pub const Stats = struct {
+        /// number of spaces in the map
+        node_count: usize = 0,
+        /// longest treecode (in steps from the root) of any space
+        max_code_length: usize = 0,
+        mean_code_length: f64 = 0,
+        map_space_to_code: HashMapStats = .{},
+        map_code_to_space: HashMapStats = .{},
+        map_space_to_id: HashMapStats = .{},
+        /// SpaceNodes allocated in nodes
+        nodes_capacity: usize = 0,
+        /// bytes allocated for nodes
+        nodes_bytes: usize = 0,
+    };
+
+    /// measure the size of the map and the health of its hash maps
+    pub fn stats(
+        self: @This(),
+    ) Stats
+    {
+        var result = Stats{
+            .node_count = self.map_code_to_space.count(),
+            .map_space_to_code = HashMapStats.init(&self.map_space_to_code),
+            .map_code_to_space = HashMapStats.init(&self.map_code_to_space),
+            .map_space_to_id = HashMapStats.init(&self.map_space_to_id),
+            .nodes_capacity = self.nodes.capacity,
+            .nodes_bytes = std.MultiArrayList(SpaceNode).capacityInBytes(
+                self.nodes.capacity
+            ),
+        };
+
+        var total_code_length: usize = 0;
+        var code_iter = self.map_code_to_space.keyIterator();
+        while (code_iter.next())
+            |code|
+        {
+            const len = code.code_length();
+            total_code_length += len;
+            result.max_code_length = @max(result.max_code_length, len);
+        }
+
+        if (result.node_count > 0)
+        {
+            result.mean_code_length = (
+                @as(f64, @floatFromInt(total_code_length))
+                / @as(f64, @floatFromInt(result.node_count))
+            );
+        }
+
+        return result;
     }
 
     /// return the root space of this topological map
@@ -99,171 +361,217 @@ pub const TopologicalMap = struct {
     }
 
     /// build a projection operator that projects from the endpoints.source to
-    /// endpoints.destination spaces
+    /// endpoints.destination spaces.  Projecting up the tree through a
+    /// Topology that is not monotonic is multi valued and returns
+    /// error.MultiValuedProjection, use build_multi_projection_operator for
+    /// those.
     pub fn build_projection_operator(
         self: @This(),
         allocator: std.mem.Allocator,
         endpoints_arg: core.ProjectionOperatorEndPoints,
     ) !core.ProjectionOperator 
     {
-        const path_info_ = try self.path_info( endpoints_arg);
-        const endpoints = path_info_.endpoints;
+        const span = tracing.begin("build_projection_operator");
+        defer span.end();
 
-        var root_to_current = (
-            try topology_m.Topology.init_identity_infinite(allocator)
-        );
+        const path = try self.build_path_topology(allocator, endpoints_arg);
 
-        if (GRAPH_CONSTRUCTION_TRACE_MESSAGES) {
-            opentime.dbg_print(@src(), 
-                "[START] root_to_current: {s}\n",
-                .{ root_to_current }
+        if (path.inverted == false or path.topology.mappings.len == 0)
+        {
+            return .{
+                .source = endpoints_arg.source,
+                .destination = endpoints_arg.destination,
+                .src_to_dst_topo = path.topology,
+            };
+        }
+
+        const inverted_topologies = blk: {
+            defer path.topology.deinit(allocator);
+            break :blk try path.topology.inverted(allocator);
+        };
+
+        if (inverted_topologies.len != 1)
+        {
+            opentime.deinit_slice(
+                allocator,
+                topology_m.Topology,
+                inverted_topologies
             );
+            return error.MultiValuedProjection;
         }
 
-        var iter = (
-            try TreenodeWalkingIterator.init_from_to(
+        defer allocator.free(inverted_topologies);
+
+        return .{
+            .source = endpoints_arg.source,
+            .destination = endpoints_arg.destination,
+            .src_to_dst_topo = inverted_topologies[0],
+        };
+    }
+
+    /// build a projection operator from endpoints.source to
+    /// endpoints.destination that may be multi valued, which is the case
+    /// when projecting up the tree (ie media -> presentation) through a
+    /// Topology that is not monotonic, like a reversing warp.
+    pub fn build_multi_projection_operator(
+        self: @This(),
+        allocator: std.mem.Allocator,
+        endpoints_arg: core.ProjectionOperatorEndPoints,
+    ) !core.MultiProjectionOperator 
+    {
+        const span = tracing.begin("build_multi_projection_operator");
+        defer span.end();
+
+        const path = try self.build_path_topology(allocator, endpoints_arg);
+
+        if (path.inverted == false or path.topology.mappings.len == 0)
+        {
+            const pieces = allocator.alloc(topology_m.Topology, 1) catch |err| {
+                path.topology.deinit(allocator);
+                return err;
+            };
+            pieces[0] = path.topology;
+            errdefer opentime.deinit_slice(
                 allocator,
-                &self,
-                endpoints,
-            )
-        );
-        defer iter.deinit();
+                topology_m.Topology,
+                pieces
+            );
+
+            return .{
+                .source = endpoints_arg.source,
+                .destination = endpoints_arg.destination,
+                .src_to_dst = try topology_m.MultiTopology.init(
+                    allocator,
+                    pieces,
+                ),
+            };
+        }
+
+        defer path.topology.deinit(allocator);
+
+        return .{
+            .source = endpoints_arg.source,
+            .destination = endpoints_arg.destination,
+            .src_to_dst = try topology_m.MultiTopology.init_inverted(
+                allocator,
+                path.topology,
+            ),
+        };
+    }
+
+    /// the topology along the path between two spaces, walked from the
+    /// higher of the two spaces in the tree
+    const PathTopology = struct {
+        /// maps the higher space to the lower one
+        topology: topology_m.Topology,
+        /// true if the requested endpoints were swapped
+        inverted: bool,
+    };
 
-        _ = try iter.next();
+    /// join the transformations along the path between the endpoints.  The
+    /// topology of the result is owned by the caller.
+    fn build_path_topology(
+        self: @This(),
+        allocator: std.mem.Allocator,
+        endpoints_arg: core.ProjectionOperatorEndPoints,
+    ) !PathTopology
+    {
+        const path = try self.path_ids(endpoints_arg);
 
-        var current = iter.maybe_current.?;
+        const spaces = self.nodes.items(.space);
+
+        var root_to_current = (
+            try topology_m.Topology.init_identity_infinite(allocator)
+        );
+        errdefer root_to_current.deinit(allocator);
 
         if (GRAPH_CONSTRUCTION_TRACE_MESSAGES) {
             opentime.dbg_print(@src(), 
-                "starting walk from: {s} to: {s}\n"
-                ++ "starting projection: {s}\n"
-                ,
+                "starting walk from: {s} to: {s}\n",
                 .{
-                    current,
-                    endpoints.destination,
-                    root_to_current,
+                    spaces[path.source],
+                    spaces[path.destination],
                 }
             );
         }
 
-        // walk from current_code towards destination_code
-        while (try iter.next()) 
-        {
-            const next = (
-                iter.maybe_current orelse return error.TreeCodeNotInMap
-            );
-
-            const next_step = try current.code.next_step_towards(next.code);
-
-            if (GRAPH_CONSTRUCTION_TRACE_MESSAGES) { 
-                opentime.dbg_print(@src(), 
-                    "  next step {b} towards next node: {s}\n"
-                    ,
-                    .{ next_step, next }
-                );
-            }
-
-            // in case build_transform errors
-            errdefer root_to_current.deinit(allocator);
+        // reused by every join along the path
+        var scratch = topology_m.JoinScratch.init(allocator);
+        defer scratch.deinit();
 
-            var current_to_next = (
-                try current.space.ref.build_transform(
+        // walk from the source down towards the destination
+        var current = path.source;
+        while (try self.next_step_towards(current, path.destination))
+            |next|
+        {
+            const current_to_next = (
+                try spaces[current].ref.build_transform(
                     allocator,
-                    current.space.label,
-                    next.space,
-                    next_step
+                    spaces[current].label,
+                    spaces[next.id],
+                    next.step,
                 )
             );
             defer current_to_next.deinit(allocator);
 
-            if (GRAPH_CONSTRUCTION_TRACE_MESSAGES) 
-            {
-                opentime.dbg_print(@src(), 
-                    "    joining!\n"
-                    ++ "    a2b/root_to_current: {s}\n"
-                    ++ "    b2c/current_to_next: {s}\n"
-                    ,
-                    .{
-                        root_to_current,
-                        current_to_next,
-                    },
-                );
-            }
-
             const root_to_next = try topology_m.join(
                 allocator,
                 .{
                     .a2b = root_to_current,
                     .b2c = current_to_next,
+                    .scratch = &scratch,
                 },
             );
 
             if (GRAPH_CONSTRUCTION_TRACE_MESSAGES) 
             {
                 opentime.dbg_print(@src(), 
-                    "    root_to_next: {s}\n",
-                    .{root_to_next}
-                );
-                const i_b = root_to_next.input_bounds();
-                const o_b = root_to_next.output_bounds();
-
-                opentime.dbg_print(@src(), 
-                    "    root_to_next (next root to current!): {s}\n"
-                    ++ "    composed transform ranges {s}: {s},"
-                    ++ " {s}: {s}\n"
-                    ,
+                    "  {s} -> {s}: {s}\n",
                     .{
+                        spaces[current],
+                        spaces[next.id],
                         root_to_next,
-                        iter.maybe_source.?.space,
-                        i_b,
-                        next.space,
-                        o_b,
                     },
                 );
             }
+
             root_to_current.deinit(allocator);
 
-            current = next;
+            current = next.id;
             root_to_current = root_to_next;
         }
 
-        // check to see if end points were inverted
-        if (path_info_.inverted and root_to_current.mappings.len > 0) 
-        {
-            // const old_proj = root_to_current;
-            const inverted_topologies = (
-                try root_to_current.inverted(allocator)
-            );
-            defer allocator.free(inverted_topologies);
-            root_to_current.deinit(allocator);
-            errdefer opentime.deinit_slice(
-                allocator,
-                topology_m.Topology,
-                inverted_topologies
-            );
-            if (inverted_topologies.len > 1)
-            {
-                return error.MoreThanOneCurveIsNotImplemented;
-            }
-            if (inverted_topologies.len > 0) {
-                root_to_current = inverted_topologies[0];
-            }
-            else {
-                return error.NoInvertedTopologies;
-            }
-        }
-
         return .{
-            .source = endpoints.source,
-            .destination = endpoints.destination,
-            .src_to_dst_topo = root_to_current,
+            .topology = root_to_current,
+            .inverted = path.inverted,
         };
     }
 
+    /// options for write_dot and write_dot_graph_with_options
+    pub const DotGraphOptions = struct {
+        /// only write this space and the spaces below it.  null is the root.
+        focus: ?core.SpaceReference = null,
+        /// only write spaces at most this many steps below focus.  Spaces
+        /// whose children were cut off are drawn dashed.
+        max_depth: ?usize = null,
+        /// put the binary treecode in the node names.  The treecode grows
+        /// with the depth of the map; the short hash keeps VERY LARGE graphs
+        /// processable by dot.
+        binary_treecode_labels: bool = LABEL_HAS_BINARY_TREECODE,
+        /// write a point node for every empty child slot
+        empty_children: bool = true,
+        /// after writing the .dot file, render "<filepath>.png" with the
+        /// graphviz configured at build time (if any)
+        render_png: bool = true,
+    };
+
     /// write a graphviz (dot) format serialization of this TopologicalMap
+    /// and render it to png.  Does nothing if graphviz was not configured
+    /// at build time, see write_dot_graph_with_options to write the .dot file
+    /// regardless.
     pub fn write_dot_graph(
         self:@This(),
-        parent_allocator: std.mem.Allocator,
+        allocator: std.mem.Allocator,
         filepath: string.latin_s8,
     ) !void 
     {
@@ -271,188 +579,247 @@ pub const TopologicalMap = struct {
             return;
         }
 
-        const root_space = self.root(); 
-        
-        // note that this function is pretty sloppy with allocations.  it
-        // doesn't do any cleanup until the function ends, when the entire var
-        // arena is cleared in one shot.
-        var arena = std.heap.ArenaAllocator.init(
-            parent_allocator
-        );
-        defer arena.deinit();
-        const allocator = arena.allocator();
+        try self.write_dot_graph_with_options(allocator, filepath, .{});
+    }
+
+    /// write a graphviz (dot) format serialization of this TopologicalMap to
+    /// filepath through a buffered writer, optionally rendering it to png
+    pub fn write_dot_graph_with_options(
+        self:@This(),
+        allocator: std.mem.Allocator,
+        filepath: string.latin_s8,
+        options: DotGraphOptions,
+    ) !void 
+    {
+        {
+            const file = try std.fs.createFileAbsolute(
+                filepath,
+                .{}
+            );
+            defer file.close();
+
+            var buffered = std.io.bufferedWriter(file.writer());
+            try self.write_dot(allocator, buffered.writer(), options);
+            try buffered.flush();
+        }
+
+        if (!options.render_png or build_options.graphviz_dot_path == null) {
+            return;
+        }
 
-        var buf = std.ArrayList(u8).init(allocator);
+        const pngfilepath = try std.fmt.allocPrint(
+            allocator,
+            "{s}.png",
+            .{ filepath }
+        );
+        defer allocator.free(pngfilepath);
 
-        // open the file
-        const file = try std.fs.createFileAbsolute(
+        const arg = &[_][]const u8{
+            // fetched from build configuration
+            build_options.graphviz_dot_path.?,
+            "-Tpng",
             filepath,
-            .{}
+            "-o",
+            pngfilepath,
+        };
+
+        // render to png
+        const result = try std.process.Child.run(
+            .{
+                .allocator = allocator,
+                .argv = arg,
+            }
         );
-        defer file.close();
+        allocator.free(result.stdout);
+        allocator.free(result.stderr);
+    }
 
-        try file.writeAll("digraph OTIO_TopologicalMap {\n");
+    /// stream a graphviz (dot) format serialization of this TopologicalMap
+    /// into writer, which should be buffered.  Labels are formatted straight
+    /// into the writer, so the only memory held is the walk stack, which is
+    /// bounded by the depth of the written subtree rather than the size of
+    /// the map.
+    pub fn write_dot(
+        self: @This(),
+        allocator: std.mem.Allocator,
+        writer: anytype,
+        options: DotGraphOptions,
+    ) !void
+    {
+        const focus = options.focus orelse self.root();
+        const focus_code = (
+            self.map_space_to_code.get(focus) 
+            orelse return error.SpaceNotInMap
+        );
 
         const Node = struct {
             space: core.SpaceReference,
             code: treecode.Treecode,
+            depth: usize,
         };
 
         var stack = std.ArrayList(Node).init(allocator);
-
-        try stack.append(
-            .{
-                .space = root_space,
-                .code = try treecode.Treecode.init_word(
-                    allocator,
-                    treecode.ROOT_TREECODE,
-                )
+        defer {
+            for (stack.items)
+                |node|
+            {
+                node.code.deinit();
             }
-        );
+            stack.deinit();
+        }
+
+        {
+            const code = try focus_code.clone();
+            stack.append(
+                .{
+                    .space = focus,
+                    .code = code,
+                    .depth = 0,
+                }
+            ) catch |err| {
+                code.deinit();
+                return err;
+            };
+        }
+
+        try writer.writeAll("digraph OTIO_TopologicalMap {\n");
 
         while (stack.items.len > 0) 
         {
             const current = stack.pop();
-            const current_label = try label_for_node_leaky(
-                allocator,
-                current.space,
-                current.code
-            );
+            defer current.code.deinit();
 
-            // left
-            {
-                var left = try current.code.clone();
-                try left.append(0);
+            const current_label = NodeLabel{
+                .ref = current.space,
+                .code = current.code,
+                .binary_treecode = options.binary_treecode_labels,
+            };
 
-                if (self.map_code_to_space.get(left)) 
-                    |next| 
-                {
-                    const next_label = try label_for_node_leaky(
-                        allocator,
-                        next,
-                        left
-                    );
-                    try file.writeAll(
-                        try std.fmt.allocPrint(
-                            allocator,
-                            "  {s} -> {s}\n",
-                            .{current_label, next_label}
-                        )
-                    );
-                    try stack.append(
-                        .{
-                            .space = next,
-                            .code = left
-                        }
-                    );
-                } 
-                else 
+            if (options.max_depth)
+                |max_depth|
+            {
+                if (current.depth >= max_depth)
                 {
-                    buf.clearAndFree();
-                    try left.to_str(&buf);
-
-                    try file.writeAll(
-                        try std.fmt.allocPrint(
-                            allocator,
-                            "  {s} \n  [shape=point]{s} -> {s}\n",
-                            .{buf.items, current_label, buf.items }
-                        )
-                    );
+                    if (try self.has_children(current.code)) {
+                        try writer.print(
+                            "  {} [style=dashed]\n",
+                            .{ current_label }
+                        );
+                    }
+                    continue;
                 }
             }
 
-            // right
+            for ([_]u1{ 0, 1 })
+                |step|
             {
-                var right = try current.code.clone();
-                try right.append(1);
+                var child_code = try current.code.clone();
+                child_code.append(step) catch |err| {
+                    child_code.deinit();
+                    return err;
+                };
 
-                if (self.map_code_to_space.get(right)) 
-                    |next| 
+                if (self.map_code_to_space.get(child_code)) 
+                    |child| 
                 {
-                    const next_label = try label_for_node_leaky(
-                        allocator,
-                        next,
-                        right
-                    );
-                    try file.writeAll(
-                        try std.fmt.allocPrint(
-                            allocator,
-                            "  {s} -> {s}\n",
-                            .{current_label, next_label},
-                        )
-                    );
-                    try stack.append(
+                    // the stack owns child_code from here on
+                    stack.append(
+                        .{
+                            .space = child,
+                            .code = child_code,
+                            .depth = current.depth + 1,
+                        }
+                    ) catch |err| {
+                        child_code.deinit();
+                        return err;
+                    };
+
+                    try writer.print(
+                        "  {} -> {}\n",
                         .{
-                            .space = next,
-                            .code = right
+                            current_label,
+                            NodeLabel{
+                                .ref = child,
+                                .code = child_code,
+                                .binary_treecode = (
+                                    options.binary_treecode_labels
+                                ),
+                            },
                         }
                     );
                 } 
                 else 
                 {
-                    buf.clearAndFree();
-                    try right.to_str(&buf);
-                    try file.writeAll(
-                        try std.fmt.allocPrint(
-                            allocator,
-                            "  {s} [shape=point]\n  {s} -> {s}\n",
-                            .{buf.items, current_label, buf.items}
-                        )
-                    );
+                    defer child_code.deinit();
+
+                    if (options.empty_children)
+                    {
+                        const point = PointLabel{
+                            .code = child_code,
+                            .binary_treecode = (
+                                options.binary_treecode_labels
+                            ),
+                        };
+                        try writer.print(
+                            "  {} [shape=point]\n  {} -> {}\n",
+                            .{ point, current_label, point }
+                        );
+                    }
                 }
             }
         }
 
-        try file.writeAll("}\n");
+        try writer.writeAll("}\n");
+    }
 
-        const pngfilepath = try std.fmt.allocPrint(
-            allocator,
-            "{s}.png",
-            .{ filepath }
-        );
-        defer allocator.free(pngfilepath);
+    /// true if the space at code has at least one child in the map
+    fn has_children(
+        self: @This(),
+        code: treecode.Treecode,
+    ) !bool
+    {
+        for ([_]u1{ 0, 1 })
+            |step|
+        {
+            var child_code = try code.clone();
+            defer child_code.deinit();
 
-        const arg = &[_][]const u8{
-            // fetched from build configuration
-            build_options.graphviz_dot_path.?,
-            "-Tpng",
-            filepath,
-            "-o",
-            pngfilepath,
-        };
+            try child_code.append(step);
 
-        // render to png
-        const result = try std.process.Child.run(
-            .{
-                .allocator = allocator,
-                .argv = arg,
+            if (self.map_code_to_space.contains(child_code)) {
+                return true;
             }
-        );
-        _ = result;
+        }
+
+        return false;
     }
 
-    pub fn path_info(
+    /// the ids of the endpoints of a path, ordered so that the path walks
+    /// down the tree from source to destination
+    pub const PathIds = struct {
+        source: SpaceId,
+        destination: SpaceId,
+        /// true if the requested endpoints were swapped
+        inverted: bool,
+    };
+
+    /// look up the endpoints once and order them for a walk down the tree
+    pub fn path_ids(
         self: @This(),
         endpoints: core.ProjectionOperatorEndPoints,
-    ) !struct {
-        endpoints: core.ProjectionOperatorEndPoints,
-        inverted: bool,
-    }
+    ) !PathIds
     {
-        var source_code = (
-            if (self.map_space_to_code.get(endpoints.source)) 
-            |code| 
-            code
-            else return error.SourceNotInMap
+        const source = (
+            self.space_id(endpoints.source) orelse return error.SourceNotInMap
         );
-
-        var destination_code = (
-            if (self.map_space_to_code.get(endpoints.destination)) 
-            |code| 
-            code
-            else return error.DestinationNotInMap
+        const destination = (
+            self.space_id(endpoints.destination) 
+            orelse return error.DestinationNotInMap
         );
 
+        const source_code = self.code_of(source);
+        const destination_code = self.code_of(destination);
+
         if (
             treecode.path_exists(
                 source_code,
@@ -474,23 +841,36 @@ pub const TopologicalMap = struct {
         if (source_code.code_length() > destination_code.code_length())
         {
             return .{
+                .source = destination,
+                .destination = source,
                 .inverted = true,
-                .endpoints = .{
-                    .source = endpoints.destination,
-                    .destination = endpoints.source,
-                },
-            };
-        }
-        else 
-        {
-            return .{
-                .inverted = false,
-                .endpoints = .{
-                    .source = endpoints.source,
-                    .destination = endpoints.destination,
-                },
             };
         }
+
+        return .{
+            .source = source,
+            .destination = destination,
+            .inverted = false,
+        };
+    }
+
+    pub fn path_info(
+        self: @This(),
+        endpoints: core.ProjectionOperatorEndPoints,
+    ) !struct {
+        endpoints: core.ProjectionOperatorEndPoints,
+        inverted: bool,
+    }
+    {
+        const ids = try self.path_ids(endpoints);
+
+        return .{
+            .inverted = ids.inverted,
+            .endpoints = .{
+                .source = self.space_of(ids.source),
+                .destination = self.space_of(ids.destination),
+            },
+        };
     }
 
     /// build a projection operator that projects from the args.source to
@@ -574,6 +954,9 @@ pub fn build_topological_map(
     root_item: core.ComposedValueRef,
 ) !TopologicalMap 
 {
+    const span = tracing.begin("build_topological_map");
+    defer span.end();
+
     var tmp_topo_map = try TopologicalMap.init(allocator);
     errdefer tmp_topo_map.deinit();
 
@@ -661,14 +1044,7 @@ pub fn build_topological_map(
                         }
                     );
                 }
-                try tmp_topo_map.map_space_to_code.put(
-                    space_ref,
-                    try child_code.clone(),
-                );
-                try tmp_topo_map.map_code_to_space.put(
-                    try child_code.clone(),
-                    space_ref
-                );
+                try tmp_topo_map.insert_space(space_ref, child_code);
 
                 if (index == (spaces.len - 1)) {
                     current_code.deinit();
@@ -761,14 +1137,7 @@ pub fn build_topological_map(
                     }
                 );
             }
-            try tmp_topo_map.map_space_to_code.put(
-                space_ref,
-                try child_space_code.clone()
-            );
-            try tmp_topo_map.map_code_to_space.put(
-                try child_space_code.clone(),
-                space_ref
-            );
+            try tmp_topo_map.insert_space(space_ref, child_space_code);
 
             // creates a cone of the child_space_code
             const child_code = try depth_child_code_leaky(
@@ -789,7 +1158,8 @@ pub fn build_topological_map(
         current_code.deinit();
     }
 
-    // return result;
+    try tmp_topo_map.link_spaces();
+
     return tmp_topo_map;
 }
 
@@ -809,6 +1179,154 @@ test "build_topological_map: leak sentinel test track w/ clip"
     defer map.deinit();
 }
 
+test "build_projection_operator: allocation budget track w/ clip"
+{
+    const allocator = std.testing.allocator;
+
+    var tr = schema.Track.init(allocator);
+    defer tr.deinit();
+    const tr_ref = core.ComposedValueRef.init(&tr);
+
+    const cl_ref = try tr.append_fetch_ref(
+        schema.Clip{ .bounds_s = T_CTI_1_10 }
+    );
+
+    const map = try build_topological_map(allocator, tr_ref);
+    defer map.deinit();
+
+    var tracker = allocation_tracker.AllocationTracker.init(allocator);
+    defer tracker.deinit();
+
+    const tracked = try tracker.allocator_at(@src());
+
+    const po = try map.build_projection_operator(
+        tracked,
+        .{
+            .source = try tr_ref.space(.presentation),
+            .destination = try cl_ref.space(.media),
+        },
+    );
+    po.deinit(tracked);
+
+    errdefer tracker.write_report(std.io.getStdErr().writer()) catch {};
+    try tracker.expect_within(
+        // counted by hand, not yet taken from a tracker report: 6 topologies
+        // built and 5 joins, one mapping slice each, 11 allocations and 440
+        // bytes at peak.  Every join takes the affine fast path, so the
+        // JoinScratch lists never grow, and path_ids does not allocate.
+        // Budgets leave half again on top; the report written on failure
+        // gives the measured values to replace these with.
+        .{
+            .max_allocations = 16,
+            .max_peak_live_bytes = 704,
+            // nothing outlives the operator
+            .max_live_bytes = 0,
+        },
+    );
+}
+
+test "TopologicalMap: stats"
+{
+    var tr = schema.Track.init(std.testing.allocator);
+    defer tr.deinit();
+    const tr_ref = core.ComposedValueRef.init(&tr);
+
+    for (0..4)
+        |_|
+    {
+        try tr.append(schema.Clip{ .bounds_s = T_CTI_1_10 });
+    }
+
+    const map = try build_topological_map(
+        std.testing.allocator,
+        tr_ref,
+    );
+    defer map.deinit();
+
+    const st = map.stats();
+
+    try std.testing.expectEqual(map.map_code_to_space.count(), st.node_count);
+    try std.testing.expectEqual(
+        st.node_count,
+        st.map_space_to_code.count,
+    );
+    try std.testing.expectEqual(st.node_count, st.map_space_to_id.count);
+    try std.testing.expect(st.nodes_capacity >= st.node_count);
+    try std.testing.expect(st.nodes_bytes > 0);
+    try std.testing.expect(st.max_code_length > 0);
+    try std.testing.expect(
+        @as(f64, @floatFromInt(st.max_code_length)) >= st.mean_code_length
+    );
+    try std.testing.expect(st.map_code_to_space.load_factor <= 1.0);
+    try std.testing.expect(
+        st.map_code_to_space.max_probe_length < st.map_code_to_space.capacity
+    );
+}
+
+test "TopologicalMap: dense space ids"
+{
+    var tr = schema.Track.init(std.testing.allocator);
+    defer tr.deinit();
+    const tr_ref = core.ComposedValueRef.init(&tr);
+
+    for (0..4)
+        |_|
+    {
+        try tr.append(schema.Clip{ .bounds_s = T_CTI_1_10 });
+    }
+
+    const map = try build_topological_map(
+        std.testing.allocator,
+        tr_ref,
+    );
+    defer map.deinit();
+
+    try std.testing.expectEqual(map.map_space_to_code.count(), map.nodes.len);
+
+    const root_id = map.space_id(map.root()).?;
+    try std.testing.expectEqual(null, map.parent_of(root_id));
+
+    // every id round trips and every non root space has a parent one step
+    // shorter than it
+    for (0..map.nodes.len)
+        |ind|
+    {
+        const id: TopologicalMap.SpaceId = @intCast(ind);
+        try std.testing.expectEqual(id, map.space_id(map.space_of(id)).?);
+
+        if (map.parent_of(id))
+            |parent|
+        {
+            try std.testing.expectEqual(
+                map.code_of(id).code_length() - 1,
+                map.code_of(parent).code_length(),
+            );
+        }
+        else {
+            try std.testing.expectEqual(root_id, id);
+        }
+    }
+
+    // walk from the root to the media of the last clip
+    const media = try core.ComposedValueRef.init(
+        &tr.children.items[3]
+    ).space(.media);
+    const media_id = map.space_id(media).?;
+
+    var current = root_id;
+    var steps: usize = 0;
+    while (try map.next_step_towards(current, media_id))
+        |next|
+    {
+        try std.testing.expectEqual(current, map.parent_of(next.id).?);
+        current = next.id;
+        steps += 1;
+    }
+
+    try std.testing.expectEqual(media_id, current);
+    try std.testing.expectEqual(map.code_of(media_id).code_length(), steps);
+}
+
 test "build_topological_map check root node" 
 {
     var tr = schema.Track.init(std.testing.allocator);
@@ -1337,50 +1855,79 @@ test "sequential_child_hash: math"
     }
 }
 
-/// generate a text
-fn label_for_node_leaky(
-    allocator: std.mem.Allocator,
+/// dot node name of a space, formatted without allocating
+const NodeLabel = struct {
     ref: core.SpaceReference,
     code: treecode.Treecode,
-) !string.latin_s8 
-{
-    const item_kind = switch(ref.ref) {
-        .track_ptr => "track",
-        .clip_ptr => "clip",
-        .gap_ptr => "gap",
-        .timeline_ptr => "timeline",
-        .stack_ptr => "stack",
-        .warp_ptr => "warp",
-    };
+    binary_treecode: bool = LABEL_HAS_BINARY_TREECODE,
 
-    if (LABEL_HAS_BINARY_TREECODE) 
-    {
-        return std.fmt.allocPrint(
-            allocator,
-            "{s}_{s}_{s}",
-            .{
-                item_kind,
-                @tagName(ref.label),
-                code,
-            }
-        );
-    } 
-    else 
+    pub fn format(
+        self: @This(),
+        // fmt
+        comptime _: []const u8,
+        // options
+        _: std.fmt.FormatOptions,
+        writer: anytype,
+    ) !void 
     {
-        const args = .{ 
-            item_kind,
-            @tagName(ref.label), code.hash(), 
+        const item_kind = switch(self.ref.ref) {
+            .track_ptr => "track",
+            .clip_ptr => "clip",
+            .gap_ptr => "gap",
+            .timeline_ptr => "timeline",
+            .stack_ptr => "stack",
+            .warp_ptr => "warp",
         };
 
-        return std.fmt.allocPrint(
-            allocator,
-            "{s}_{s}_{any}",
-            args
-        );
+        if (self.binary_treecode) 
+        {
+            try writer.print(
+                "{s}_{s}_{}",
+                .{
+                    item_kind,
+                    @tagName(self.ref.label),
+                    self.code,
+                }
+            );
+        } 
+        else 
+        {
+            try writer.print(
+                "{s}_{s}_{d}",
+                .{ 
+                    item_kind,
+                    @tagName(self.ref.label),
+                    self.code.hash(), 
+                }
+            );
+        }
     }
-}
+};
+
+/// dot node name of an empty child slot
+const PointLabel = struct {
+    code: treecode.Treecode,
+    binary_treecode: bool = LABEL_HAS_BINARY_TREECODE,
+
+    pub fn format(
+        self: @This(),
+        // fmt
+        comptime _: []const u8,
+        // options
+        _: std.fmt.FormatOptions,
+        writer: anytype,
+    ) !void 
+    {
+        if (self.binary_treecode) {
+            try writer.print("{}", .{ self.code });
+        }
+        else {
+            try writer.print("empty_{d}", .{ self.code.hash() });
+        }
+    }
+};
 
-test "label_for_node_leaky" 
+test "NodeLabel" 
 {
     var tr = schema.Track.init(std.testing.allocator);
     const sr = core.SpaceReference{
@@ -1394,12 +1941,95 @@ test "label_for_node_leaky"
     );
     defer tc.deinit();
 
-    const result = try label_for_node_leaky(
-        std.testing.allocator,
-        sr,
-        tc
+    var buf: [64]u8 = undefined;
+    const result = try std.fmt.bufPrint(
+        &buf,
+        "{}",
+        .{ NodeLabel{ .ref = sr, .code = tc } },
     );
-    defer std.testing.allocator.free(result);
 
     try std.testing.expectEqualStrings("track_presentation_1101001", result);
 }
+
+test "TopologicalMap: write_dot focus and depth limit"
+{
+    var tr = schema.Track.init(std.testing.allocator);
+    defer tr.deinit();
+
+    const cl = schema.Clip {
+        .bounds_s = T_CTI_1_10,
+    };
+    const cl_ptr = try tr.append_fetch_ref(cl);
+    const tr_ptr = core.ComposedValueRef.init(&tr);
+
+    const map = try build_topological_map(
+        std.testing.allocator,
+        tr_ptr
+    );
+    defer map.deinit();
+
+    var buf = std.ArrayList(u8).init(std.testing.allocator);
+    defer buf.deinit();
+
+    // whole map
+    {
+        try map.write_dot(std.testing.allocator, buf.writer(), .{});
+
+        try std.testing.expect(
+            std.mem.startsWith(u8, buf.items, "digraph OTIO_TopologicalMap {\n")
+        );
+        try std.testing.expect(std.mem.endsWith(u8, buf.items, "}\n"));
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "clip_media") != null
+        );
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "dashed") == null
+        );
+    }
+
+    // only the top of the track
+    {
+        buf.clearRetainingCapacity();
+        try map.write_dot(
+            std.testing.allocator,
+            buf.writer(),
+            .{ .max_depth = 1, .empty_children = false },
+        );
+
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "track_presentation") != null
+        );
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "clip_") == null
+        );
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "[style=dashed]") != null
+        );
+    }
+
+    // neighborhood of the clip
+    {
+        buf.clearRetainingCapacity();
+        try map.write_dot(
+            std.testing.allocator,
+            buf.writer(),
+            .{
+                .focus = try cl_ptr.space(.presentation),
+                .binary_treecode_labels = false,
+            },
+        );
+
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "track_") == null
+        );
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "clip_presentation_") != null
+        );
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "clip_media_") != null
+        );
+        try std.testing.expect(
+            std.mem.indexOf(u8, buf.items, "empty_") != null
+        );
+    }
+}
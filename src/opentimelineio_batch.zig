@@ -0,0 +1,667 @@
+//! Pipelined preprocessing of many .otio files.
+//!
+//! Each file goes through four stages:
+//!
+//!     read        read_from_file, on `read_threads` threads
+//!     map         build_topological_map, on `map_threads` threads
+//!     project     projection_map_to_media_from the presentation space, on
+//!                 `project_threads` threads
+//!     reduce      Reducer.reduce, on the calling thread
+//!
+//! Stages are connected by bounded queues, so a slow stage applies back
+//! pressure instead of letting the earlier stages fill memory with parsed
+//! timelines.  The reducer runs on one thread and does not need to be thread
+//! safe, but files reach it in completion order, not in the order of the
+//! paths.  Files that fail a stage are counted and skipped.
+//!
+//! The allocator is used from every stage thread and must be thread safe.
+
+const std = @import("std");
+
+const otio = @import("opentimelineio.zig");
+const otio_json = @import("opentimelineio_json.zig");
+const tracing = @import("tracing");
+
+/// a file that made it through every stage, handed to Reducer.reduce.  Only
+/// valid for the duration of the call.
+pub const File = struct {
+    /// index of the file in the paths passed to run
+    index: usize,
+    path: []const u8,
+    timeline: *const otio.Timeline,
+    map: otio.TopologicalMap,
+    po_map: otio.ProjectionOperatorMap,
+};
+
+pub const Config = struct {
+    read_threads: usize = 2,
+    map_threads: usize = 2,
+    project_threads: usize = 2,
+    /// capacity of each queue between stages
+    queue_capacity: usize = 16,
+};
+
+/// measurements of one stage
+pub const StageStats = struct {
+    threads: usize = 0,
+    /// files that made it through the stage
+    items: usize = 0,
+    /// files that failed in the stage
+    failures: usize = 0,
+    /// time spent doing the work of the stage, summed over its threads
+    busy_ns: u64 = 0,
+    /// time from the start of the run until the stage finished
+    done_ns: u64 = 0,
+
+    /// files through the stage per second of the run
+    pub fn items_per_s(
+        self: @This(),
+    ) f64
+    {
+        if (self.done_ns == 0) {
+            return 0;
+        }
+
+        return (
+            @as(f64, @floatFromInt(self.items))
+            / (@as(f64, @floatFromInt(self.done_ns)) / std.time.ns_per_s)
+        );
+    }
+
+    /// fraction of the stage's thread time spent working rather than waiting
+    /// on its queues
+    pub fn utilization(
+        self: @This(),
+    ) f64
+    {
+        if (self.done_ns == 0 or self.threads == 0) {
+            return 0;
+        }
+
+        return (
+            @as(f64, @floatFromInt(self.busy_ns))
+            / @as(f64, @floatFromInt(self.done_ns * self.threads))
+        );
+    }
+};
+
+pub const Stats = struct {
+    read: StageStats = .{},
+    map: StageStats = .{},
+    project: StageStats = .{},
+    reduce: StageStats = .{},
+    wall_ns: u64 = 0,
+};
+
+/// A fixed capacity FIFO shared between the threads of two stages.  pop
+/// returns null once every producer has called producer_done and the queue
+/// is drained.
+pub fn BoundedQueue(
+    comptime T: type,
+) type
+{
+    return struct {
+        mutex: std.Thread.Mutex = .{},
+        not_empty: std.Thread.Condition = .{},
+        not_full: std.Thread.Condition = .{},
+        buffer: []T,
+        head: usize = 0,
+        len: usize = 0,
+        /// producers that have not called producer_done yet
+        producers: usize,
+
+        pub fn init(
+            allocator: std.mem.Allocator,
+            capacity: usize,
+            producers: usize,
+        ) !@This()
+        {
+            return .{
+                .buffer = try allocator.alloc(T, @max(capacity, 1)),
+                .producers = producers,
+            };
+        }
+
+        pub fn deinit(
+            self: @This(),
+            allocator: std.mem.Allocator,
+        ) void
+        {
+            allocator.free(self.buffer);
+        }
+
+        /// append item, blocking while the queue is full
+        pub fn push(
+            self: *@This(),
+            item: T,
+        ) void
+        {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            while (self.len == self.buffer.len)
+            {
+                self.not_full.wait(&self.mutex);
+            }
+
+            self.buffer[(self.head + self.len) % self.buffer.len] = item;
+            self.len += 1;
+            self.not_empty.signal();
+        }
+
+        /// remove the oldest item, blocking while the queue is empty and
+        /// producers remain
+        pub fn pop(
+            self: *@This(),
+        ) ?T
+        {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            while (self.len == 0)
+            {
+                if (self.producers == 0) {
+                    return null;
+                }
+                self.not_empty.wait(&self.mutex);
+            }
+
+            const item = self.buffer[self.head];
+            self.head = (self.head + 1) % self.buffer.len;
+            self.len -= 1;
+            self.not_full.signal();
+
+            return item;
+        }
+
+        /// called once by each producer when it will not push again
+        pub fn producer_done(
+            self: *@This(),
+        ) void
+        {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            self.producers -= 1;
+            if (self.producers == 0) {
+                self.not_empty.broadcast();
+            }
+        }
+    };
+}
+
+/// stages that run on their own threads
+const WorkerStage = enum { read, map, project };
+
+/// a file between stages, fields are filled in as it moves along
+const Job = struct {
+    index: usize,
+    timeline: *otio.Timeline,
+    map: ?otio.TopologicalMap = null,
+    po_map: ?otio.ProjectionOperatorMap = null,
+
+    fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        if (self.po_map)
+            |po_map|
+        {
+            po_map.deinit();
+        }
+        if (self.map)
+            |map|
+        {
+            map.deinit();
+        }
+        self.timeline.recursively_deinit();
+        allocator.destroy(self.timeline);
+    }
+};
+
+const JobQueue = BoundedQueue(Job);
+
+/// shared state of a run
+fn Pipeline(
+    comptime Reducer: type,
+) type
+{
+    return struct {
+        allocator: std.mem.Allocator,
+        paths: []const []const u8,
+        reducer: *Reducer,
+        timer: std.time.Timer,
+
+        /// next path for the read stage
+        next_path: std.atomic.Value(usize) = std.atomic.Value(usize).init(0),
+
+        parsed: JobQueue,
+        mapped: JobQueue,
+        projected: JobQueue,
+
+        /// guards stats and calls to Reducer.failed
+        mutex: std.Thread.Mutex = .{},
+        stats: Stats = .{},
+
+        const Self = @This();
+
+        /// add the measurements of one thread to stage
+        fn record(
+            self: *Self,
+            stage: *StageStats,
+            local: StageStats,
+        ) void
+        {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            stage.items += local.items;
+            stage.failures += local.failures;
+            stage.busy_ns += local.busy_ns;
+            stage.done_ns = @max(stage.done_ns, self.timer.read());
+        }
+
+        fn fail(
+            self: *Self,
+            index: usize,
+            err: anyerror,
+        ) void
+        {
+            if (comptime @hasDecl(Reducer, "failed"))
+            {
+                self.mutex.lock();
+                defer self.mutex.unlock();
+
+                self.reducer.failed(self.paths[index], err);
+            }
+        }
+
+        fn read_worker(
+            self: *Self,
+        ) void
+        {
+            defer self.parsed.producer_done();
+
+            var local = StageStats{};
+            defer self.record(&self.stats.read, local);
+
+            while (true)
+            {
+                const index = self.next_path.fetchAdd(1, .monotonic);
+                if (index >= self.paths.len) {
+                    break;
+                }
+
+                const span = tracing.begin("batch.read");
+                defer span.end();
+
+                const work_start = self.timer.read();
+
+                const timeline = self.read(index) catch |err| {
+                    local.failures += 1;
+                    self.fail(index, err);
+                    continue;
+                };
+
+                local.busy_ns += self.timer.read() - work_start;
+                local.items += 1;
+
+                self.parsed.push(
+                    .{ .index = index, .timeline = timeline }
+                );
+            }
+        }
+
+        fn read(
+            self: *Self,
+            index: usize,
+        ) !*otio.Timeline
+        {
+            const timeline = try self.allocator.create(otio.Timeline);
+            errdefer self.allocator.destroy(timeline);
+
+            timeline.* = try otio_json.read_from_file(
+                self.allocator,
+                self.paths[index],
+            );
+
+            return timeline;
+        }
+
+        fn map_worker(
+            self: *Self,
+        ) void
+        {
+            defer self.mapped.producer_done();
+
+            var local = StageStats{};
+            defer self.record(&self.stats.map, local);
+
+            while (self.parsed.pop())
+                |job_in|
+            {
+                const span = tracing.begin("batch.map");
+                defer span.end();
+
+                var job = job_in;
+                const work_start = self.timer.read();
+
+                job.map = otio.build_topological_map(
+                    self.allocator,
+                    otio.ComposedValueRef.init(job.timeline),
+                ) catch |err| {
+                    local.failures += 1;
+                    self.fail(job.index, err);
+                    job.deinit(self.allocator);
+                    continue;
+                };
+
+                local.busy_ns += self.timer.read() - work_start;
+                local.items += 1;
+
+                self.mapped.push(job);
+            }
+        }
+
+        fn project_worker(
+            self: *Self,
+        ) void
+        {
+            defer self.projected.producer_done();
+
+            var local = StageStats{};
+            defer self.record(&self.stats.project, local);
+
+            while (self.mapped.pop())
+                |job_in|
+            {
+                const span = tracing.begin("batch.project");
+                defer span.end();
+
+                var job = job_in;
+                const work_start = self.timer.read();
+
+                job.po_map = self.project(job) catch |err| {
+                    local.failures += 1;
+                    self.fail(job.index, err);
+                    job.deinit(self.allocator);
+                    continue;
+                };
+
+                local.busy_ns += self.timer.read() - work_start;
+                local.items += 1;
+
+                self.projected.push(job);
+            }
+        }
+
+        fn project(
+            self: *Self,
+            job: Job,
+        ) !otio.ProjectionOperatorMap
+        {
+            return try otio.projection_map_to_media_from(
+                self.allocator,
+                job.map.?,
+                try otio.ComposedValueRef.init(job.timeline).space(
+                    .presentation
+                ),
+            );
+        }
+
+        fn worker(
+            self: *Self,
+            stage: WorkerStage,
+        ) void
+        {
+            switch (stage) {
+                .read => self.read_worker(),
+                .map => self.map_worker(),
+                .project => self.project_worker(),
+            }
+        }
+
+        /// the queue the threads of stage push to
+        fn output_of(
+            self: *Self,
+            stage: WorkerStage,
+        ) *JobQueue
+        {
+            return switch (stage) {
+                .read => &self.parsed,
+                .map => &self.mapped,
+                .project => &self.projected,
+            };
+        }
+
+        /// stop reading and release every job still in flight, used when
+        /// not every worker could be started
+        fn abort(
+            self: *Self,
+        ) void
+        {
+            self.next_path.store(self.paths.len, .monotonic);
+
+            // in pipeline order, each queue closes once the stage before it
+            // has finished
+            for ([_]*JobQueue{ &self.parsed, &self.mapped, &self.projected })
+                |queue|
+            {
+                while (queue.pop())
+                    |job|
+                {
+                    job.deinit(self.allocator);
+                }
+            }
+        }
+
+        /// run on the calling thread until every file is through
+        fn reduce(
+            self: *Self,
+        ) void
+        {
+            var local = StageStats{ .threads = 1 };
+            defer self.record(&self.stats.reduce, local);
+
+            while (self.projected.pop())
+                |job|
+            {
+                defer job.deinit(self.allocator);
+
+                const span = tracing.begin("batch.reduce");
+                defer span.end();
+
+                const work_start = self.timer.read();
+
+                self.reducer.reduce(
+                    .{
+                        .index = job.index,
+                        .path = self.paths[job.index],
+                        .timeline = job.timeline,
+                        .map = job.map.?,
+                        .po_map = job.po_map.?,
+                    }
+                ) catch |err| {
+                    local.failures += 1;
+                    self.fail(job.index, err);
+                    continue;
+                };
+
+                local.busy_ns += self.timer.read() - work_start;
+                local.items += 1;
+            }
+        }
+    };
+}
+
+/// Read every file in paths, build its TopologicalMap and the
+/// ProjectionOperatorMap from its presentation space and hand the result to
+/// reducer.reduce(File) !void.  If Reducer declares
+/// failed(path, anyerror) void it is called, under a lock, for every file
+/// that fails a stage.  Returns once every file is through.
+pub fn run(
+    allocator: std.mem.Allocator,
+    paths: []const []const u8,
+    config: Config,
+    comptime Reducer: type,
+    reducer: *Reducer,
+) !Stats
+{
+    const span = tracing.begin_sized("batch.run", paths.len);
+    defer span.end();
+
+    const read_threads = @max(config.read_threads, 1);
+    const map_threads = @max(config.map_threads, 1);
+    const project_threads = @max(config.project_threads, 1);
+
+    var pipeline = Pipeline(Reducer){
+        .allocator = allocator,
+        .paths = paths,
+        .reducer = reducer,
+        .timer = try std.time.Timer.start(),
+        .parsed = try JobQueue.init(
+            allocator,
+            config.queue_capacity,
+            read_threads,
+        ),
+        .mapped = undefined,
+        .projected = undefined,
+    };
+    defer pipeline.parsed.deinit(allocator);
+
+    pipeline.mapped = try JobQueue.init(
+        allocator,
+        config.queue_capacity,
+        map_threads,
+    );
+    defer pipeline.mapped.deinit(allocator);
+
+    pipeline.projected = try JobQueue.init(
+        allocator,
+        config.queue_capacity,
+        project_threads,
+    );
+    defer pipeline.projected.deinit(allocator);
+
+    pipeline.stats.read.threads = read_threads;
+    pipeline.stats.map.threads = map_threads;
+    pipeline.stats.project.threads = project_threads;
+
+    const threads = try allocator.alloc(
+        std.Thread,
+        read_threads + map_threads + project_threads,
+    );
+    defer allocator.free(threads);
+
+    for (threads, 0..)
+        |*thread, ind|
+    {
+        const stage: WorkerStage = (
+            if (ind < read_threads) .read
+            else if (ind < read_threads + map_threads) .map
+            else .project
+        );
+
+        thread.* = std.Thread.spawn(
+            .{},
+            Pipeline(Reducer).worker,
+            .{ &pipeline, stage },
+        ) catch |err| {
+            // stand in for the workers that were not started, so that the
+            // queues still close, and throw away everything in flight
+            for (ind..threads.len)
+                |missing|
+            {
+                const missing_stage: WorkerStage = (
+                    if (missing < read_threads) .read
+                    else if (missing < read_threads + map_threads) .map
+                    else .project
+                );
+                pipeline.output_of(missing_stage).producer_done();
+            }
+            pipeline.abort();
+
+            for (threads[0..ind])
+                |started|
+            {
+                started.join();
+            }
+            return err;
+        };
+    }
+
+    pipeline.reduce();
+
+    for (threads)
+        |thread|
+    {
+        thread.join();
+    }
+
+    pipeline.stats.wall_ns = pipeline.timer.read();
+
+    return pipeline.stats;
+}
+
+test "batch: run over sample files"
+{
+    const allocator = std.testing.allocator;
+
+    const Counter = struct {
+        files: usize = 0,
+        segments: usize = 0,
+        seen: [4]bool = .{ false, false, false, false },
+        failed_paths: usize = 0,
+
+        pub fn reduce(
+            self: *@This(),
+            file: File,
+        ) !void
+        {
+            self.files += 1;
+            self.segments += file.po_map.operators.len;
+            self.seen[file.index] = true;
+        }
+
+        pub fn failed(
+            self: *@This(),
+            _: []const u8,
+            _: anyerror,
+        ) void
+        {
+            self.failed_paths += 1;
+        }
+    };
+
+    const paths = [_][]const u8{
+        "sample_otio_files/simple_cut.otio",
+        "sample_otio_files/multiple_track.otio",
+        "sample_otio_files/does_not_exist.otio",
+        "sample_otio_files/simple_cut.otio",
+    };
+
+    var counter = Counter{};
+    const stats = try run(
+        allocator,
+        &paths,
+        .{ .queue_capacity = 1 },
+        Counter,
+        &counter,
+    );
+
+    try std.testing.expectEqual(3, counter.files);
+    try std.testing.expectEqual(1, counter.failed_paths);
+    try std.testing.expect(counter.segments > 0);
+    try std.testing.expectEqualSlices(
+        bool,
+        &.{ true, true, false, true },
+        &counter.seen,
+    );
+
+    try std.testing.expectEqual(3, stats.read.items);
+    try std.testing.expectEqual(1, stats.read.failures);
+    try std.testing.expectEqual(3, stats.map.items);
+    try std.testing.expectEqual(3, stats.project.items);
+    try std.testing.expectEqual(3, stats.reduce.items);
+}
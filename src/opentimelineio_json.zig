@@ -8,6 +8,8 @@ const interval = opentime.interval;
 const transform = opentime.transform;
 const curve = @import("curve");
 const string = @import("string_stuff");
+const build_options = @import("build_options");
+const tracing = @import("tracing");
 
 pub const SerializableObjectTypes = enum {
     Timeline,
@@ -282,6 +284,7 @@ pub fn read_otio_object(
                 {
                     .Clip => |cl| { try tr.children.append( .{ .clip = cl }); },
                     .Gap => |gp| { try tr.children.append( .{ .gap = gp }); },
+                    .Stack => |st| { try tr.children.append( .{ .stack = st }); },
                     else => return error.NotImplementedTrackChildJson,
                 }
             }
@@ -336,6 +339,9 @@ pub fn read_from_file(
     file_path: string.latin_s8
 ) !otio.Timeline 
 {
+    const span = tracing.begin("otio_json.read_from_file");
+    defer span.end();
+
     const fi = try std.fs.cwd().openFile(file_path, .{});
     defer fi.close();
 
@@ -367,6 +373,174 @@ pub fn read_from_file(
     return error.NotImplemented;
 }
 
+/// rate used for RationalTimes when no discrete info is available
+const DEFAULT_WRITE_RATE_HZ = 24;
+
+/// serialize the timeline to an OTIO json file.  Streams the output, so
+/// memory use does not depend on the size of the timeline.
+pub fn write_to_file(
+    timeline: otio.Timeline,
+    file_path: string.latin_s8,
+) !void
+{
+    const fi = try std.fs.cwd().createFile(file_path, .{});
+    defer fi.close();
+
+    var buffered = std.io.bufferedWriter(fi.writer());
+    try write_timeline(timeline, buffered.writer());
+    try buffered.flush();
+}
+
+/// serialize the timeline as OTIO json to writer
+pub fn write_timeline(
+    timeline: otio.Timeline,
+    writer: anytype,
+) !void
+{
+    var ws = std.json.writeStream(writer, .{ .whitespace = .indent_2 });
+    defer ws.deinit();
+
+    const rate = (
+        if (timeline.discrete_info.presentation)
+            |di|
+            di.sample_rate_hz.as_ordinate()
+        else opentime.Ordinate.init(DEFAULT_WRITE_RATE_HZ)
+    );
+
+    try ws.beginObject();
+    {
+        try ws.objectField("OTIO_SCHEMA");
+        try ws.write("Timeline.1");
+        try ws.objectField("name");
+        try ws.write(timeline.name orelse "");
+        try ws.objectField("tracks");
+        try write_composable(
+            &ws,
+            .{ .stack = timeline.tracks },
+            rate,
+        );
+    }
+    try ws.endObject();
+}
+
+fn write_rational_time(
+    ws: anytype,
+    value: opentime.Ordinate,
+    rate: opentime.Ordinate,
+) !void
+{
+    try ws.beginObject();
+    try ws.objectField("OTIO_SCHEMA");
+    try ws.write("RationalTime.1");
+    try ws.objectField("rate");
+    try ws.write(rate.as(f64));
+    try ws.objectField("value");
+    try ws.write(value.mul(rate).as(f64));
+    try ws.endObject();
+}
+
+fn write_time_range(
+    ws: anytype,
+    range: interval.ContinuousInterval,
+    rate: opentime.Ordinate,
+) !void
+{
+    try ws.beginObject();
+    try ws.objectField("OTIO_SCHEMA");
+    try ws.write("TimeRange.1");
+    try ws.objectField("start_time");
+    try write_rational_time(ws, range.start, rate);
+    try ws.objectField("duration");
+    try write_rational_time(ws, range.duration(), rate);
+    try ws.endObject();
+}
+
+fn write_children(
+    ws: anytype,
+    children: []const otio.core.ComposableValue,
+    rate: opentime.Ordinate,
+) (@TypeOf(ws.*).Error || error{NotImplementedWarpJson})!void
+{
+    try ws.objectField("children");
+    try ws.beginArray();
+    for (children)
+        |child|
+    {
+        try write_composable(ws, child, rate);
+    }
+    try ws.endArray();
+}
+
+fn write_composable(
+    ws: anytype,
+    value: otio.core.ComposableValue,
+    rate: opentime.Ordinate,
+) (@TypeOf(ws.*).Error || error{NotImplementedWarpJson})!void
+{
+    // @TODO: warps don't have an OTIO schema yet
+    if (value == .warp) {
+        return error.NotImplementedWarpJson;
+    }
+
+    try ws.beginObject();
+    switch (value) {
+        .stack => |st| {
+            try ws.objectField("OTIO_SCHEMA");
+            try ws.write("Stack.1");
+            try ws.objectField("name");
+            try ws.write(st.name orelse "");
+            try write_children(ws, st.children.items, rate);
+        },
+        .track => |tr| {
+            try ws.objectField("OTIO_SCHEMA");
+            try ws.write("Track.1");
+            try ws.objectField("name");
+            try ws.write(tr.name orelse "");
+            try write_children(ws, tr.children.items, rate);
+        },
+        .clip => |cl| {
+            try ws.objectField("OTIO_SCHEMA");
+            try ws.write("Clip.1");
+            try ws.objectField("name");
+            try ws.write(cl.name orelse "");
+            try ws.objectField("source_range");
+            if (cl.bounds_s)
+                |range|
+            {
+                try write_time_range(
+                    ws,
+                    range,
+                    if (cl.media.discrete_info)
+                        |di|
+                        di.sample_rate_hz.as_ordinate()
+                    else rate,
+                );
+            }
+            else
+            {
+                try ws.write(null);
+            }
+        },
+        .gap => |gp| {
+            try ws.objectField("OTIO_SCHEMA");
+            try ws.write("Gap.1");
+            try ws.objectField("name");
+            try ws.write(gp.name orelse "");
+            try ws.objectField("source_range");
+            try write_time_range(
+                ws,
+                .{
+                    .start = opentime.Ordinate.ZERO,
+                    .end = gp.duration_seconds,
+                },
+                rate,
+            );
+        },
+        .warp => unreachable,
+    }
+    try ws.endObject();
+}
+
 test "read_from_file test" 
 {
     const allocator = std.testing.allocator;
@@ -426,3 +600,35 @@ test "read_from_file test"
         ).ordinate(),
     );
 }
+
+test "write_to_file round trip"
+{
+    const allocator = std.testing.allocator;
+
+    const gen = try otio.timeline_generator.generate(
+        allocator,
+        .{
+            .track_count = 2,
+            .clips_per_track = 10,
+            .gap_ratio = 0.3,
+            .nesting_depth = 1,
+            .seed = 42,
+        },
+    );
+    defer gen.deinit();
+
+    const fpath = build_options.test_data_out_dir ++ "/generated_round_trip.otio";
+    try write_to_file(gen.timeline.*, fpath);
+
+    const tl = try read_from_file(allocator, fpath);
+    defer tl.recursively_deinit();
+
+    try expectEqual(@as(usize, 2), tl.tracks.children.items.len);
+
+    const tl_ptr = otio.ComposedValueRef.init(&tl);
+    const expected = try gen.ref().bounds_of(allocator, .presentation);
+    const measured = try tl_ptr.bounds_of(allocator, .presentation);
+
+    try opentime.expectOrdinateEqual(expected.start, measured.start);
+    try opentime.expectOrdinateEqual(expected.end, measured.end);
+}
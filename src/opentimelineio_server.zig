@@ -0,0 +1,969 @@
+//! Resident projection queries served over a Unix domain socket.
+//!
+//! A Resident loads a timeline once and keeps its TopologicalMap,
+//! ProjectionOperatorMap and the compiled EvaluationProgram in memory.
+//! serve() answers batched requests from other processes on the same host,
+//! which then do not have to load the timeline and rebuild the maps
+//! themselves.
+//!
+//! Protocol, in host byte order since both ends are on the same machine.
+//! Every request and response starts with a Header, `count` is the number of
+//! items in the request:
+//!
+//!     project       request:  count f64 presentation ordinates
+//!                   response: count + 1 u32 offsets, then offsets[count]
+//!                             WireSamples.  The samples of ordinate i are
+//!                             [offsets[i], offsets[i+1]).
+//!     pull_list     request:  count [2]f64 presentation ranges
+//!                   response: count + 1 u32 offsets, then offsets[count]
+//!                             PullEntries, one per destination visible in
+//!                             the range with the media range it needs.
+//!     destinations  request:  nothing
+//!                   response: count u32 name lengths, then the names of
+//!                             the destinations ids refer to, back to back
+//!
+//! A response with a status other than .ok has no payload and the server
+//! closes the connection.  Requests of an unknown kind, non finite ordinates
+//! and non finite or reversed ranges are answered with .bad_request.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const topology_m = @import("topology");
+
+const otio = @import("opentimelineio.zig");
+const otio_json = @import("opentimelineio_json.zig");
+
+/// largest number of items accepted in one request
+pub const MAX_BATCH = 1 << 20;
+
+pub const RequestKind = enum(u8) {
+    project,
+    pull_list,
+    destinations,
+};
+
+pub const Status = enum(u8) {
+    ok,
+    bad_request,
+};
+
+/// kind and status are kept as raw bytes, they come from another process
+/// and are only turned into enums once checked
+pub const Header = extern struct {
+    kind: u8,
+    status: u8 = @intFromEnum(Status.ok),
+    reserved: u16 = 0,
+    count: u32,
+
+    pub fn init(
+        kind: RequestKind,
+        status: Status,
+        count: u32,
+    ) Header
+    {
+        return .{
+            .kind = @intFromEnum(kind),
+            .status = @intFromEnum(status),
+            .count = count,
+        };
+    }
+
+    pub fn request_kind(
+        self: @This(),
+    ) error{BadRequest}!RequestKind
+    {
+        return std.meta.intToEnum(
+            RequestKind,
+            self.kind,
+        ) catch error.BadRequest;
+    }
+
+    pub fn response_status(
+        self: @This(),
+    ) error{BadResponse}!Status
+    {
+        return std.meta.intToEnum(
+            Status,
+            self.status,
+        ) catch error.BadResponse;
+    }
+};
+
+pub const ResultKind = enum(u32) {
+    /// start holds the ordinate
+    ordinate,
+    /// start and end hold the interval
+    interval,
+    out_of_bounds,
+};
+
+/// one projected ordinate on the wire, see EvaluationProgram.Sample
+pub const WireSample = extern struct {
+    destination: u32,
+    /// a ResultKind, see result_kind
+    kind: u32,
+    start: f64 = 0,
+    end: f64 = 0,
+
+    pub fn result_kind(
+        self: @This(),
+    ) error{BadResponse}!ResultKind
+    {
+        return std.meta.intToEnum(
+            ResultKind,
+            self.kind,
+        ) catch error.BadResponse;
+    }
+
+    pub fn init(
+        sample: otio.evaluation_program.Sample,
+    ) WireSample
+    {
+        return switch (sample.result) {
+            .SuccessOrdinate => |ord| .{
+                .destination = sample.destination,
+                .kind = @intFromEnum(ResultKind.ordinate),
+                .start = ord.as(f64),
+            },
+            .SuccessInterval => |ival| .{
+                .destination = sample.destination,
+                .kind = @intFromEnum(ResultKind.interval),
+                .start = ival.start.as(f64),
+                .end = ival.end.as(f64),
+            },
+            .OutOfBounds => .{
+                .destination = sample.destination,
+                .kind = @intFromEnum(ResultKind.out_of_bounds),
+            },
+        };
+    }
+};
+
+/// a destination and the range of its media needed for a presentation range
+pub const PullEntry = extern struct {
+    destination: u32,
+    reserved: u32 = 0,
+    start: f64,
+    end: f64,
+};
+
+/// the maps of one timeline, built once and only read afterwards, so one
+/// Resident can answer requests from several threads
+pub const Resident = struct {
+    allocator: std.mem.Allocator,
+    /// set when the Resident loaded the timeline itself
+    owned_timeline: ?*otio.Timeline = null,
+    map: otio.TopologicalMap,
+    po_map: otio.ProjectionOperatorMap,
+    program: otio.EvaluationProgram,
+    /// inverse of program.destinations
+    destination_ids: std.AutoHashMap(otio.core.SpaceReference, u32),
+
+    /// build the maps from the presentation space of root.  root must
+    /// outlive the Resident.
+    pub fn init(
+        allocator: std.mem.Allocator,
+        root: otio.ComposedValueRef,
+    ) !Resident
+    {
+        const map = try otio.build_topological_map(allocator, root);
+        errdefer map.deinit();
+
+        const po_map = try otio.projection_map_to_media_from(
+            allocator,
+            map,
+            try root.space(.presentation),
+        );
+        errdefer po_map.deinit();
+
+        const program = try otio.EvaluationProgram.compile(allocator, po_map);
+        errdefer program.deinit();
+
+        var destination_ids = std.AutoHashMap(
+            otio.core.SpaceReference,
+            u32,
+        ).init(allocator);
+        errdefer destination_ids.deinit();
+
+        for (program.destinations, 0..)
+            |destination, ind|
+        {
+            try destination_ids.put(destination, @intCast(ind));
+        }
+
+        return .{
+            .allocator = allocator,
+            .map = map,
+            .po_map = po_map,
+            .program = program,
+            .destination_ids = destination_ids,
+        };
+    }
+
+    /// read the timeline at path and build its maps
+    pub fn load(
+        allocator: std.mem.Allocator,
+        path: []const u8,
+    ) !Resident
+    {
+        const timeline = try allocator.create(otio.Timeline);
+        errdefer allocator.destroy(timeline);
+
+        timeline.* = try otio_json.read_from_file(allocator, path);
+        errdefer timeline.recursively_deinit();
+
+        var result = try Resident.init(
+            allocator,
+            otio.ComposedValueRef.init(timeline),
+        );
+        result.owned_timeline = timeline;
+
+        return result;
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        self.destination_ids.deinit();
+        self.program.deinit();
+        self.po_map.deinit();
+        self.map.deinit();
+
+        if (self.owned_timeline)
+            |timeline|
+        {
+            timeline.recursively_deinit();
+            self.allocator.destroy(timeline);
+        }
+    }
+
+    /// append a PullEntry to result for each destination visible in range,
+    /// with the bounds of the media it needs over range.  allocator is used
+    /// for scratch topologies that are freed before returning.
+    pub fn pull_list_into(
+        self: @This(),
+        allocator: std.mem.Allocator,
+        range: opentime.ContinuousInterval,
+        result: *std.ArrayList(PullEntry),
+    ) !void
+    {
+        const n = self.program.segment_count();
+        if (n == 0) {
+            return;
+        }
+
+        const clipped = opentime.interval.intersect(
+            range,
+            .{
+                .start = self.program.end_points[0],
+                .end = self.program.end_points[n],
+            },
+        ) orelse return;
+
+        const first_entry = result.items.len;
+
+        var segment = self.program.segment_at(clipped.start) orelse return;
+        while (
+            segment < n
+            and self.program.end_points[segment].lt(clipped.end)
+        ) : (segment += 1)
+        {
+            const in_segment = opentime.interval.intersect(
+                clipped,
+                .{
+                    .start = self.program.end_points[segment],
+                    .end = self.program.end_points[segment + 1],
+                },
+            ) orelse continue;
+
+            for (self.po_map.operators[segment])
+                |op|
+            {
+                const trimmed = try op.src_to_dst_topo.trim_in_input_space(
+                    allocator,
+                    in_segment,
+                );
+                defer trimmed.deinit(allocator);
+
+                const media_range = media_bounds(trimmed) orelse continue;
+                const destination = self.destination_ids.get(
+                    op.destination
+                ).?;
+
+                const existing = for (result.items[first_entry..])
+                    |*entry|
+                {
+                    if (entry.destination == destination) {
+                        break entry;
+                    }
+                } else null;
+
+                if (existing)
+                    |entry|
+                {
+                    entry.start = @min(entry.start, media_range.start.as(f64));
+                    entry.end = @max(entry.end, media_range.end.as(f64));
+                    continue;
+                }
+
+                try result.append(
+                    .{
+                        .destination = destination,
+                        .start = media_range.start.as(f64),
+                        .end = media_range.end.as(f64),
+                    }
+                );
+            }
+        }
+    }
+
+    /// output bounds of the non empty mappings of topo, lowest first
+    fn media_bounds(
+        topo: topology_m.Topology,
+    ) ?opentime.ContinuousInterval
+    {
+        var bounds: ?opentime.ContinuousInterval = null;
+        for (topo.mappings)
+            |m|
+        {
+            if (m == .empty) {
+                continue;
+            }
+
+            const ob = m.output_bounds();
+            const lo_hi = opentime.ContinuousInterval{
+                .start = opentime.min(ob.start, ob.end),
+                .end = opentime.max(ob.start, ob.end),
+            };
+            bounds = (
+                if (bounds) |b| opentime.interval.extend(b, lo_hi)
+                else lo_hi
+            );
+        }
+
+        return bounds;
+    }
+
+    /// read the payload of the request described by header from reader and
+    /// write the response to writer.  allocator is used for scratch space.
+    pub fn respond(
+        self: @This(),
+        allocator: std.mem.Allocator,
+        header: Header,
+        reader: anytype,
+        writer: anytype,
+    ) !void
+    {
+        const kind = header.request_kind() catch {
+            return reject(header, writer);
+        };
+        if (header.count > MAX_BATCH) {
+            return reject(header, writer);
+        }
+
+        switch (kind) {
+            .project => {
+                const ords_wire = try allocator.alloc(f64, header.count);
+                try reader.readNoEof(std.mem.sliceAsBytes(ords_wire));
+
+                for (ords_wire)
+                    |ord_wire|
+                {
+                    if (!std.math.isFinite(ord_wire)) {
+                        return reject(header, writer);
+                    }
+                }
+
+                const offsets = try allocator.alloc(u32, header.count + 1);
+                var samples = std.ArrayList(WireSample).init(allocator);
+                var scratch: [16]otio.evaluation_program.Sample = undefined;
+
+                for (ords_wire, 0..)
+                    |ord_wire, ind|
+                {
+                    offsets[ind] = @intCast(samples.items.len);
+
+                    const ord = opentime.Ordinate.init(ord_wire);
+                    const count = self.program.evaluate_into(ord, &scratch);
+                    if (count <= scratch.len)
+                    {
+                        for (scratch[0..count])
+                            |sample|
+                        {
+                            try samples.append(WireSample.init(sample));
+                        }
+                        continue;
+                    }
+
+                    // more operators than fit on the stack
+                    const big = try allocator.alloc(
+                        otio.evaluation_program.Sample,
+                        count,
+                    );
+                    _ = self.program.evaluate_into(ord, big);
+                    for (big)
+                        |sample|
+                    {
+                        try samples.append(WireSample.init(sample));
+                    }
+                }
+                offsets[header.count] = @intCast(samples.items.len);
+
+                try writer.writeStruct(header);
+                try writer.writeAll(std.mem.sliceAsBytes(offsets));
+                try writer.writeAll(std.mem.sliceAsBytes(samples.items));
+            },
+            .pull_list => {
+                const ranges_wire = try allocator.alloc(
+                    [2]f64,
+                    header.count,
+                );
+                try reader.readNoEof(std.mem.sliceAsBytes(ranges_wire));
+
+                for (ranges_wire)
+                    |range_wire|
+                {
+                    if (
+                        !std.math.isFinite(range_wire[0])
+                        or !std.math.isFinite(range_wire[1])
+                        or range_wire[1] < range_wire[0]
+                    )
+                    {
+                        return reject(header, writer);
+                    }
+                }
+
+                const offsets = try allocator.alloc(u32, header.count + 1);
+                var entries = std.ArrayList(PullEntry).init(allocator);
+
+                for (ranges_wire, 0..)
+                    |range_wire, ind|
+                {
+                    offsets[ind] = @intCast(entries.items.len);
+                    try self.pull_list_into(
+                        allocator,
+                        .{
+                            .start = opentime.Ordinate.init(range_wire[0]),
+                            .end = opentime.Ordinate.init(range_wire[1]),
+                        },
+                        &entries,
+                    );
+                }
+                offsets[header.count] = @intCast(entries.items.len);
+
+                try writer.writeStruct(header);
+                try writer.writeAll(std.mem.sliceAsBytes(offsets));
+                try writer.writeAll(std.mem.sliceAsBytes(entries.items));
+            },
+            .destinations => {
+                const destinations = self.program.destinations;
+
+                try writer.writeStruct(
+                    Header.init(
+                        .destinations,
+                        .ok,
+                        @intCast(destinations.len),
+                    )
+                );
+                for (destinations)
+                    |destination|
+                {
+                    const name = destination.ref.name() orelse "";
+                    const len: u32 = @intCast(name.len);
+                    try writer.writeAll(std.mem.asBytes(&len));
+                }
+                for (destinations)
+                    |destination|
+                {
+                    try writer.writeAll(destination.ref.name() orelse "");
+                }
+            },
+        }
+    }
+
+    /// answer the request of header with .bad_request, after which the
+    /// connection is closed
+    fn reject(
+        header: Header,
+        writer: anytype,
+    ) !void
+    {
+        try writer.writeStruct(
+            Header{
+                .kind = header.kind,
+                .status = @intFromEnum(Status.bad_request),
+                .count = 0,
+            }
+        );
+        return error.BadRequest;
+    }
+};
+
+/// the connections serve is answering, so that it can wait for them
+const LiveConnections = struct {
+    mutex: std.Thread.Mutex = .{},
+    finished: std.Thread.Condition = .{},
+    count: usize = 0,
+
+    fn add(
+        self: *@This(),
+    ) void
+    {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.count += 1;
+    }
+
+    fn remove(
+        self: *@This(),
+    ) void
+    {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.count -= 1;
+        if (self.count == 0) {
+            self.finished.broadcast();
+        }
+    }
+
+    fn wait(
+        self: *@This(),
+    ) void
+    {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        while (self.count > 0) {
+            self.finished.wait(&self.mutex);
+        }
+    }
+};
+
+/// answer requests on stream until the client disconnects
+fn handle_connection(
+    resident: *const Resident,
+    stream: std.net.Stream,
+    live: *LiveConnections,
+) void
+{
+    // last, serve may return as soon as live is empty
+    defer live.remove();
+    defer stream.close();
+
+    var arena = std.heap.ArenaAllocator.init(resident.allocator);
+    defer arena.deinit();
+
+    var buffered_reader = std.io.bufferedReader(stream.reader());
+    var buffered_writer = std.io.bufferedWriter(stream.writer());
+
+    while (true)
+    {
+        const header = buffered_reader.reader().readStruct(
+            Header
+        ) catch |err| {
+            if (err != error.EndOfStream) {
+                std.log.warn("reading request: {s}", .{ @errorName(err) });
+            }
+            return;
+        };
+
+        _ = arena.reset(.retain_capacity);
+
+        resident.respond(
+            arena.allocator(),
+            header,
+            buffered_reader.reader(),
+            buffered_writer.writer(),
+        ) catch |err| {
+            buffered_writer.flush() catch {};
+            std.log.warn("answering request: {s}", .{ @errorName(err) });
+            return;
+        };
+
+        buffered_writer.flush() catch return;
+    }
+}
+
+/// Accept connections on socket_path and answer them on a detached thread
+/// each until stop is set.  serve only notices stop when it wakes up for a
+/// connection, so call wake(socket_path) after setting it.  Returns once
+/// every connection has been closed by its client.
+pub fn serve(
+    resident: *const Resident,
+    socket_path: []const u8,
+    stop: *const std.atomic.Value(bool),
+) !void
+{
+    // a socket left over from an earlier run
+    std.fs.cwd().deleteFile(socket_path) catch {};
+    defer std.fs.cwd().deleteFile(socket_path) catch {};
+
+    const address = try std.net.Address.initUnix(socket_path);
+    var server = try address.listen(.{});
+    defer server.deinit();
+
+    var live = LiveConnections{};
+    defer live.wait();
+
+    while (true)
+    {
+        const connection = try server.accept();
+        if (stop.load(.acquire))
+        {
+            connection.stream.close();
+            return;
+        }
+
+        live.add();
+        const thread = std.Thread.spawn(
+            .{},
+            handle_connection,
+            .{ resident, connection.stream, &live },
+        ) catch |err| {
+            connection.stream.close();
+            live.remove();
+            return err;
+        };
+        thread.detach();
+    }
+}
+
+/// open and close a connection so that serve checks its stop flag
+pub fn wake(
+    socket_path: []const u8,
+) void
+{
+    const stream = std.net.connectUnixSocket(socket_path) catch return;
+    stream.close();
+}
+
+/// a connection to a serve()ing process
+pub const Client = struct {
+    stream: std.net.Stream,
+    /// request being assembled, reused between requests
+    buffer: std.ArrayList(u8),
+
+    pub fn connect(
+        allocator: std.mem.Allocator,
+        socket_path: []const u8,
+    ) !Client
+    {
+        return .{
+            .stream = try std.net.connectUnixSocket(socket_path),
+            .buffer = std.ArrayList(u8).init(allocator),
+        };
+    }
+
+    pub fn close(
+        self: *@This(),
+    ) void
+    {
+        self.stream.close();
+        self.buffer.deinit();
+    }
+
+    /// project ordinates through the resident map.  The samples of
+    /// ordinates[i] end up in samples[offsets[i]..offsets[i+1]].
+    pub fn project(
+        self: *@This(),
+        ordinates: []const f64,
+        samples: *std.ArrayList(WireSample),
+        offsets: *std.ArrayList(u32),
+    ) !void
+    {
+        try self.send(.project, ordinates.len, std.mem.sliceAsBytes(ordinates));
+        try self.receive_batch(WireSample, ordinates.len, samples, offsets);
+    }
+
+    /// media needed for each range.  The entries of ranges[i] end up in
+    /// entries[offsets[i]..offsets[i+1]].
+    pub fn pull_list(
+        self: *@This(),
+        ranges: []const [2]f64,
+        entries: *std.ArrayList(PullEntry),
+        offsets: *std.ArrayList(u32),
+    ) !void
+    {
+        try self.send(.pull_list, ranges.len, std.mem.sliceAsBytes(ranges));
+        try self.receive_batch(PullEntry, ranges.len, entries, offsets);
+    }
+
+    /// names of the destinations that results refer to by index.  Free with
+    /// allocator.free on each name and on the slice.
+    pub fn destinations(
+        self: *@This(),
+        allocator: std.mem.Allocator,
+    ) ![][]u8
+    {
+        try self.send(.destinations, 0, &.{});
+        const header = try self.receive_header();
+
+        const lengths = try allocator.alloc(u32, header.count);
+        defer allocator.free(lengths);
+        try self.stream.reader().readNoEof(std.mem.sliceAsBytes(lengths));
+
+        const names = try allocator.alloc([]u8, header.count);
+        var read: usize = 0;
+        errdefer {
+            for (names[0..read])
+                |name|
+            {
+                allocator.free(name);
+            }
+            allocator.free(names);
+        }
+
+        for (names, lengths)
+            |*name, len|
+        {
+            name.* = try allocator.alloc(u8, len);
+            read += 1;
+            try self.stream.reader().readNoEof(name.*);
+        }
+
+        return names;
+    }
+
+    fn send(
+        self: *@This(),
+        kind: RequestKind,
+        count: usize,
+        payload: []const u8,
+    ) !void
+    {
+        if (count > MAX_BATCH) {
+            return error.BatchTooLarge;
+        }
+
+        self.buffer.clearRetainingCapacity();
+        try self.buffer.appendSlice(
+            std.mem.asBytes(
+                &Header.init(kind, .ok, @intCast(count))
+            )
+        );
+        try self.buffer.appendSlice(payload);
+        try self.stream.writeAll(self.buffer.items);
+    }
+
+    fn receive_header(
+        self: *@This(),
+    ) !Header
+    {
+        const header = try self.stream.reader().readStruct(Header);
+        if (try header.response_status() != .ok) {
+            return error.BadRequest;
+        }
+        return header;
+    }
+
+    fn receive_batch(
+        self: *@This(),
+        comptime T: type,
+        count: usize,
+        items: *std.ArrayList(T),
+        offsets: *std.ArrayList(u32),
+    ) !void
+    {
+        _ = try self.receive_header();
+
+        try offsets.resize(count + 1);
+        try self.stream.reader().readNoEof(
+            std.mem.sliceAsBytes(offsets.items)
+        );
+
+        try items.resize(offsets.items[count]);
+        try self.stream.reader().readNoEof(
+            std.mem.sliceAsBytes(items.items)
+        );
+
+        if (T == WireSample)
+        {
+            for (items.items)
+                |sample|
+            {
+                _ = try sample.result_kind();
+            }
+        }
+    }
+};
+
+test "server: resident answers match in process queries"
+{
+    if (!std.net.has_unix_sockets) {
+        return error.SkipZigTest;
+    }
+
+    const allocator = std.testing.allocator;
+
+    const gen = try otio.timeline_generator.generate(
+        allocator,
+        .{
+            .track_count = 2,
+            .clips_per_track = 16,
+            .gap_ratio = 0.25,
+            .seed = 96,
+        },
+    );
+    defer gen.deinit();
+
+    var resident = try Resident.init(allocator, gen.ref());
+    defer resident.deinit();
+
+    var path_buf: [64]u8 = undefined;
+    const socket_path = try std.fmt.bufPrint(
+        &path_buf,
+        "/tmp/wrinkles_server_test_{d}.sock",
+        .{ std.time.milliTimestamp() },
+    );
+
+    var stop = std.atomic.Value(bool).init(false);
+    const server_thread = try std.Thread.spawn(
+        .{},
+        serve_for_test,
+        .{ &resident, socket_path, &stop },
+    );
+
+    var client = for (0..100)
+        |_|
+    {
+        break Client.connect(allocator, socket_path) catch {
+            std.time.sleep(10 * std.time.ns_per_ms);
+            continue;
+        };
+    } else return error.ServerDidNotStart;
+
+    defer {
+        client.close();
+        stop.store(true, .release);
+        wake(socket_path);
+        server_thread.join();
+    }
+
+    const extents = resident.program.end_points;
+    const start = extents[0].as(f64);
+    const end = extents[extents.len - 1].as(f64);
+
+    const ords = [_]f64{
+        start,
+        (start + end) / 2,
+        end - 0.01,
+        end + 1,
+    };
+
+    var samples = std.ArrayList(WireSample).init(allocator);
+    defer samples.deinit();
+    var offsets = std.ArrayList(u32).init(allocator);
+    defer offsets.deinit();
+
+    try client.project(&ords, &samples, &offsets);
+
+    var expected: [16]otio.evaluation_program.Sample = undefined;
+    for (ords, 0..)
+        |ord, ind|
+    {
+        const count = resident.program.evaluate_into(
+            opentime.Ordinate.init(ord),
+            &expected,
+        );
+        const got = samples.items[offsets.items[ind]..offsets.items[ind + 1]];
+
+        try std.testing.expectEqual(count, got.len);
+        for (expected[0..count], got)
+            |e, g|
+        {
+            try std.testing.expectEqual(WireSample.init(e), g);
+        }
+    }
+
+    // whole timeline pull list names every destination once
+    var entries = std.ArrayList(PullEntry).init(allocator);
+    defer entries.deinit();
+    try client.pull_list(&.{ .{ start, end } }, &entries, &offsets);
+
+    var in_process = std.ArrayList(PullEntry).init(allocator);
+    defer in_process.deinit();
+    try resident.pull_list_into(
+        allocator,
+        .{ .start = extents[0], .end = extents[extents.len - 1] },
+        &in_process,
+    );
+
+    try std.testing.expectEqual(2, offsets.items.len);
+    try std.testing.expectEqualSlices(
+        PullEntry,
+        in_process.items,
+        entries.items,
+    );
+    try std.testing.expectEqual(
+        resident.program.destinations.len,
+        entries.items.len,
+    );
+
+    const names = try client.destinations(allocator);
+    defer {
+        for (names)
+            |name|
+        {
+            allocator.free(name);
+        }
+        allocator.free(names);
+    }
+    try std.testing.expectEqual(resident.program.destinations.len, names.len);
+
+    // malformed requests are refused without taking the server down
+    {
+        const raw = try std.net.connectUnixSocket(socket_path);
+        defer raw.close();
+
+        try raw.writeAll(
+            std.mem.asBytes(&Header{ .kind = 200, .count = 0 })
+        );
+        const response = try raw.reader().readStruct(Header);
+        try std.testing.expectEqual(
+            Status.bad_request,
+            try response.response_status(),
+        );
+        try std.testing.expectError(
+            error.EndOfStream,
+            raw.reader().readByte(),
+        );
+    }
+    {
+        var bad_client = try Client.connect(allocator, socket_path);
+        defer bad_client.close();
+
+        try std.testing.expectError(
+            error.BadRequest,
+            bad_client.project(
+                &.{ start, std.math.nan(f64) },
+                &samples,
+                &offsets,
+            ),
+        );
+    }
+    {
+        var bad_client = try Client.connect(allocator, socket_path);
+        defer bad_client.close();
+
+        try std.testing.expectError(
+            error.BadRequest,
+            bad_client.pull_list(&.{ .{ end, start } }, &entries, &offsets),
+        );
+    }
+
+    // and the first connection is still answered
+    try client.project(&ords, &samples, &offsets);
+    try std.testing.expectEqual(ords.len + 1, offsets.items.len);
+}
+
+fn serve_for_test(
+    resident: *const Resident,
+    socket_path: []const u8,
+    stop: *const std.atomic.Value(bool),
+) void
+{
+    serve(resident, socket_path, stop) catch |err| {
+        std.debug.panic("serve: {s}", .{ @errorName(err) });
+    };
+}
@@ -0,0 +1,490 @@
+//! GUI-free computation of the data the visualizers plot.
+//!
+//! transformation_visualizer draws the series built here with implot, and
+//! wrinkles_plot runs the same functions headless and writes the series as
+//! CSV or JSON, so the visualization math can be tested and timed on
+//! machines without a display.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+const topology = @import("topology");
+
+/// default sample count for sampled curves
+pub const DEFAULT_STEPS = 1000;
+
+/// a named polyline.  name, xv and yv are owned by the series.
+pub const Series = struct {
+    name: []const u8,
+    xv: []f64,
+    yv: []f64,
+
+    /// allocate a series of len (undefined) points
+    pub fn init(
+        allocator: std.mem.Allocator,
+        name: []const u8,
+        len: usize,
+    ) !Series
+    {
+        const name_copy = try allocator.dupe(u8, name);
+        errdefer allocator.free(name_copy);
+
+        const xv = try allocator.alloc(f64, len);
+        errdefer allocator.free(xv);
+
+        return .{
+            .name = name_copy,
+            .xv = xv,
+            .yv = try allocator.alloc(f64, len),
+        };
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        allocator.free(self.name);
+        allocator.free(self.xv);
+        allocator.free(self.yv);
+    }
+};
+
+/// deinit every series in the slice and free it
+pub fn deinit_series(
+    allocator: std.mem.Allocator,
+    series: []const Series,
+) void
+{
+    for (series)
+        |s|
+    {
+        s.deinit(allocator);
+    }
+    allocator.free(series);
+}
+
+/// the points of map needed to draw it.  Infinite input bounds are clamped
+/// to limits, which is typically the visible range of the plot.
+pub fn mapping_series(
+    allocator: std.mem.Allocator,
+    name: []const u8,
+    map: topology.mapping.Mapping,
+    limits: [2]f64,
+) !Series
+{
+    const input_bounds_ord = map.input_bounds();
+    const input_bounds: [2]f64 = .{
+        if (input_bounds_ord.start.is_inf()) limits[0]
+        else input_bounds_ord.start.as(f64),
+        if (input_bounds_ord.end.is_inf()) limits[1]
+        else input_bounds_ord.end.as(f64),
+    };
+
+    switch (map) {
+        .affine => |map_aff| {
+            var result = try Series.init(allocator, name, 2);
+            errdefer result.deinit(allocator);
+
+            for (input_bounds, result.xv, result.yv)
+                |in, *x, *y|
+            {
+                x.* = in;
+                y.* = (
+                    try map_aff.project_instantaneous_cc(
+                        opentime.Ordinate.init(in)
+                    ).ordinate()
+                ).as(f64);
+            }
+
+            return result;
+        },
+        .linear => |map_lin| {
+            const knots = map_lin.input_to_output_curve.knots;
+
+            var result = try Series.init(allocator, name, knots.len);
+            for (knots, result.xv, result.yv)
+                |k, *x, *y|
+            {
+                x.* = k.in.as(f64);
+                y.* = k.out.as(f64);
+            }
+
+            return result;
+        },
+        .empty => return try Series.init(allocator, name, 0),
+    }
+}
+
+/// sample crv at steps evenly spaced parameters, divided between its
+/// segments.  Sampling the segment parameter rather than the input ordinate
+/// also draws curves that are not monotonic in their input.
+pub fn bezier_series(
+    allocator: std.mem.Allocator,
+    name: []const u8,
+    crv: curve.Bezier,
+    steps: usize,
+) !Series
+{
+    if (crv.segments.len == 0) {
+        return try Series.init(allocator, name, 0);
+    }
+
+    const steps_per_segment = @max(steps / crv.segments.len, 1);
+
+    var result = try Series.init(
+        allocator,
+        name,
+        crv.segments.len * steps_per_segment + 1,
+    );
+
+    const step_count_f: opentime.Ordinate.BaseType = @floatFromInt(
+        steps_per_segment
+    );
+
+    var ind: usize = 0;
+    for (crv.segments)
+        |seg|
+    {
+        for (0..steps_per_segment)
+            |step|
+        {
+            const u = @as(
+                opentime.Ordinate.BaseType,
+                @floatFromInt(step)
+            ) / step_count_f;
+
+            const pt = seg.eval_at(u);
+            result.xv[ind] = pt.in.as(f64);
+            result.yv[ind] = pt.out.as(f64);
+            ind += 1;
+        }
+    }
+
+    // guarantee that the series hits the end point
+    const end_point = crv.segments[crv.segments.len - 1].p3;
+    result.xv[ind] = end_point.in.as(f64);
+    result.yv[ind] = end_point.out.as(f64);
+
+    return result;
+}
+
+/// the knots of crv
+pub fn linear_series(
+    allocator: std.mem.Allocator,
+    name: []const u8,
+    crv: curve.Linear,
+) !Series
+{
+    var result = try Series.init(allocator, name, crv.knots.len);
+    for (crv.knots, result.xv, result.yv)
+        |k, *x, *y|
+    {
+        x.* = k.in.as(f64);
+        y.* = k.out.as(f64);
+    }
+    return result;
+}
+
+/// approximate each segment of crv with the three point method, using the
+/// point and derivative at parameter u of each segment
+pub fn three_point_approximation(
+    allocator: std.mem.Allocator,
+    crv: curve.Bezier,
+    u: curve.bezier_curve.U_TYPE,
+) !curve.Bezier
+{
+    const segments = try allocator.alloc(
+        curve.Bezier.Segment,
+        crv.segments.len
+    );
+    errdefer allocator.free(segments);
+
+    for (crv.segments, segments)
+        |seg, *approx|
+    {
+        const mid_point = seg.eval_at_dual(
+            .{
+                .r = opentime.Ordinate.init(u),
+                .i = opentime.Ordinate.ONE,
+            }
+        );
+
+        approx.* = (
+            curve.Bezier.Segment.init_approximate_from_three_points(
+                seg.p0,
+                mid_point.r,
+                u,
+                mid_point.i,
+                seg.p3,
+            ) orelse return error.NoApproximation
+        );
+    }
+
+    return .{ .segments = segments };
+}
+
+/// a space in a chain of mappings
+pub const Space = struct {
+    name: []const u8,
+    input: []const u8,
+    output: []const u8,
+    mapping: topology.mapping.Mapping,
+};
+
+/// a chain of spaces, joined in order
+pub const Preset = struct {
+    spaces: []const Space = &.{},
+};
+
+/// preset mapping chains for transformation_visualizer and wrinkles_plot.
+/// Every pub const decl is a Preset.
+pub const PRESETS = struct{
+    pub const single_identity = Preset{
+        .spaces = &.{
+            .{
+                .name = "Clip",
+                .input = "presentation",
+                .output = "media",
+                .mapping = topology.mapping.INFINITE_IDENTITY,
+            },
+        },
+    };
+
+    pub const single_affine = Preset{
+        .spaces = &.{
+            .{
+                .name = "Clip",
+                .input = "presentation",
+                .output = "media",
+                .mapping = (
+                    topology.mapping.MappingAffine{
+                        .input_bounds_val = opentime.ContinuousInterval.init(
+                            .{
+                                .start = -10,
+                                .end = 10,
+                            },
+                        ),
+                        .input_to_output_xform = .{
+                                .offset = opentime.Ordinate.init(10),
+                                .scale = opentime.Ordinate.init(2),
+                        },
+                    }
+                ).mapping(),
+            },
+        },
+    };
+
+    pub const affine_linear = Preset{
+        .spaces = &.{
+            .{
+                .name = "Track",
+                .input = "presentation",
+                .output = "media",
+                .mapping = (
+                    topology.mapping.MappingAffine{
+                        .input_bounds_val = opentime.ContinuousInterval.init(
+                            .{
+                                .start = -10,
+                                .end = 10,
+                            }
+                        ),
+                        .input_to_output_xform = .{
+                            .offset = opentime.Ordinate.init(10),
+                            .scale = opentime.Ordinate.init(2),
+                        },
+                    }
+                ).mapping(),
+            },
+            .{
+                .name = "Clip",
+                .input = "presentation",
+                .output = "media",
+                .mapping = (
+                    topology.mapping.MappingCurveLinearMonotonic{
+                        .input_to_output_curve = .{
+                                .knots = @constCast(
+                                    &[_]curve.ControlPoint{
+                                        .{
+                                            .in = opentime.Ordinate.init(-10),
+                                            .out = opentime.Ordinate.init(-10),
+                                        },
+                                        .{
+                                            .in = opentime.Ordinate.init(0),
+                                            .out = opentime.Ordinate.init(0),
+                                        },
+                                        .{
+                                            .in = opentime.Ordinate.init(5),
+                                            .out = opentime.Ordinate.init(10),
+                                        },
+                                    },
+                                )
+                            },
+                        }
+                ).mapping(),
+            },
+        },
+    };
+};
+pub const PresetNames = std.meta.DeclEnum(PRESETS);
+
+/// fetch a preset by name
+pub fn preset(
+    name: PresetNames,
+) Preset
+{
+    return switch(name) {
+        inline else => |f| @field(PRESETS, @tagName(f)),
+    };
+}
+
+/// join the mappings of spaces in order.  The result is owned by the caller,
+/// the mappings in spaces are not modified.
+pub fn composed_mapping(
+    allocator: std.mem.Allocator,
+    spaces: []const Space,
+) !topology.mapping.Mapping
+{
+    if (spaces.len == 0) {
+        return topology.mapping.INFINITE_IDENTITY;
+    }
+
+    var total_map = try spaces[0].mapping.clone(allocator);
+    errdefer total_map.deinit(allocator);
+
+    for (spaces[1..])
+        |s|
+    {
+        const next = try topology.mapping.join(
+            allocator,
+            .{
+                .a2b = total_map,
+                .b2c = s.mapping,
+            },
+        );
+        total_map.deinit(allocator);
+        total_map = next;
+    }
+
+    return total_map;
+}
+
+/// write series as CSV with the columns series,index,x,y
+pub fn write_csv(
+    writer: anytype,
+    series: []const Series,
+) !void
+{
+    try writer.writeAll("series,index,x,y\n");
+
+    for (series)
+        |s|
+    {
+        for (s.xv, s.yv, 0..)
+            |x, y, ind|
+        {
+            try writer.print(
+                "\"{s}\",{d},{d},{d}\n",
+                .{ s.name, ind, x, y },
+            );
+        }
+    }
+}
+
+test "plot_series: mapping_series"
+{
+    const allocator = std.testing.allocator;
+
+    // infinite identity is clamped to the limits
+    {
+        const s = try mapping_series(
+            allocator,
+            "identity",
+            topology.mapping.INFINITE_IDENTITY,
+            .{ -2, 3 },
+        );
+        defer s.deinit(allocator);
+
+        try std.testing.expectEqualSlices(f64, &.{ -2, 3 }, s.xv);
+        try std.testing.expectEqualSlices(f64, &.{ -2, 3 }, s.yv);
+    }
+
+    // linear mappings plot their knots
+    {
+        const chain = preset(.affine_linear);
+        const s = try mapping_series(
+            allocator,
+            "clip",
+            chain.spaces[1].mapping,
+            .{ -100, 100 },
+        );
+        defer s.deinit(allocator);
+
+        try std.testing.expectEqualSlices(f64, &.{ -10, 0, 5 }, s.xv);
+        try std.testing.expectEqualSlices(f64, &.{ -10, 0, 10 }, s.yv);
+    }
+}
+
+test "plot_series: composed_mapping of every preset"
+{
+    const allocator = std.testing.allocator;
+
+    inline for (comptime std.enums.values(PresetNames))
+        |name|
+    {
+        const chain = preset(name);
+
+        const total = try composed_mapping(allocator, chain.spaces);
+        defer total.deinit(allocator);
+
+        const s = try mapping_series(allocator, "total", total, .{ -1, 1 });
+        defer s.deinit(allocator);
+
+        for (s.xv, s.yv)
+            |x, y|
+        {
+            try std.testing.expect(std.math.isFinite(x));
+            try std.testing.expect(std.math.isFinite(y));
+        }
+    }
+}
+
+test "plot_series: bezier_series and three_point_approximation"
+{
+    const allocator = std.testing.allocator;
+
+    const crv = try curve.Bezier.init_from_start_end(
+        allocator,
+        curve.ControlPoint.init(.{ .in = 0, .out = 0 }),
+        curve.ControlPoint.init(.{ .in = 10, .out = 20 }),
+    );
+    defer crv.deinit(allocator);
+
+    const s = try bezier_series(allocator, "line", crv, 10);
+    defer s.deinit(allocator);
+
+    try std.testing.expectEqual(11, s.xv.len);
+    try std.testing.expectEqual(0, s.xv[0]);
+    try std.testing.expectEqual(10, s.xv[10]);
+    try std.testing.expectApproxEqAbs(10, s.yv[5], 1e-6);
+
+    // a line is its own three point approximation
+    const approx = try three_point_approximation(allocator, crv, 0.5);
+    defer approx.deinit(allocator);
+
+    try std.testing.expectEqual(1, approx.segments.len);
+    try std.testing.expectApproxEqAbs(
+        20,
+        approx.segments[0].p3.out.as(f64),
+        1e-6,
+    );
+
+    var buf = std.ArrayList(u8).init(allocator);
+    defer buf.deinit();
+    try write_csv(buf.writer(), &.{ s });
+
+    try std.testing.expect(
+        std.mem.startsWith(u8, buf.items, "series,index,x,y\n\"line\",0,0,0\n")
+    );
+}
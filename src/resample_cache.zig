@@ -0,0 +1,673 @@
+//! Byte budgeted LRU cache of resampled sample blocks.
+//!
+//! Scrubbing over the same region re-runs transform_resample_dd on the same
+//! media, through the same operator, at the same output rate.  The cache
+//! splits the output index space into blocks of `block_samples` samples and
+//! keeps rendered blocks keyed on
+//!
+//!     (media, operator, output rate, step_transform, block index)
+//!
+//! A request for a range of output samples copies the blocks that are
+//! already cached and renders each run of missing blocks with one call to
+//! transform_resample_dd on the operator trimmed to that run.  When the sum
+//! of the blocks exceeds the budget the least recently used ones are
+//! dropped.
+//!
+//! `media` is a caller supplied identity for the input sampling (usually its
+//! address).  The operator is identified by a hash of its mappings, so once
+//! the operator map is rebuilt the blocks of the old operators are no longer
+//! reachable and age out.  invalidate() drops the blocks of a media at once.
+//!
+//! Runs are rendered independently, so for interpolating media the samples
+//! next to a run boundary can differ slightly from a single render of the
+//! whole range.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const topology = @import("topology");
+
+const sampling = @import("sampling.zig");
+const sample_value_t = sampling.sample_value_t;
+const sample_index_t = sampling.sample_index_t;
+
+/// knobs for the cache
+pub const Options = struct {
+    /// samples per block
+    block_samples: usize = 4096,
+    /// upper bound on the bytes of sample data held by the cache
+    budget_bytes: usize = 64 * 1024 * 1024,
+};
+
+/// identity of one rendered block
+pub const Key = struct {
+    media: usize,
+    /// see operator_hash
+    operator: u64,
+    rate_num: sampling.sample_rate_base_t,
+    rate_den: sampling.sample_rate_base_t,
+    step_transform: bool,
+    /// block covers output indices [block * block_samples, +block_samples)
+    block: usize,
+};
+
+/// hash of the mappings of an output_c_to_input_c operator
+pub fn operator_hash(
+    output_c_to_input_c: topology.Topology,
+) u64
+{
+    var hasher = std.hash.Wyhash.init(0);
+
+    for (output_c_to_input_c.mappings)
+        |m|
+    {
+        // widened, so that no padding bits of the tag are hashed
+        const tag: u32 = @intFromEnum(std.meta.activeTag(m));
+        hasher.update(std.mem.asBytes(&tag));
+        switch (m) {
+            .empty => |e| {
+                hasher.update(std.mem.asBytes(&e.defined_range));
+            },
+            .affine => |aff| {
+                hasher.update(std.mem.asBytes(&aff.input_bounds_val));
+                hasher.update(std.mem.asBytes(&aff.input_to_output_xform));
+            },
+            .linear => |lin| {
+                hasher.update(
+                    std.mem.sliceAsBytes(lin.input_to_output_curve.knots)
+                );
+            },
+        }
+    }
+
+    return hasher.final();
+}
+
+/// counters of a ResampleCache
+pub const Stats = struct {
+    /// blocks copied out of the cache
+    hits: usize = 0,
+    /// blocks rendered
+    misses: usize = 0,
+    /// blocks dropped to stay within the budget
+    evictions: usize = 0,
+    /// blocks currently held
+    blocks: usize = 0,
+    /// bytes of sample data currently held
+    bytes: usize = 0,
+
+    /// fraction of requested blocks that were served from the cache
+    pub fn hit_rate(
+        self: @This(),
+    ) f64
+    {
+        const total = self.hits + self.misses;
+        if (total == 0) {
+            return 0;
+        }
+
+        return (
+            @as(f64, @floatFromInt(self.hits))
+            / @as(f64, @floatFromInt(total))
+        );
+    }
+};
+
+const Block = struct {
+    key: Key,
+    samples: []sample_value_t,
+};
+
+/// least recently used first
+const LruList = std.DoublyLinkedList(Block);
+
+pub const ResampleCache = struct {
+    allocator: std.mem.Allocator,
+    options: Options = .{},
+    entries: std.AutoHashMapUnmanaged(Key, *LruList.Node) = .{},
+    lru: LruList = .{},
+    stats: Stats = .{},
+
+    pub fn init(
+        allocator: std.mem.Allocator,
+        options: Options,
+    ) ResampleCache
+    {
+        std.debug.assert(options.block_samples > 0);
+
+        return .{
+            .allocator = allocator,
+            .options = options,
+        };
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        while (self.lru.pop())
+            |node|
+        {
+            self.free_node(node);
+        }
+        self.entries.deinit(self.allocator);
+    }
+
+    fn free_node(
+        self: @This(),
+        node: *LruList.Node,
+    ) void
+    {
+        self.allocator.free(node.data.samples);
+        self.allocator.destroy(node);
+    }
+
+    fn remove(
+        self: *@This(),
+        node: *LruList.Node,
+    ) void
+    {
+        _ = self.entries.remove(node.data.key);
+        self.lru.remove(node);
+        self.stats.blocks -= 1;
+        self.stats.bytes -= node.data.samples.len * @sizeOf(sample_value_t);
+        self.free_node(node);
+    }
+
+    /// drop every block
+    pub fn clear(
+        self: *@This(),
+    ) void
+    {
+        while (self.lru.first)
+            |node|
+        {
+            self.remove(node);
+        }
+    }
+
+    /// drop every block rendered from media
+    pub fn invalidate(
+        self: *@This(),
+        media: usize,
+    ) void
+    {
+        var maybe_node = self.lru.first;
+        while (maybe_node)
+            |node|
+        {
+            maybe_node = node.next;
+            if (node.data.key.media == media) {
+                self.remove(node);
+            }
+        }
+    }
+
+    /// Fill result with output samples [first_index, first_index +
+    /// result.len) of transform_resample_dd(input_d_sampling,
+    /// output_c_to_input_c, output_d_sampling_info, step_transform), where
+    /// output index i is at ordinate i / rate in the output space.  Samples
+    /// the operator does not cover are 0.
+    pub fn samples_into(
+        self: *@This(),
+        media: usize,
+        input_d_sampling: sampling.Sampling,
+        output_c_to_input_c: topology.Topology,
+        output_d_sampling_info: sampling.SampleIndexGenerator,
+        step_transform: bool,
+        first_index: sample_index_t,
+        result: []sample_value_t,
+    ) !void
+    {
+        if (result.len == 0) {
+            return;
+        }
+
+        const block_samples = self.options.block_samples;
+
+        var key = Key{
+            .media = media,
+            .operator = operator_hash(output_c_to_input_c),
+            .rate_num = switch (output_d_sampling_info.sample_rate_hz) {
+                .Int => |b| b,
+                .Rat => |r| r.num,
+            },
+            .rate_den = switch (output_d_sampling_info.sample_rate_hz) {
+                .Int => 1,
+                .Rat => |r| r.den,
+            },
+            .step_transform = step_transform,
+            .block = 0,
+        };
+
+        const last_block = (first_index + result.len - 1) / block_samples;
+
+        var block = first_index / block_samples;
+        while (block <= last_block)
+        {
+            key.block = block;
+            if (self.entries.get(key))
+                |node|
+            {
+                self.lru.remove(node);
+                self.lru.append(node);
+                self.stats.hits += 1;
+
+                copy_block(
+                    node.data.samples,
+                    block * block_samples,
+                    first_index,
+                    result,
+                );
+                block += 1;
+                continue;
+            }
+
+            // the run of missing blocks starting at block
+            var run_end = block + 1;
+            while (run_end <= last_block)
+                : (run_end += 1)
+            {
+                key.block = run_end;
+                if (self.entries.contains(key)) {
+                    break;
+                }
+            }
+
+            try self.render_run(
+                key,
+                block,
+                run_end,
+                input_d_sampling,
+                output_c_to_input_c,
+                output_d_sampling_info,
+                step_transform,
+                first_index,
+                result,
+            );
+            block = run_end;
+        }
+    }
+
+    /// render blocks [first_block, end_block), copy them into result and
+    /// keep them
+    fn render_run(
+        self: *@This(),
+        key: Key,
+        first_block: usize,
+        end_block: usize,
+        input_d_sampling: sampling.Sampling,
+        output_c_to_input_c: topology.Topology,
+        output_d_sampling_info: sampling.SampleIndexGenerator,
+        step_transform: bool,
+        first_index: sample_index_t,
+        result: []sample_value_t,
+    ) !void
+    {
+        const block_samples = self.options.block_samples;
+
+        const rendered = try self.allocator.alloc(
+            sample_value_t,
+            (end_block - first_block) * block_samples,
+        );
+        defer self.allocator.free(rendered);
+        @memset(rendered, 0);
+
+        try render_into(
+            self.allocator,
+            input_d_sampling,
+            output_c_to_input_c,
+            output_d_sampling_info,
+            step_transform,
+            .{
+                .start = output_d_sampling_info.ordinate_at_index(
+                    first_block * block_samples
+                ),
+                .end = output_d_sampling_info.ordinate_at_index(
+                    end_block * block_samples
+                ),
+            },
+            rendered,
+        );
+
+        self.stats.misses += end_block - first_block;
+
+        var block_key = key;
+        for (first_block..end_block)
+            |block|
+        {
+            const samples = rendered[
+                (block - first_block) * block_samples..
+            ][0..block_samples];
+
+            // copy first, keeping the block may evict earlier blocks of the
+            // same request
+            copy_block(samples, block * block_samples, first_index, result);
+
+            block_key.block = block;
+            try self.keep(block_key, samples);
+        }
+    }
+
+    /// add a copy of samples under key, evicting until it fits the budget
+    fn keep(
+        self: *@This(),
+        key: Key,
+        samples: []const sample_value_t,
+    ) !void
+    {
+        const bytes = samples.len * @sizeOf(sample_value_t);
+        if (bytes > self.options.budget_bytes) {
+            return;
+        }
+
+        while (self.stats.bytes + bytes > self.options.budget_bytes)
+        {
+            const oldest = self.lru.first orelse break;
+            self.remove(oldest);
+            self.stats.evictions += 1;
+        }
+
+        const node = try self.allocator.create(LruList.Node);
+        errdefer self.allocator.destroy(node);
+
+        node.* = .{
+            .data = .{
+                .key = key,
+                .samples = try self.allocator.dupe(sample_value_t, samples),
+            },
+        };
+        errdefer self.allocator.free(node.data.samples);
+
+        try self.entries.put(self.allocator, key, node);
+        self.lru.append(node);
+
+        self.stats.blocks += 1;
+        self.stats.bytes += bytes;
+    }
+};
+
+/// copy the part of a block starting at output index block_start that
+/// overlaps result, which starts at first_index
+fn copy_block(
+    block: []const sample_value_t,
+    block_start: sample_index_t,
+    first_index: sample_index_t,
+    result: []sample_value_t,
+) void
+{
+    const lo = @max(block_start, first_index);
+    const hi = @min(block_start + block.len, first_index + result.len);
+    if (lo >= hi) {
+        return;
+    }
+
+    @memcpy(
+        result[lo - first_index..hi - first_index],
+        block[lo - block_start..hi - block_start],
+    );
+}
+
+/// transform_resample_dd the part of output_c_to_input_c over output_range
+/// into rendered, which starts at output_range.start
+fn render_into(
+    allocator: std.mem.Allocator,
+    input_d_sampling: sampling.Sampling,
+    output_c_to_input_c: topology.Topology,
+    output_d_sampling_info: sampling.SampleIndexGenerator,
+    step_transform: bool,
+    output_range: opentime.ContinuousInterval,
+    rendered: []sample_value_t,
+) !void
+{
+    if (output_c_to_input_c.mappings.len == 0) {
+        return;
+    }
+
+    // a range that only touches the operator would trim to an instant
+    const covered = opentime.interval.intersect(
+        output_range,
+        output_c_to_input_c.input_bounds(),
+    ) orelse return;
+    if (!covered.start.lt(covered.end)) {
+        return;
+    }
+
+    const trimmed = try output_c_to_input_c.trim_in_input_space(
+        allocator,
+        output_range,
+    );
+    defer trimmed.deinit(allocator);
+    if (trimmed.mappings.len == 0) {
+        return;
+    }
+
+    // trim to the media here as well, so that the start of the result of
+    // transform_resample_dd is known
+    const bounded = try trimmed.trim_in_output_space(
+        allocator,
+        input_d_sampling.extents(),
+    );
+    defer bounded.deinit(allocator);
+    if (bounded.mappings.len == 0) {
+        return;
+    }
+
+    const result = try sampling.transform_resample_dd(
+        allocator,
+        input_d_sampling,
+        bounded,
+        output_d_sampling_info,
+        step_transform,
+    );
+    defer result.deinit();
+
+    const lead_f = @round(
+        bounded.input_bounds().start.sub(output_range.start).mul(
+            output_d_sampling_info.sample_rate_hz.as_ordinate()
+        ).as(f64)
+    );
+    const lead: usize = if (lead_f > 0) @intFromFloat(lead_f) else 0;
+    if (lead >= rendered.len) {
+        return;
+    }
+
+    const count = @min(result.buffer.len, rendered.len - lead);
+    @memcpy(rendered[lead..lead + count], result.buffer[0..count]);
+}
+
+/// a 2s, 4hz ramp and an identity operator over it, dyadic so that block
+/// renders match a whole render exactly
+const TestMedia = struct {
+    ramp: sampling.Sampling,
+    operator: topology.Topology,
+
+    const RATE: sampling.SampleIndexGenerator = .{
+        .sample_rate_hz = .{ .Int = 4 },
+    };
+
+    fn init(
+        allocator: std.mem.Allocator,
+    ) !TestMedia
+    {
+        const ramp_signal = sampling.SignalGenerator{
+            .frequency_hz = 1,
+            .duration_s = opentime.Ordinate.init(2),
+            .signal = .ramp,
+            .amplitude = 4,
+        };
+
+        const ramp = try ramp_signal.rasterized(allocator, RATE, false);
+        errdefer ramp.deinit();
+
+        return .{
+            .ramp = ramp,
+            .operator = try topology.Topology.init_affine(
+                allocator,
+                .{
+                    .input_bounds_val = opentime.ContinuousInterval.init(
+                        .{ .start = 0, .end = 2 }
+                    ),
+                },
+            ),
+        };
+    }
+
+    fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.operator.deinit(allocator);
+        self.ramp.deinit();
+    }
+};
+
+test "ResampleCache: blocks match transform_resample_dd"
+{
+    const allocator = std.testing.allocator;
+
+    const media = try TestMedia.init(allocator);
+    defer media.deinit(allocator);
+
+    const expected = try sampling.transform_resample_dd(
+        allocator,
+        media.ramp,
+        media.operator,
+        TestMedia.RATE,
+        false,
+    );
+    defer expected.deinit();
+    try std.testing.expectEqual(8, expected.buffer.len);
+
+    var cache = ResampleCache.init(allocator, .{ .block_samples = 2 });
+    defer cache.deinit();
+
+    var result: [8]sample_value_t = undefined;
+
+    // cold, every block is rendered
+    try cache.samples_into(
+        1,
+        media.ramp,
+        media.operator,
+        TestMedia.RATE,
+        false,
+        0,
+        &result,
+    );
+    try std.testing.expectEqualSlices(
+        sample_value_t,
+        expected.buffer,
+        &result,
+    );
+    try std.testing.expectEqual(4, cache.stats.misses);
+    try std.testing.expectEqual(0, cache.stats.hits);
+    try std.testing.expectEqual(4, cache.stats.blocks);
+    try std.testing.expectEqual(
+        8 * @sizeOf(sample_value_t),
+        cache.stats.bytes,
+    );
+
+    // block aligned partial hit, served without rendering
+    try cache.samples_into(
+        1,
+        media.ramp,
+        media.operator,
+        TestMedia.RATE,
+        false,
+        3,
+        result[0..4],
+    );
+    try std.testing.expectEqualSlices(
+        sample_value_t,
+        expected.buffer[3..7],
+        result[0..4],
+    );
+    try std.testing.expectEqual(4, cache.stats.misses);
+    try std.testing.expectEqual(3, cache.stats.hits);
+
+    // past the end of the operator is silence
+    try cache.samples_into(
+        1,
+        media.ramp,
+        media.operator,
+        TestMedia.RATE,
+        false,
+        8,
+        result[0..2],
+    );
+    try std.testing.expectEqualSlices(
+        sample_value_t,
+        &.{ 0, 0 },
+        result[0..2],
+    );
+}
+
+test "ResampleCache: budget and invalidation"
+{
+    const allocator = std.testing.allocator;
+
+    const media = try TestMedia.init(allocator);
+    defer media.deinit(allocator);
+
+    var cache = ResampleCache.init(
+        allocator,
+        .{
+            .block_samples = 2,
+            .budget_bytes = 2 * 2 * @sizeOf(sample_value_t),
+        },
+    );
+    defer cache.deinit();
+
+    var result: [8]sample_value_t = undefined;
+
+    try cache.samples_into(
+        1,
+        media.ramp,
+        media.operator,
+        TestMedia.RATE,
+        false,
+        0,
+        &result,
+    );
+    try std.testing.expectEqual(2, cache.stats.blocks);
+    try std.testing.expectEqual(2, cache.stats.evictions);
+    try std.testing.expect(cache.stats.bytes <= cache.options.budget_bytes);
+
+    // the last blocks are the ones kept
+    try cache.samples_into(
+        1,
+        media.ramp,
+        media.operator,
+        TestMedia.RATE,
+        false,
+        4,
+        result[0..4],
+    );
+    try std.testing.expectEqual(2, cache.stats.hits);
+    try std.testing.expectEqual(4, cache.stats.misses);
+    try std.testing.expectEqual(@as(f64, 2.0 / 6.0), cache.stats.hit_rate());
+
+    // a different operator does not see the old blocks
+    const slower = try topology.Topology.init_affine(
+        allocator,
+        .{
+            .input_bounds_val = opentime.ContinuousInterval.init(
+                .{ .start = 0, .end = 2 }
+            ),
+            .input_to_output_xform = .{
+                .scale = opentime.Ordinate.init(0.5),
+            },
+        },
+    );
+    defer slower.deinit(allocator);
+    try std.testing.expect(
+        operator_hash(slower) != operator_hash(media.operator)
+    );
+
+    cache.invalidate(2);
+    try std.testing.expectEqual(2, cache.stats.blocks);
+    cache.invalidate(1);
+    try std.testing.expectEqual(0, cache.stats.blocks);
+    try std.testing.expectEqual(0, cache.stats.bytes);
+}
@@ -19,6 +19,14 @@ const opentime = @import("opentime");
 const topology = @import("topology");
 
 const build_options = @import("build_options");
+const tracing = @import("tracing");
+
+pub const resample_cache = @import("resample_cache.zig");
+pub const ResampleCache = resample_cache.ResampleCache;
+
+test {
+    _ = resample_cache;
+}
 
 // configuration
 const RESAMPLE_DEBUG_LOGGING = false;
@@ -754,6 +762,12 @@ pub fn transform_resample_dd(
     step_transform: bool,
 ) !Sampling
 {
+    const span = tracing.begin_sized(
+        "sampling.transform_resample_dd",
+        input_d_sampling.buffer.len,
+    );
+    defer span.end();
+
     // bound input_c_to_output_c_topo by the implicit space of in_samples
     const input_c_bound = input_d_sampling.extents();
 
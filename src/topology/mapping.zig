@@ -67,6 +67,19 @@ pub const Mapping = union (enum) {
         };
     }
 
+    /// project a dual ordinate from the input space to the output space,
+    /// carrying the derivative in input.i through the mapping.  Null where
+    /// project_instantaneous_cc does not return an ordinate.
+    pub fn project_instantaneous_cc_dual(
+        self: @This(),
+        input: opentime.Dual_Ord,
+    ) ?opentime.Dual_Ord
+    {
+        return switch (self) {
+            inline else => |m| m.project_instantaneous_cc_dual(input),
+        };
+    }
+
     /// project an instantaneous ordinate from the output space to the input
     /// space
     pub fn project_instantaneous_cc_inv(
@@ -447,6 +460,8 @@ test "Mapping: join_aff_aff"
     );
 }
 
+/// join an affine a2b with a linear b2c by carrying the knots of b2c back
+/// through the inverse of the affine, without linearizing the affine
 pub fn join_aff_lin(
     allocator: std.mem.Allocator,
     args: struct{
@@ -455,32 +470,33 @@ pub fn join_aff_lin(
     },
 ) !mapping_curve_linear.MappingCurveLinearMonotonic
 {
-    const a2b_input_bounds = args.a2b.input_bounds();
-    const a2b_output_bounds = args.a2b.input_bounds();
-    const a2b_linearized = (
-        mapping_curve_linear.MappingCurveLinearMonotonic{
-            .input_to_output_curve = .{
-                .knots = &.{
-                    .{ 
-                        .in = a2b_input_bounds.start,
-                        .out = a2b_output_bounds.start,
-                    },
-                    .{ 
-                        .in = a2b_input_bounds.end,
-                        .out = a2b_output_bounds.end,
-                    },
-                },
-            },
-        }
+    const b2a_xform = args.a2b.input_to_output_xform.inverted();
+
+    const a2c_knots = (
+        try allocator.dupe(
+            curve.ControlPoint,
+            args.b2c.input_to_output_curve.knots,
+        )
     );
+    errdefer allocator.free(a2c_knots);
 
-    return join_lin_lin(
-        allocator,
-        .{
-            .a2b = a2b_linearized,
-            .b2c = args.b2c,
+    for (a2c_knots)
+        |*k|
+    {
+        k.*.in = b2a_xform.applied_to_ordinate(k.in);
+    }
+
+    // a negative scale reverses the order of the knots in the input space
+    if (args.a2b.input_to_output_xform.scale.lt(0))
+    {
+        std.mem.reverse(curve.ControlPoint, a2c_knots);
+    }
+
+    return .{
+        .input_to_output_curve = .{
+            .knots = a2c_knots,
         },
-    );
+    };
 }
 
 pub fn join_lin_aff(
@@ -545,13 +561,14 @@ pub fn join_lin_lin(
 /// Handles the type mapping:
 ///
 ///     .    a2b ->
-/// b2c v  | empty | affine | linear | bezier |
-/// -------|-------|--------|--------|--------|
-/// empty  | empty | empty  | empty  | empty  | 
-/// affine | empty | affine | linear | linear |
-/// linear | empty | linear | linear | linear |
-/// bezier | empty | linear | linear | linear |
-/// -------|-------|--------|--------|--------|
+/// b2c v  | empty | affine | linear |
+/// -------|-------|--------|--------|
+/// empty  | empty | empty  | empty  |
+/// affine | empty | affine | linear |
+/// linear | empty | linear | linear |
+/// -------|-------|--------|--------|
+///
+/// Each cell is a kernel in join_specialized, selected at compile time.
 ///
 /// (return value is always a `Mapping`)
 ///
@@ -608,47 +625,65 @@ pub fn join(
     );
     defer b2c_trimmed.deinit(allocator);
 
-    return switch (b2c_trimmed) {
-        .affine => |b2c_aff| switch (a2b_trimmed) {
-            .affine => |a2b_aff| join_aff_aff(
-                .{
-                    .a2b = a2b_aff, 
-                    .b2c = b2c_aff, 
-                },
+    return switch (a2b_trimmed) {
+        inline else => |a2b_m, a2b_tag| switch (b2c_trimmed) {
+            inline else => |b2c_m, b2c_tag| try join_specialized(
+                allocator,
+                a2b_tag,
+                b2c_tag,
+                a2b_m,
+                b2c_m,
+            ),
+        },
+    };
+}
+
+/// join kernel for one pair of mapping kinds.  The switches are on comptime
+/// tags, so each instantiation contains only its own kernel, and adding a kind
+/// to Mapping fails to compile until its row and column are filled in.
+pub fn join_specialized(
+    allocator: std.mem.Allocator,
+    comptime a2b_tag: std.meta.Tag(Mapping),
+    comptime b2c_tag: std.meta.Tag(Mapping),
+    a2b: std.meta.TagPayload(Mapping, a2b_tag),
+    b2c: std.meta.TagPayload(Mapping, b2c_tag),
+) !Mapping
+{
+    const empty_result = (
+        MappingEmpty{
+            .defined_range = a2b.input_bounds(),
+        }
+    ).mapping();
+
+    return switch (a2b_tag) {
+        .empty => empty_result,
+        .affine => switch (b2c_tag) {
+            .empty => empty_result,
+            .affine => join_aff_aff(
+                .{ .a2b = a2b, .b2c = b2c },
             ).mapping(),
-            .linear => |a2b_lin| (
-                try join_lin_aff(
+            .linear => (
+                try join_aff_lin(
                     allocator,
-                    .{ 
-                        .a2b = a2b_lin,
-                        .b2c = b2c_aff 
-                    }
+                    .{ .a2b = a2b, .b2c = b2c },
                 )
             ).mapping(),
-            inline else => unreachable,
         },
-        .linear => |b2c_lin| switch (a2b_trimmed) {
-            .affine => |a2b_aff| ( 
-                try join_aff_lin(
+        .linear => switch (b2c_tag) {
+            .empty => empty_result,
+            .affine => (
+                try join_lin_aff(
                     allocator,
-                    .{
-                        .a2b = a2b_aff,
-                        .b2c = b2c_lin, 
-                    },
+                    .{ .a2b = a2b, .b2c = b2c },
                 )
             ).mapping(),
-            .linear => |a2b_lin| (
+            .linear => (
                 try join_lin_lin(
                     allocator,
-                    .{ 
-                        .a2b = a2b_lin,
-                        .b2c = b2c_lin
-                    },
+                    .{ .a2b = a2b, .b2c = b2c },
                 )
             ).mapping(),
-            inline else => unreachable,
         },
-        inline else => unreachable,
     };
 }
 
@@ -708,3 +743,72 @@ test "Mapping: join aff/aff"
         std.meta.activeTag(result)
     );
 }
+
+test "Mapping: join aff/lin"
+{
+    const allocator = std.testing.allocator;
+
+    const aff = (
+        MappingAffine{
+            .input_bounds_val = (
+                opentime.ContinuousInterval.init(
+                    .{ .start = 0, .end = 10, },
+                )
+            ),
+            .input_to_output_xform = .{
+                .offset = opentime.Ordinate.init(1),
+                .scale = opentime.Ordinate.init(2),
+            },
+        }
+    );
+
+    const lin = (
+        MappingCurveLinearMonotonic{
+            .input_to_output_curve = .{
+                .knots = &.{
+                    curve.ControlPoint.init(.{ .in = 0, .out = 0, }),
+                    curve.ControlPoint.init(.{ .in = 10, .out = 5, }),
+                    curve.ControlPoint.init(.{ .in = 20, .out = 20, }),
+                },
+            },
+        }
+    );
+
+    const result = try join(
+        allocator,
+        .{
+            .a2b = aff.mapping(),
+            .b2c = lin.mapping(),
+        },
+    );
+    defer result.deinit(allocator);
+
+    try std.testing.expectEqual(
+        .linear,
+        std.meta.activeTag(result)
+    );
+
+    // a2b maps [0, 9.5) into the [1, 20) that b2c covers
+    try opentime.expectOrdinateEqual(
+        0,
+        result.input_bounds().start,
+    );
+    try opentime.expectOrdinateEqual(
+        9.5,
+        result.input_bounds().end,
+    );
+
+    for (
+        [_]f64{ 0, 2, 4.5, 7 },
+    )
+        |pt|
+    {
+        const ord = opentime.Ordinate.init(pt);
+        try opentime.expectOrdinateEqual(
+            try lin.project_instantaneous_cc(
+                try aff.project_instantaneous_cc(ord).ordinate()
+            ).ordinate(),
+            try result.project_instantaneous_cc(ord).ordinate(),
+        );
+    }
+}
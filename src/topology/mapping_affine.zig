@@ -51,6 +51,23 @@ pub const MappingAffine = struct {
         };
     }
 
+    /// project a dual ordinate, the derivative is scaled by the scale of the
+    /// transform
+    pub fn project_instantaneous_cc_dual(
+        self: @This(),
+        input: opentime.Dual_Ord,
+    ) ?opentime.Dual_Ord
+    {
+        const value = (
+            self.project_instantaneous_cc(input.r).ordinate() catch return null
+        );
+
+        return .{
+            .r = value,
+            .i = input.i.mul(self.input_to_output_xform.scale),
+        };
+    }
+
     /// project from the output space back to the input space
     pub fn project_instantaneous_cc_inv(
         self: @This(),
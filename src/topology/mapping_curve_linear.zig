@@ -74,6 +74,16 @@ pub const MappingCurveLinearMonotonic = struct {
         return self.input_to_output_curve.output_at_input(input_ordinate);
     }
 
+    /// project a dual ordinate, the derivative is scaled by the slope of the
+    /// curve at input.r
+    pub fn project_instantaneous_cc_dual(
+        self: @This(),
+        input: opentime.Dual_Ord,
+    ) ?opentime.Dual_Ord
+    {
+        return self.input_to_output_curve.output_at_input_dual(input);
+    }
+
     pub fn project_instantaneous_cc_inv(
         self: @This(),
         output_ordinate: opentime.Ordinate,
@@ -139,25 +149,32 @@ pub const MappingCurveLinearMonotonic = struct {
                 input_points,
             )
         );
+        defer allocator.free(new_curves);
+        errdefer {
+            for (new_curves)
+                |crv|
+            {
+                crv.deinit(allocator);
+            }
+        }
 
-        var result_mappings = (
-            std.ArrayList(mapping_mod.Mapping).init(allocator)
+        const result_mappings = try allocator.alloc(
+            mapping_mod.Mapping,
+            new_curves.len,
         );
 
-        for (new_curves)
-            |crv|
+        // the mappings take over the knots of the new curves
+        for (new_curves, result_mappings)
+            |crv, *m|
         {
-            try result_mappings.append(
-                (
-                 try MappingCurveLinearMonotonic.init_curve(
-                     allocator,
-                     crv,
-                 )
-                ).mapping()
-            );
+            m.* = (
+                MappingCurveLinearMonotonic{
+                    .input_to_output_curve = crv,
+                }
+            ).mapping();
         }
 
-        return result_mappings.toOwnedSlice();
+        return result_mappings;
     }
 
     pub fn split_at_input_point(
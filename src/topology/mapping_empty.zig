@@ -29,6 +29,14 @@ pub const MappingEmpty = struct {
         return opentime.OUTOFBOUNDS;
     }
 
+    pub fn project_instantaneous_cc_dual(
+        _: @This(),
+        _: opentime.Dual_Ord,
+    ) ?opentime.Dual_Ord
+    {
+        return null;
+    }
+
     pub fn project_instantaneous_cc_inv(
         _: @This(),
         _: opentime.Ordinate
@@ -0,0 +1,175 @@
+//! Per document storage for the Mappings of many Topologies.
+//!
+//! Mapping headers are handed out from fixed size slabs and knots are bump
+//! allocated from an arena, so the mappings of a document sit together in a
+//! few large blocks instead of one allocation per curve.  Nothing in the pool
+//! is freed individually: Topologies built by the pool must not be passed to
+//! Topology.deinit with another allocator, and the whole document is released
+//! at once by MappingPool.deinit or reset without visiting any mapping.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+
+const mapping = @import("mapping.zig");
+const Topology = @import("topology.zig").Topology;
+
+/// number of mapping headers in a slab
+pub const SLAB_LEN = 256;
+
+/// Slab and arena storage for mappings.  Holds pointers into itself once
+/// used, so it must not be copied or moved afterwards.
+pub const MappingPool = struct {
+    /// backs the slabs of mapping headers
+    headers: std.heap.ArenaAllocator,
+    /// backs the knots of curve mappings
+    knots: std.heap.ArenaAllocator,
+    /// unused tail of the current slab
+    free_headers: []mapping.Mapping = &.{},
+
+    pub fn init(
+        parent_allocator: std.mem.Allocator,
+    ) MappingPool
+    {
+        return .{
+            .headers = std.heap.ArenaAllocator.init(parent_allocator),
+            .knots = std.heap.ArenaAllocator.init(parent_allocator),
+        };
+    }
+
+    /// release every mapping and topology built by the pool
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        self.headers.deinit();
+        self.knots.deinit();
+        self.free_headers = &.{};
+    }
+
+    /// release every mapping and topology built by the pool, keeping the
+    /// memory for reuse
+    pub fn reset(
+        self: *@This(),
+    ) void
+    {
+        _ = self.headers.reset(.retain_capacity);
+        _ = self.knots.reset(.retain_capacity);
+        self.free_headers = &.{};
+    }
+
+    /// allocator for data that lives as long as the pool.  Frees through it
+    /// are no-ops, so existing functions like Topology.clone or join can build
+    /// directly into the pool.
+    pub fn allocator(
+        self: *@This(),
+    ) std.mem.Allocator
+    {
+        return self.knots.allocator();
+    }
+
+    /// a contiguous run of count mapping headers from the current slab,
+    /// starting a new slab if it does not fit
+    pub fn alloc_mappings(
+        self: *@This(),
+        count: usize,
+    ) ![]mapping.Mapping
+    {
+        if (count > self.free_headers.len)
+        {
+            self.free_headers = try self.headers.allocator().alloc(
+                mapping.Mapping,
+                @max(SLAB_LEN, count),
+            );
+        }
+
+        const result = self.free_headers[0..count];
+        self.free_headers = self.free_headers[count..];
+
+        return result;
+    }
+
+    /// copy topo, including its knots, into the pool.  topo is unchanged and
+    /// still owned by the caller.
+    pub fn adopt(
+        self: *@This(),
+        topo: Topology,
+    ) !Topology
+    {
+        const new_mappings = try self.alloc_mappings(topo.mappings.len);
+
+        for (topo.mappings, new_mappings)
+            |m, *new_m|
+        {
+            new_m.* = try m.clone(self.allocator());
+        }
+
+        return .{ .mappings = new_mappings };
+    }
+
+    /// copy the mapping headers of a topology already in the pool.  The knots
+    /// are shared with topo, which is safe because the pool never frees or
+    /// edits them individually.
+    pub fn clone(
+        self: *@This(),
+        topo: Topology,
+    ) !Topology
+    {
+        const new_mappings = try self.alloc_mappings(topo.mappings.len);
+        @memcpy(new_mappings, topo.mappings);
+
+        return .{ .mappings = new_mappings };
+    }
+};
+
+test "MappingPool: adopt, clone and release"
+{
+    const allocator = std.testing.allocator;
+
+    var pool = MappingPool.init(allocator);
+    defer pool.deinit();
+
+    const pooled = blk: {
+        const topo = try Topology.init_from_linear_monotonic(
+            allocator,
+            .{
+                .knots = &.{
+                    curve.ControlPoint.init(.{ .in = 0, .out = 0 }),
+                    curve.ControlPoint.init(.{ .in = 10, .out = 20 }),
+                },
+            },
+        );
+        defer topo.deinit(allocator);
+
+        break :blk try pool.adopt(topo);
+    };
+
+    // still valid after the source topology is freed
+    try opentime.expectOrdinateEqual(
+        10,
+        try pooled.project_instantaneous_cc(
+            opentime.Ordinate.init(5)
+        ).ordinate(),
+    );
+
+    const cloned = try pool.clone(pooled);
+    try std.testing.expect(cloned.mappings.ptr != pooled.mappings.ptr);
+    try std.testing.expectEqual(
+        pooled.mappings[0].linear.input_to_output_curve.knots.ptr,
+        cloned.mappings[0].linear.input_to_output_curve.knots.ptr,
+    );
+
+    // headers of consecutive topologies share a slab
+    try std.testing.expectEqual(
+        pooled.mappings.ptr + 1,
+        cloned.mappings.ptr,
+    );
+
+    // larger than a slab
+    const big = try pool.alloc_mappings(SLAB_LEN + 1);
+    try std.testing.expectEqual(SLAB_LEN + 1, big.len);
+
+    pool.reset();
+    try std.testing.expectEqual(0, pool.free_headers.len);
+}
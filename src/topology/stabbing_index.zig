@@ -0,0 +1,199 @@
+//! Find the intervals containing an ordinate among intervals sorted by start.
+//!
+//! The sorted array is read as an implicit balanced tree: the root of the
+//! range [lo, hi) is its middle element, its children the roots of the two
+//! halves.  subtree_max[mid] holds the largest end in [lo, hi), so a stab
+//! skips every subtree that ends before the ordinate.  That costs
+//! O(log n + k log n) for k hits, where a running maximum over the prefix
+//! degrades to a scan of every earlier interval as soon as one early
+//! interval is wide.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+
+/// deepest tree a Stab can walk, enough for any usize length
+const MAX_DEPTH = @bitSizeOf(usize);
+
+/// ends holds the end of every interval, in start order.  Overwrites it in
+/// place with the subtree maxima that Stab expects.
+pub fn build(
+    ends: []opentime.Ordinate,
+) void
+{
+    _ = build_range(ends, 0, ends.len);
+}
+
+fn build_range(
+    subtree_max: []opentime.Ordinate,
+    lo: usize,
+    hi: usize,
+) opentime.Ordinate
+{
+    if (lo >= hi) {
+        return opentime.Ordinate.INF_NEG;
+    }
+
+    const mid = lo + (hi - lo) / 2;
+    const own_end = subtree_max[mid];
+    const result = opentime.max(
+        own_end,
+        opentime.max(
+            build_range(subtree_max, lo, mid),
+            build_range(subtree_max, mid + 1, hi),
+        ),
+    );
+    subtree_max[mid] = result;
+
+    return result;
+}
+
+/// Iterates, in start order, the indices of the intervals that start at or
+/// before ord and whose subtree reaches ord.  Every interval containing ord
+/// is returned; callers still check their own bounds, as an interval can be
+/// returned for the sake of a longer one below it.
+pub const Stab = struct {
+    subtree_max: []const opentime.Ordinate,
+    ord: opentime.Ordinate,
+    /// intervals at or after limit start after ord
+    limit: usize,
+
+    /// pending work, the top is done next
+    stack: [2 * MAX_DEPTH + 1]Item = undefined,
+    stack_len: usize = 0,
+
+    const Item = struct {
+        lo: usize,
+        hi: usize,
+        /// report mid of [lo, hi) rather than descend into the range
+        node_only: bool = false,
+    };
+
+    /// limit is the number of intervals that start at or before ord
+    pub fn init(
+        subtree_max: []const opentime.Ordinate,
+        ord: opentime.Ordinate,
+        limit: usize,
+    ) Stab
+    {
+        var result = Stab{
+            .subtree_max = subtree_max,
+            .ord = ord,
+            .limit = limit,
+        };
+        result.push(.{ .lo = 0, .hi = subtree_max.len });
+        return result;
+    }
+
+    fn push(
+        self: *@This(),
+        item: Item,
+    ) void
+    {
+        self.stack[self.stack_len] = item;
+        self.stack_len += 1;
+    }
+
+    pub fn next(
+        self: *@This(),
+    ) ?usize
+    {
+        while (self.stack_len > 0)
+        {
+            self.stack_len -= 1;
+            const item = self.stack[self.stack_len];
+
+            if (item.lo >= item.hi or item.lo >= self.limit) {
+                continue;
+            }
+
+            const mid = item.lo + (item.hi - item.lo) / 2;
+            if (item.node_only) {
+                return mid;
+            }
+
+            if (self.subtree_max[mid].lt(self.ord)) {
+                continue;
+            }
+
+            // in order: the lower half, mid, then the upper half
+            if (mid < self.limit)
+            {
+                self.push(.{ .lo = mid + 1, .hi = item.hi });
+                self.push(
+                    .{ .lo = item.lo, .hi = item.hi, .node_only = true }
+                );
+            }
+            self.push(.{ .lo = item.lo, .hi = mid });
+        }
+
+        return null;
+    }
+};
+
+test "stabbing_index: matches a linear scan"
+{
+    const Interval = opentime.ContinuousInterval;
+
+    // one wide interval up front, which defeats a prefix maximum
+    const intervals = [_]Interval{
+        Interval.init(.{ .start = 0, .end = 100 }),
+        Interval.init(.{ .start = 1, .end = 2 }),
+        Interval.init(.{ .start = 3, .end = 4 }),
+        Interval.init(.{ .start = 3, .end = 9 }),
+        Interval.init(.{ .start = 5, .end = 6 }),
+        Interval.init(.{ .start = 7, .end = 8 }),
+        Interval.init(.{ .start = 50, .end = 60 }),
+    };
+
+    var subtree_max: [intervals.len]opentime.Ordinate = undefined;
+    for (intervals, &subtree_max)
+        |interval, *end|
+    {
+        end.* = interval.end;
+    }
+    build(&subtree_max);
+
+    for ([_]f64{ -1, 0, 1.5, 3, 5.5, 8.5, 55, 100, 101 })
+        |value|
+    {
+        const ord = opentime.Ordinate.init(value);
+
+        var limit: usize = 0;
+        while (
+            limit < intervals.len
+            and intervals[limit].start.lteq(ord)
+        ) : (limit += 1)
+        {}
+
+        var expected: [intervals.len]usize = undefined;
+        var expected_len: usize = 0;
+        for (intervals, 0..)
+            |interval, ind|
+        {
+            if (interval.start.lteq(ord) and ord.lteq(interval.end)) {
+                expected[expected_len] = ind;
+                expected_len += 1;
+            }
+        }
+
+        var got: [intervals.len]usize = undefined;
+        var got_len: usize = 0;
+        var stab = Stab.init(&subtree_max, ord, limit);
+        while (stab.next())
+            |ind|
+        {
+            const interval = intervals[ind];
+            if (interval.start.lteq(ord) and ord.lteq(interval.end)) {
+                got[got_len] = ind;
+                got_len += 1;
+            }
+        }
+
+        try std.testing.expectEqualSlices(
+            usize,
+            expected[0..expected_len],
+            got[0..got_len],
+        );
+    }
+}
@@ -4,8 +4,17 @@ const std = @import("std");
 
 const opentime = @import("opentime");
 const curve = @import("curve");
+const tracing = @import("tracing");
 
 pub const mapping = @import("mapping.zig");
+pub const mapping_pool = @import("mapping_pool.zig");
+pub const MappingPool = mapping_pool.MappingPool;
+const stabbing_index = @import("stabbing_index.zig");
+
+test {
+    _ = mapping_pool;
+    _ = stabbing_index;
+}
 
 /// A Topology binds regions of a one dimensional space to a sequence of right
 /// met monotonic mappings, separated by a list of end points.  There are
@@ -286,6 +295,71 @@ pub const Topology = struct {
         return bounds orelse opentime.ContinuousInterval.INF;
     }
 
+    /// size summary of a topology, see stats()
+    pub const Stats = struct {
+        mappings: usize = 0,
+        empty_mappings: usize = 0,
+        affine_mappings: usize = 0,
+        linear_mappings: usize = 0,
+        /// knots of the linear mappings.  Affine mappings count as two
+        /// knots (their end points), empty mappings as none.
+        knots: usize = 0,
+        /// most knots in any single mapping
+        max_knots_per_mapping: usize = 0,
+
+        /// add the counts of other into self
+        pub fn accumulate(
+            self: *@This(),
+            other: Stats,
+        ) void
+        {
+            self.mappings += other.mappings;
+            self.empty_mappings += other.empty_mappings;
+            self.affine_mappings += other.affine_mappings;
+            self.linear_mappings += other.linear_mappings;
+            self.knots += other.knots;
+            self.max_knots_per_mapping = @max(
+                self.max_knots_per_mapping,
+                other.max_knots_per_mapping,
+            );
+        }
+    };
+
+    /// count the mappings and knots in this topology
+    pub fn stats(
+        self: @This(),
+    ) Stats
+    {
+        var result = Stats{ .mappings = self.mappings.len };
+
+        for (self.mappings)
+            |m|
+        {
+            const knots: usize = switch (m) {
+                .empty => blk: {
+                    result.empty_mappings += 1;
+                    break :blk 0;
+                },
+                .affine => blk: {
+                    result.affine_mappings += 1;
+                    break :blk 2;
+                },
+                .linear => |lin| blk: {
+                    result.linear_mappings += 1;
+                    break :blk lin.input_to_output_curve.knots.len;
+                },
+            };
+
+            result.knots += knots;
+            result.max_knots_per_mapping = @max(
+                result.max_knots_per_mapping,
+                knots,
+            );
+        }
+
+        return result;
+    }
+
     pub fn end_points_input(
         self: @This(),
         allocator: std.mem.Allocator,
@@ -839,6 +913,76 @@ pub const Topology = struct {
         };
     }
 
+    /// project a dual ordinate, carrying the derivative in input.i through
+    /// the mapping that contains input.r.  The result of one topology can be
+    /// passed to the next to chain derivatives without joining.  Null where
+    /// project_instantaneous_cc does not return an ordinate.
+    pub fn project_instantaneous_cc_dual(
+        self: @This(),
+        input: opentime.Dual_Ord,
+    ) ?opentime.Dual_Ord
+    {
+        // instants project to intervals, see project_instantaneous_cc
+        if (self.input_bounds().is_instant()) {
+            return null;
+        }
+
+        for (self.mappings)
+            |m|
+        {
+            if (m.input_bounds().overlaps(input.r))
+            {
+                return m.project_instantaneous_cc_dual(input);
+            }
+        }
+
+        return null;
+    }
+
+    /// project each ordinate in input_ords along with d(output)/d(input) at
+    /// that ordinate into result, which must be as long as input_ords.  The
+    /// mappings do not overlap, so the mapping of the previous ordinate is
+    /// tried first and sorted input_ords walk the mappings once.
+    pub fn project_instantaneous_cc_rate_batch(
+        self: @This(),
+        input_ords: []const opentime.Ordinate,
+        result: []?opentime.Dual_Ord,
+    ) void
+    {
+        std.debug.assert(result.len == input_ords.len);
+
+        if (self.mappings.len == 0 or self.input_bounds().is_instant())
+        {
+            @memset(result, null);
+            return;
+        }
+
+        var current: usize = 0;
+        ords: for (input_ords, result)
+            |ord, *dst|
+        {
+            const input = opentime.Dual_Ord.init_ri(ord, opentime.Ordinate.ONE);
+
+            if (!self.mappings[current].input_bounds().overlaps(ord))
+            {
+                current = for (self.mappings, 0..)
+                    |m, ind|
+                {
+                    if (m.input_bounds().overlaps(ord)) {
+                        break ind;
+                    }
+                } else {
+                    dst.* = null;
+                    continue :ords;
+                };
+            }
+
+            dst.* = self.mappings[current].project_instantaneous_cc_dual(
+                input
+            );
+        }
+    }
+
     /// project the output space ordinate into the input space.  Because
     /// monotonicity is only guaranteed in the forward direction, projects to a
     /// slice.
@@ -870,9 +1014,234 @@ pub const Topology = struct {
         return try input_ordinates.toOwnedSlice();
     }
 
+    /// build an index of the mappings of self by output interval, for many
+    /// inverse projections.  The index borrows the mappings of self, which
+    /// must outlive it.
+    pub fn build_output_index(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !OutputIndex
+    {
+        return try OutputIndex.init(allocator, self);
+    }
+
+    /// the mappings of a Topology sorted by output interval.  Replaces the
+    /// linear scan of project_instantaneous_cc_inv with a binary search and
+    /// projects into caller provided buffers.
+    pub const OutputIndex = struct {
+        topology: Topology,
+        /// output bounds of the non empty mappings, sorted by start
+        entries: []const Entry,
+        /// largest end of each subtree of entries, see stabbing_index
+        subtree_max_end: []const opentime.Ordinate,
+
+        pub const Entry = struct {
+            output_bounds: opentime.ContinuousInterval,
+            mapping_index: usize,
+        };
+
+        pub fn init(
+            allocator: std.mem.Allocator,
+            topology: Topology,
+        ) !OutputIndex
+        {
+            var entries = std.ArrayList(Entry).init(allocator);
+            defer entries.deinit();
+
+            for (topology.mappings, 0..)
+                |m, ind|
+            {
+                // empty mappings map nothing into the output space
+                if (m == .empty) {
+                    continue;
+                }
+
+                const bounds = m.output_bounds();
+                try entries.append(
+                    .{
+                        .output_bounds = .{
+                            .start = opentime.min(bounds.start, bounds.end),
+                            .end = opentime.max(bounds.start, bounds.end),
+                        },
+                        .mapping_index = ind,
+                    }
+                );
+            }
+
+            std.mem.sort(Entry, entries.items, {}, entry_start_lt);
+
+            const subtree_max_end = try allocator.alloc(
+                opentime.Ordinate,
+                entries.items.len,
+            );
+            errdefer allocator.free(subtree_max_end);
+
+            for (entries.items, subtree_max_end)
+                |entry, *end|
+            {
+                end.* = entry.output_bounds.end;
+            }
+            stabbing_index.build(subtree_max_end);
+
+            return .{
+                .topology = topology,
+                .entries = try entries.toOwnedSlice(),
+                .subtree_max_end = subtree_max_end,
+            };
+        }
+
+        pub fn deinit(
+            self: @This(),
+            allocator: std.mem.Allocator,
+        ) void
+        {
+            allocator.free(self.entries);
+            allocator.free(self.subtree_max_end);
+        }
+
+        /// write the input ordinates that project to output_ord into result,
+        /// ordered by the output start of their mappings.  Returns how many
+        /// there are, which is larger than result.len if it was too short.
+        /// Costs O(log n + k log n) for k overlapping mappings, however wide
+        /// they are.  Does not allocate.
+        pub fn project_instantaneous_cc_inv_into(
+            self: @This(),
+            output_ord: opentime.Ordinate,
+            result: []opentime.Ordinate,
+        ) usize
+        {
+            // first entry that starts after output_ord
+            var lo: usize = 0;
+            var hi: usize = self.entries.len;
+            while (lo < hi)
+            {
+                const mid = lo + (hi - lo) / 2;
+                if (self.entries[mid].output_bounds.start.lteq(output_ord)) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+
+            var count: usize = 0;
+            var stab = stabbing_index.Stab.init(
+                self.subtree_max_end,
+                output_ord,
+                lo,
+            );
+            while (stab.next())
+                |entry_index|
+            {
+                const entry = self.entries[entry_index];
+                if (
+                    !entry.output_bounds.overlaps(output_ord)
+                    and !output_ord.eql(entry.output_bounds.end)
+                )
+                {
+                    continue;
+                }
+
+                const m = self.topology.mappings[entry.mapping_index];
+                switch (m.project_instantaneous_cc_inv(output_ord)) {
+                    .SuccessOrdinate => |ord| {
+                        if (count < result.len) {
+                            result[count] = ord;
+                        }
+                        count += 1;
+                    },
+                    else => {},
+                }
+            }
+
+            return count;
+        }
+
+        /// inverse project every ordinate in output_ords into result.  The
+        /// input ordinates of output_ords[i] are written to
+        /// result[offsets[i]..offsets[i+1]], so offsets must be one longer
+        /// than output_ords.  Returns error.NoSpaceLeft if result is too
+        /// short.  Does not allocate.
+        pub fn project_instantaneous_cc_inv_batch(
+            self: @This(),
+            output_ords: []const opentime.Ordinate,
+            result: []opentime.Ordinate,
+            offsets: []usize,
+        ) error{NoSpaceLeft}!void
+        {
+            std.debug.assert(offsets.len == output_ords.len + 1);
+
+            var written: usize = 0;
+            for (output_ords, 0..)
+                |ord, ind|
+            {
+                offsets[ind] = written;
+
+                const count = self.project_instantaneous_cc_inv_into(
+                    ord,
+                    result[written..],
+                );
+                written += count;
+                if (written > result.len) {
+                    return error.NoSpaceLeft;
+                }
+            }
+            offsets[output_ords.len] = written;
+        }
+
+        fn entry_start_lt(
+            _: void,
+            lhs: Entry,
+            rhs: Entry,
+        ) bool
+        {
+            return lhs.output_bounds.start.lt(rhs.output_bounds.start);
+        }
+    };
+
+    /// index of the mapping whose input bounds contain input_ord, found by
+    /// binary search.  The end point of the last mapping is included so that
+    /// the end of the topology can be projected.
+    pub fn mapping_index_at_input(
+        self: @This(),
+        input_ord: opentime.Ordinate,
+    ) ?usize
+    {
+        // first mapping that starts after input_ord
+        var lo: usize = 0;
+        var hi: usize = self.mappings.len;
+        while (lo < hi)
+        {
+            const mid = lo + (hi - lo) / 2;
+            if (self.mappings[mid].input_bounds().start.lteq(input_ord)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == 0) {
+            return null;
+        }
+
+        const ind = lo - 1;
+        const bounds = self.mappings[ind].input_bounds();
+        if (
+            bounds.overlaps(input_ord)
+            or (ind == self.mappings.len - 1 and input_ord.eql(bounds.end))
+        )
+        {
+            return ind;
+        }
+
+        return null;
+    }
+
     /// Topology guarantees a monotonic, continuous input space.  When
     /// inverting, the output space must be split at critical points and put
-    /// into different Topologies for the caller to manage.
+    /// into different Topologies for the caller to manage (see
+    /// MultiTopology).  Each returned Topology has its mappings sorted in its
+    /// input space.  Empty mappings map nothing onto the output space, so
+    /// they have no inverse and are dropped.
     pub fn inverted(
         self: @This(),
         allocator: std.mem.Allocator,
@@ -885,19 +1254,39 @@ pub const Topology = struct {
         var result = (
             std.ArrayList(Topology).init(allocator)
         );
+        defer result.deinit();
+        errdefer {
+            for (result.items)
+                |topo|
+            {
+                topo.deinit(allocator);
+            }
+        }
 
         var current_mappings =(
             std.ArrayList(mapping.Mapping).init(allocator)
         );
         defer current_mappings.deinit();
+        errdefer {
+            for (current_mappings.items)
+                |m|
+            {
+                m.deinit(allocator);
+            }
+        }
 
         var maybe_input_range: ?opentime.ContinuousInterval = null;
 
         for (self.mappings)
             |m|
         {
+            if (m == .empty) {
+                continue;
+            }
+
             // mappings are 1:1, can always invert
             const m_inverted = try m.inverted(allocator);
+            const m_inverted_bounds = m_inverted.input_bounds();
 
             if (maybe_input_range)
                 |current_range|
@@ -905,45 +1294,254 @@ pub const Topology = struct {
                 if (
                     opentime.interval.intersect(
                         current_range,
-                        m_inverted.input_bounds(),
+                        m_inverted_bounds,
                     ) != null
-                    and current_mappings.items.len > 0
                 )
                 {
-                    try result.append(
-                        .{
-                            .mappings = (
-                                try current_mappings.toOwnedSlice()
-                            ),
-                        },
-                    );
+                    // folds back over the current piece, start a new one
+                    append_sorted_piece(
+                        allocator,
+                        &result,
+                        &current_mappings,
+                    ) catch |err| {
+                        m_inverted.deinit(allocator);
+                        return err;
+                    };
+                    maybe_input_range = m_inverted_bounds;
                 }
-                else 
+                else
                 {
                     // continue the current topology
                     maybe_input_range = opentime.interval.extend(
                         current_range,
-                        m_inverted.input_bounds(),
+                        m_inverted_bounds,
                     );
-                    try current_mappings.append(m_inverted);
                 }
             }
             else {
-                try current_mappings.append(m_inverted);
-                maybe_input_range = m_inverted.input_bounds();
+                maybe_input_range = m_inverted_bounds;
             }
+
+            current_mappings.append(m_inverted) catch |err| {
+                m_inverted.deinit(allocator);
+                return err;
+            };
         }
 
-        try result.append(
-            .{
-                .mappings = (
-                    try current_mappings.toOwnedSlice()
-                ),
-            },
+        if (current_mappings.items.len > 0 or result.items.len == 0)
+        {
+            try append_sorted_piece(
+                allocator,
+                &result,
+                &current_mappings,
+            );
+        }
+
+        return try result.toOwnedSlice();
+    }
+
+    /// move mappings into a new Topology sorted by input start and append it
+    /// to pieces
+    fn append_sorted_piece(
+        allocator: std.mem.Allocator,
+        pieces: *std.ArrayList(Topology),
+        mappings: *std.ArrayList(mapping.Mapping),
+    ) !void
+    {
+        std.mem.sort(
+            mapping.Mapping,
+            mappings.items,
+            {},
+            mapping_input_start_lt,
+        );
+
+        try pieces.ensureUnusedCapacity(1);
+        pieces.appendAssumeCapacity(
+            .{ .mappings = try mappings.toOwnedSlice() }
+        );
+    }
+
+    fn mapping_input_start_lt(
+        _: void,
+        lhs: mapping.Mapping,
+        rhs: mapping.Mapping,
+    ) bool
+    {
+        return lhs.input_bounds().start.lt(rhs.input_bounds().start);
+    }
+};
+
+/// A multi valued function made of monotonic Topologies whose input ranges
+/// may overlap, such as the inverse of a Topology that is not monotonic (it
+/// reverses, or holds on a frame).  An input ordinate projects to one output
+/// ordinate for every piece that contains it.
+pub const MultiTopology = struct {
+    /// sorted by the start of their input bounds
+    pieces: []const Topology,
+    /// largest input end of each subtree of pieces, see stabbing_index
+    subtree_max_input_end: []const opentime.Ordinate,
+
+    /// build from pieces, taking ownership of them and of the slice (which
+    /// must have been allocated with allocator)
+    pub fn init(
+        allocator: std.mem.Allocator,
+        pieces: []Topology,
+    ) !MultiTopology
+    {
+        std.mem.sort(Topology, pieces, {}, piece_input_start_lt);
+
+        const subtree_max_input_end = try allocator.alloc(
+            opentime.Ordinate,
+            pieces.len
+        );
+
+        for (pieces, subtree_max_input_end)
+            |piece, *end|
+        {
+            end.* = (
+                if (piece.mappings.len > 0) piece.input_bounds().end
+                else opentime.Ordinate.INF_NEG
+            );
+        }
+        stabbing_index.build(subtree_max_input_end);
+
+        return .{
+            .pieces = pieces,
+            .subtree_max_input_end = subtree_max_input_end,
+        };
+    }
+
+    /// the inverse of topo
+    pub fn init_inverted(
+        allocator: std.mem.Allocator,
+        topo: Topology,
+    ) !MultiTopology
+    {
+        const pieces = try topo.inverted(allocator);
+        errdefer opentime.deinit_slice(allocator, Topology, pieces);
+
+        return try MultiTopology.init(allocator, @constCast(pieces));
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        opentime.deinit_slice(allocator, Topology, self.pieces);
+        allocator.free(self.subtree_max_input_end);
+    }
+
+    /// true if every input ordinate projects to at most one output ordinate
+    pub fn is_single_valued(
+        self: @This(),
+    ) bool
+    {
+        return self.pieces.len <= 1;
+    }
+
+    /// project input_ord through every piece that contains it, appending
+    /// the results to result in piece order.  Costs O(log n + k log n) to
+    /// find the k pieces containing it and O(log m) per piece to find the
+    /// mapping.
+    pub fn project_instantaneous_cc_into(
+        self: @This(),
+        input_ord: opentime.Ordinate,
+        result: *std.ArrayList(opentime.Ordinate),
+    ) !void
+    {
+        // first piece that starts after input_ord
+        var lo: usize = 0;
+        var hi: usize = self.pieces.len;
+        while (lo < hi)
+        {
+            const mid = lo + (hi - lo) / 2;
+            const piece = self.pieces[mid];
+            if (
+                piece.mappings.len == 0
+                or piece.input_bounds().start.lteq(input_ord)
+            ) 
+            {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        var stab = stabbing_index.Stab.init(
+            self.subtree_max_input_end,
+            input_ord,
+            lo,
         );
+        while (stab.next())
+            |ind|
+        {
+            const piece = self.pieces[ind];
+            const mapping_ind = (
+                piece.mapping_index_at_input(input_ord) orelse continue
+            );
+
+            const projected = (
+                piece.mappings[mapping_ind].project_instantaneous_cc(input_ord)
+            );
+            switch (projected) {
+                .SuccessOrdinate => |ord| try result.append(ord),
+                else => {},
+            }
+        }
+    }
+
+    /// project input_ord through every piece that contains it.  The result
+    /// is owned by the caller.
+    pub fn project_instantaneous_cc(
+        self: @This(),
+        allocator: std.mem.Allocator,
+        input_ord: opentime.Ordinate,
+    ) ![]const opentime.Ordinate
+    {
+        var result = std.ArrayList(opentime.Ordinate).init(allocator);
+        errdefer result.deinit();
+
+        try self.project_instantaneous_cc_into(input_ord, &result);
 
         return try result.toOwnedSlice();
     }
+
+    /// union of the input bounds of the pieces
+    pub fn input_bounds(
+        self: @This(),
+    ) opentime.ContinuousInterval
+    {
+        var bounds: ?opentime.ContinuousInterval = null;
+        for (self.pieces)
+            |piece|
+        {
+            if (piece.mappings.len == 0) {
+                continue;
+            }
+            bounds = (
+                if (bounds) |b| opentime.interval.extend(b, piece.input_bounds())
+                else piece.input_bounds()
+            );
+        }
+        return bounds orelse .{};
+    }
+
+    fn piece_input_start_lt(
+        _: void,
+        lhs: Topology,
+        rhs: Topology,
+    ) bool
+    {
+        // pieces without mappings sort first and never match
+        if (rhs.mappings.len == 0) {
+            return false;
+        }
+        if (lhs.mappings.len == 0) {
+            return true;
+        }
+        return lhs.input_bounds().start.lt(rhs.input_bounds().start);
+    }
 };
 
 /// an empty topology
@@ -1107,15 +1705,669 @@ test "Topology trim_in_input_space"
     }
 }
 
-/// build a topological mapping from a to c
-pub fn join(
-    parent_allocator: std.mem.Allocator,
-    topologies: struct{
-        a2b: Topology, // split on output
-        b2c: Topology, // split in input
-    },
-) !Topology
+/// caller owned buffers for trim_and_split_for_join, which can be reused
+/// across joins.  The lists only borrow the mappings in a2b and b2c, which
+/// belong to the allocator passed to trim_and_split_for_join.
+pub const JoinScratch = struct {
+    /// a2b trimmed to the b range and split at the end points of b2c
+    a2b: std.ArrayList(mapping.Mapping),
+    /// b2c trimmed to the b range and split at the end points of a2b
+    b2c: std.ArrayList(mapping.Mapping),
+    /// sorted boundaries in the b space
+    b_points: std.ArrayList(opentime.Ordinate),
+    /// per mapping split points in the a space
+    a_points: std.ArrayList(opentime.Ordinate),
+
+    pub fn init(
+        allocator: std.mem.Allocator,
+    ) JoinScratch
+    {
+        return .{
+            .a2b = std.ArrayList(mapping.Mapping).init(allocator),
+            .b2c = std.ArrayList(mapping.Mapping).init(allocator),
+            .b_points = std.ArrayList(opentime.Ordinate).init(allocator),
+            .a_points = std.ArrayList(opentime.Ordinate).init(allocator),
+        };
+    }
+
+    /// empty the buffers, keeping their capacity
+    pub fn clear(
+        self: *@This(),
+    ) void
+    {
+        self.a2b.clearRetainingCapacity();
+        self.b2c.clearRetainingCapacity();
+        self.b_points.clearRetainingCapacity();
+        self.a_points.clearRetainingCapacity();
+    }
+
+    pub fn deinit(
+        self: *@This(),
+    ) void
+    {
+        self.clear();
+
+        self.a2b.deinit();
+        self.b2c.deinit();
+        self.b_points.deinit();
+        self.a_points.deinit();
+    }
+};
+
+/// prepare a pair of topologies for join in one pass: trims a2b in its output
+/// space and b2c in its input space to b_range, and splits each at the
+/// boundaries of the other, so that every mapping in scratch.a2b lines up with
+/// the mappings in scratch.b2c.  Produces the same mappings as
+/// trim_in_output_space, split_at_output_points, trim_in_input_space and
+/// split_at_input_points in sequence without building the intermediate
+/// topologies.
+///
+/// The mappings are built with allocator, which should be an arena: the curve
+/// splits leave intermediates behind.  The scratch lists only point at them.
+pub fn trim_and_split_for_join(
+    allocator: std.mem.Allocator,
+    topologies: struct{
+        a2b: Topology,
+        b2c: Topology,
+    },
+    b_range: opentime.ContinuousInterval,
+    scratch: *JoinScratch,
+) !void
+{
+    const a2b = topologies.a2b;
+    const b2c = topologies.b2c;
+
+    scratch.clear();
+
+    if (b2c.mappings.len == 0) {
+        return;
+    }
+
+    // boundaries of b2c in b, including those outside of b_range
+    try scratch.b_points.ensureTotalCapacity(b2c.mappings.len + 1);
+    scratch.b_points.appendAssumeCapacity(
+        b2c.mappings[0].input_bounds().start
+    );
+    for (b2c.mappings)
+        |m|
+    {
+        scratch.b_points.appendAssumeCapacity(m.input_bounds().end);
+    }
+
+    // a2b: trim in output space, then split at the b2c boundaries.  The
+    // cursor walks b_points alongside the mappings.
+    var b_cursor: usize = 0;
+    const ob = a2b.output_bounds();
+    const a2b_in_range = (
+        b_range.start.lteq(ob.start)
+        and b_range.end.gteq(ob.end)
+    );
+
+    for (a2b.mappings, 0..)
+        |m, m_ind|
+    {
+        if (a2b_in_range) {
+            try split_at_output_points_into(
+                allocator,
+                m,
+                scratch.b_points.items,
+                &b_cursor,
+                &scratch.a_points,
+                &scratch.a2b,
+            );
+            continue;
+        }
+
+        const m_in_range = m.input_bounds();
+        const m_out_range = m.output_bounds();
+
+        if (opentime.interval.intersect(b_range, m_out_range) == null)
+        {
+            try scratch.a2b.append(
+                (
+                 mapping.MappingEmpty{
+                     .defined_range = m_in_range,
+                 }
+                ).mapping(),
+            );
+            continue;
+        }
+
+        if (
+            m_out_range.start.gteq(b_range.start)
+            and m_out_range.end.lteq(b_range.end)
+        )
+        {
+            try split_at_output_points_into(
+                allocator,
+                m,
+                scratch.b_points.items,
+                &b_cursor,
+                &scratch.a_points,
+                &scratch.a2b,
+            );
+            continue;
+        }
+
+        const shrunk_m = try m.shrink_to_output_interval(
+            allocator,
+            b_range,
+        );
+        defer shrunk_m.deinit(allocator);
+
+        const shrunk_input_bounds = shrunk_m.input_bounds();
+
+        if (
+            shrunk_input_bounds.start.gt(m_in_range.start)
+            and m_ind > 0
+        )
+        {
+            // empty left
+            try scratch.a2b.append(
+                (
+                 mapping.MappingEmpty{
+                     .defined_range = .{
+                         .start = m_in_range.start,
+                         .end = shrunk_input_bounds.start,
+                     },
+                 }
+                ).mapping(),
+            );
+        }
+
+        if (shrunk_input_bounds.start.lt(shrunk_input_bounds.end))
+        {
+            try split_at_output_points_into(
+                allocator,
+                shrunk_m,
+                scratch.b_points.items,
+                &b_cursor,
+                &scratch.a_points,
+                &scratch.a2b,
+            );
+        }
+
+        if (
+            shrunk_input_bounds.end.lt(m_in_range.end)
+            and m_ind < a2b.mappings.len - 1
+        )
+        {
+            // empty right
+            try scratch.a2b.append(
+                (
+                 mapping.MappingEmpty{
+                     .defined_range = .{
+                         .start = shrunk_input_bounds.end,
+                         .end = m_in_range.end,
+                     },
+                 }
+                ).mapping(),
+            );
+        }
+    }
+
+    // unique, sorted boundaries of the split a2b in b
+    scratch.b_points.clearRetainingCapacity();
+    try scratch.b_points.ensureTotalCapacity(2 * scratch.a2b.items.len);
+    for (scratch.a2b.items)
+        |m|
+    {
+        const b = m.output_bounds();
+        scratch.b_points.appendAssumeCapacity(b.start);
+        scratch.b_points.appendAssumeCapacity(b.end);
+    }
+
+    std.mem.sort(
+        opentime.Ordinate,
+        scratch.b_points.items,
+        {},
+        opentime.sort.asc(opentime.Ordinate),
+    );
+
+    var n_unique: usize = 0;
+    for (scratch.b_points.items)
+        |pt|
+    {
+        if (n_unique > 0 and scratch.b_points.items[n_unique - 1].eql(pt)) {
+            continue;
+        }
+        scratch.b_points.items[n_unique] = pt;
+        n_unique += 1;
+    }
+    scratch.b_points.shrinkRetainingCapacity(n_unique);
+
+    // b2c: trim in input space, then split at the a2b boundaries
+    const ib = b2c.input_bounds();
+    var new_bounds = opentime.interval.intersect(
+        b_range,
+        ib,
+    ) orelse return;
+
+    if (
+        new_bounds.start.lteq(ib.start)
+        and new_bounds.end.gteq(ib.end)
+    )
+    {
+        for (b2c.mappings)
+            |m|
+        {
+            try split_at_input_points_into(
+                allocator,
+                m,
+                scratch.b_points.items,
+                &scratch.b2c,
+            );
+        }
+        return;
+    }
+
+    new_bounds.start = opentime.max(new_bounds.start, ib.start);
+    new_bounds.end = opentime.min(new_bounds.end, ib.end);
+
+    // find the mappings that need to be trimmed
+    var maybe_left_map_ind: ?usize = null;
+    var maybe_right_map_ind: ?usize = null;
+    for (b2c.mappings, 0..)
+        |m, m_ind|
+    {
+        const m_ib = m.input_bounds();
+
+        if (
+            m_ib.start.lt(new_bounds.start)
+            and m_ib.end.gt(new_bounds.start)
+        )
+        {
+            maybe_left_map_ind = m_ind;
+        }
+
+        if (
+            m_ib.start.lt(new_bounds.end)
+            and m_ib.end.gt(new_bounds.end)
+        )
+        {
+            maybe_right_map_ind = m_ind;
+        }
+    }
+
+    // trim the same mapping, toss the rest
+    if (
+        maybe_left_map_ind != null
+        and maybe_right_map_ind != null
+        and maybe_left_map_ind.? == maybe_right_map_ind.?
+    )
+    {
+        const left_halves = (
+            try b2c.mappings[maybe_left_map_ind.?].split_at_input_point(
+                allocator,
+                new_bounds.start,
+            )
+        );
+        defer left_halves[0].deinit(allocator);
+        defer left_halves[1].deinit(allocator);
+
+        const right_halves = try left_halves[1].split_at_input_point(
+            allocator,
+            new_bounds.end,
+        );
+        defer right_halves[0].deinit(allocator);
+        defer right_halves[1].deinit(allocator);
+
+        try split_at_input_points_into(
+            allocator,
+            right_halves[0],
+            scratch.b_points.items,
+            &scratch.b2c,
+        );
+        return;
+    }
+
+    var middle_start: usize = 0;
+    var middle_end: usize = b2c.mappings.len;
+
+    if (maybe_left_map_ind)
+        |left_ind|
+    {
+        const halves = try b2c.mappings[left_ind].split_at_input_point(
+            allocator,
+            new_bounds.start,
+        );
+        defer halves[0].deinit(allocator);
+        defer halves[1].deinit(allocator);
+
+        try split_at_input_points_into(
+            allocator,
+            halves[1],
+            scratch.b_points.items,
+            &scratch.b2c,
+        );
+
+        middle_start = left_ind + 1;
+    }
+
+    if (maybe_right_map_ind)
+        |right_ind|
+    {
+        middle_end = right_ind;
+    }
+
+    for (b2c.mappings[middle_start..middle_end])
+        |m|
+    {
+        try split_at_input_points_into(
+            allocator,
+            m,
+            scratch.b_points.items,
+            &scratch.b2c,
+        );
+    }
+
+    if (maybe_right_map_ind)
+        |right_ind|
+    {
+        const halves = try b2c.mappings[right_ind].split_at_input_point(
+            allocator,
+            new_bounds.end,
+        );
+        defer halves[0].deinit(allocator);
+        defer halves[1].deinit(allocator);
+
+        try split_at_input_points_into(
+            allocator,
+            halves[0],
+            scratch.b_points.items,
+            &scratch.b2c,
+        );
+    }
+}
+
+/// index of the first of the sorted points that is greater than ord.  Walks
+/// forward from cursor, which is where the previous search ended, so a
+/// sequence of increasing ords costs one pass over points; a search that
+/// goes backwards falls back to a binary search.
+fn first_point_after(
+    points: []const opentime.Ordinate,
+    ord: opentime.Ordinate,
+    cursor: usize,
+) usize
+{
+    var ind = @min(cursor, points.len);
+
+    if (ind > 0 and points[ind - 1].gt(ord))
+    {
+        var lo: usize = 0;
+        var hi: usize = ind;
+        while (lo < hi)
+        {
+            const mid = lo + (hi - lo) / 2;
+            if (points[mid].lteq(ord)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    while (ind < points.len and points[ind].lteq(ord)) {
+        ind += 1;
+    }
+    return ind;
+}
+
+/// append copies of m split at the sorted output_points that fall strictly
+/// inside of it to result.  cursor is the position in output_points reached
+/// by the previous mapping and is moved past m.  input_points is scratch
+/// space.
+fn split_at_output_points_into(
+    allocator: std.mem.Allocator,
+    m: mapping.Mapping,
+    output_points: []const opentime.Ordinate,
+    cursor: *usize,
+    input_points: *std.ArrayList(opentime.Ordinate),
+    result: *std.ArrayList(mapping.Mapping),
+) !void
+{
+    if (m == .empty) {
+        try result.append(try m.clone(allocator));
+        return;
+    }
+
+    const m_bounds_in = m.input_bounds();
+    const m_bounds_out = m.output_bounds();
+
+    input_points.clearRetainingCapacity();
+    var pt_ind = first_point_after(
+        output_points,
+        m_bounds_out.start,
+        cursor.*,
+    );
+    while (
+        pt_ind < output_points.len
+        and output_points[pt_ind].lt(m_bounds_out.end)
+    ) : (pt_ind += 1)
+    {
+        const in_pt = (
+            try m.project_instantaneous_cc_inv(
+                output_points[pt_ind]
+            ).ordinate()
+        );
+
+        if (
+            in_pt.gt(m_bounds_in.start)
+            and in_pt.lt(m_bounds_in.end)
+        )
+        {
+            try input_points.append(in_pt);
+        }
+    }
+    cursor.* = pt_ind;
+
+    if (input_points.items.len == 0) {
+        try result.append(try m.clone(allocator));
+        return;
+    }
+
+    std.mem.sort(
+        opentime.Ordinate,
+        input_points.items,
+        {},
+        opentime.sort.asc(opentime.Ordinate),
+    );
+
+    // reserve up front so that nothing can fail between a split and the
+    // append that takes ownership of its halves
+    try result.ensureUnusedCapacity(input_points.items.len + 1);
+
+    var rest = try m.clone(allocator);
+    errdefer rest.deinit(allocator);
+
+    for (input_points.items)
+        |pt|
+    {
+        const halves = try rest.split_at_input_point(allocator, pt);
+        rest.deinit(allocator);
+
+        result.appendAssumeCapacity(halves[0]);
+        rest = halves[1];
+    }
+
+    result.appendAssumeCapacity(rest);
+}
+
+/// append m split at input_points to result
+fn split_at_input_points_into(
+    allocator: std.mem.Allocator,
+    m: mapping.Mapping,
+    input_points: []const opentime.Ordinate,
+    result: *std.ArrayList(mapping.Mapping),
+) !void
+{
+    if (m == .empty) {
+        try result.append(try m.clone(allocator));
+        return;
+    }
+
+    const pieces = try m.split_at_input_points(allocator, input_points);
+    defer allocator.free(pieces);
+
+    try result.appendSlice(pieces);
+}
+
+/// build a topological mapping from a to c.  Callers joining in a loop can
+/// pass a scratch that is reused across joins instead of rebuilt each time.
+pub fn join(
+    parent_allocator: std.mem.Allocator,
+    topologies: struct{
+        a2b: Topology, // split on output
+        b2c: Topology, // split in input
+        scratch: ?*JoinScratch = null,
+    },
+) !Topology
+{
+    if (
+        join_fast_path(
+            .{
+                .a2b = topologies.a2b,
+                .b2c = topologies.b2c,
+            },
+        )
+    )
+        |fast|
+    {
+        return switch (fast) {
+            .empty => EMPTY,
+            .affine => |aff| try Topology.init_affine(parent_allocator, aff),
+            .passthrough => |topo| try topo.clone(parent_allocator),
+        };
+    }
+
+    return try join_general(
+        parent_allocator,
+        .{
+            .a2b = topologies.a2b,
+            .b2c = topologies.b2c,
+            .scratch = topologies.scratch,
+        },
+    );
+}
+
+/// result of join_fast_path
+pub const FastJoin = union (enum) {
+    /// the topologies do not overlap in b
+    empty: void,
+    /// the join is a single affine mapping
+    affine: mapping.MappingAffine,
+    /// one side is an infinite identity, the join is the other side
+    passthrough: Topology,
+};
+
+/// compose a2b and b2c analytically without allocating when neither involves
+/// a curve: when either is an infinite identity or both are a single bounded
+/// affine mapping.  Returns null when the general join is needed.
+pub fn join_fast_path(
+    topologies: struct{
+        a2b: Topology,
+        b2c: Topology,
+    },
+) ?FastJoin
+{
+    const a2b = topologies.a2b;
+    const b2c = topologies.b2c;
+
+    if (is_infinite_identity(a2b) and b2c.mappings.len > 0) {
+        return .{ .passthrough = b2c };
+    }
+
+    const a2b_aff = single_affine(a2b) orelse return null;
+
+    // negative scales flip the output bounds of the mapping and instants are
+    // flattened into a linear mapping, leave both to the general join
+    if (
+        a2b_aff.input_to_output_xform.scale.lteq(0)
+        or a2b_aff.input_bounds_val.is_instant()
+    )
+    {
+        return null;
+    }
+
+    if (is_infinite_identity(b2c)) {
+        return .{ .passthrough = a2b };
+    }
+
+    const b2c_aff = single_affine(b2c) orelse return null;
+
+    const b_range = opentime.interval.intersect(
+        a2b_aff.output_bounds(),
+        b2c_aff.input_bounds(),
+    ) orelse return .empty;
+
+    const a_range = opentime.interval.intersect(
+        a2b_aff.input_bounds_val,
+        a2b_aff.input_to_output_xform.inverted().applied_to_bounds(b_range),
+    ) orelse return .empty;
+
+    return .{
+        .affine = mapping.join_aff_aff(
+            .{
+                .a2b = .{
+                    .input_bounds_val = a_range,
+                    .input_to_output_xform = a2b_aff.input_to_output_xform,
+                },
+                .b2c = b2c_aff,
+            },
+        ),
+    };
+}
+
+/// the only mapping of topo if it is affine
+fn single_affine(
+    topo: Topology,
+) ?mapping.MappingAffine
+{
+    if (topo.mappings.len != 1) {
+        return null;
+    }
+
+    return switch (topo.mappings[0]) {
+        .affine => |aff| aff,
+        else => null,
+    };
+}
+
+/// whether topo is a single identity mapping over the whole line
+fn is_infinite_identity(
+    topo: Topology,
+) bool
 {
+    const aff = single_affine(topo) orelse return false;
+    const xform = aff.input_to_output_xform;
+
+    return (
+        xform.scale.eql(opentime.Ordinate.ONE)
+        and xform.offset.eql(opentime.Ordinate.ZERO)
+        and aff.input_bounds_val.start.eql(opentime.Ordinate.INF_NEG)
+        and aff.input_bounds_val.end.eql(opentime.Ordinate.INF)
+    );
+}
+
+/// build a topological mapping from a to c with trims and splits, handles any
+/// pair of topologies.  Prefer join, which skips this for affine topologies.
+/// Uses scratch for the trimmed and split mappings if there is one.
+pub fn join_general(
+    parent_allocator: std.mem.Allocator,
+    topologies: struct{
+        a2b: Topology, // split on output
+        b2c: Topology, // split in input
+        scratch: ?*JoinScratch = null,
+    },
+) !Topology
+{
+    const span = tracing.begin_sized(
+        "topology.join",
+        topologies.a2b.mappings.len + topologies.b2c.mappings.len,
+    );
+    defer span.end();
+
     var arena = std.heap.ArenaAllocator.init(parent_allocator);
     defer arena.deinit();
 
@@ -1160,42 +2412,21 @@ pub fn join(
     ) orelse {
         return EMPTY;
     };
-    const a2b_trimmed_in_b = try a2b.trim_in_output_space(
-        allocator,
-        b_range,
-    );
-    const b2c_trimmed_in_b = try b2c.trim_in_input_space(
-        allocator,
-        b_range,
-    );
-
-    const b2c_split_pts_b = try b2c.end_points_input(allocator);
-    defer allocator.free(b2c_split_pts_b);
 
-    // split in common points in b
-    const a2b_split: Topology = (
-        try a2b_trimmed_in_b.split_at_output_points(
-            allocator,
-            b2c_split_pts_b,
-        )
-    );
-    const a2b_split_endpoints_b = try a2b_split.end_points_output(
-        allocator
-    );
-    
-    std.mem.sort(
-        opentime.Ordinate,
-        a2b_split_endpoints_b,
-        {},
-        opentime.sort.asc(opentime.Ordinate),
-    );
-    defer allocator.free(a2b_split_endpoints_b);
+    // the split mappings always live in the arena, a caller's scratch only
+    // lends its lists
+    var local_scratch: JoinScratch = undefined;
+    const scratch = topologies.scratch orelse blk: {
+        local_scratch = JoinScratch.init(allocator);
+        break :blk &local_scratch;
+    };
+    defer if (topologies.scratch != null) scratch.clear();
 
-    const b2c_split = (
-        try b2c_trimmed_in_b.split_at_input_points(
-            allocator,
-            a2b_split_endpoints_b,
-        )
+    try trim_and_split_for_join(
+        allocator,
+        .{ .a2b = a2b, .b2c = b2c },
+        b_range,
+        scratch,
     );
 
     var a2c_mappings = (
@@ -1204,13 +2435,11 @@ pub fn join(
 
     // at this point the start and end points are the same and there are the
     // same number of endpoints
-    for (
-        a2b_split.mappings,
-    )
+    for (scratch.a2b.items)
         |a2b_m|
     {
         const a2b_m_ob = a2b_m.output_bounds();
-        for (b2c_split.mappings)
+        for (scratch.b2c.items)
             |b2c_m|
         {
             const b2c_m_ib = b2c_m.input_bounds();
@@ -1672,6 +2901,84 @@ test "Topology: trim_in_output_space (slides)"
     );
 }
 
+test "Topology: trim_and_split_for_join matches the staged trims and splits"
+{
+    // the split functions of the underlying curves leak intermediates, as
+    // join does, run them in an arena
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const slides_test_data = (
+        try build_test_topo_from_slides(allocator)
+    );
+    const a2b = slides_test_data.a2b;
+    const b2c = slides_test_data.b2c;
+
+    const b_range = opentime.interval.intersect(
+        a2b.output_bounds(),
+        b2c.input_bounds(),
+    ) orelse return error.OutOfBounds;
+
+    // staged
+    const a2b_split = try (
+        try a2b.trim_in_output_space(allocator, b_range)
+    ).split_at_output_points(
+        allocator,
+        try b2c.end_points_input(allocator),
+    );
+    const b2c_split = try (
+        try b2c.trim_in_input_space(allocator, b_range)
+    ).split_at_input_points(
+        allocator,
+        try a2b_split.end_points_output(allocator),
+    );
+
+    // fused
+    var scratch = JoinScratch.init(allocator);
+    defer scratch.deinit();
+    try trim_and_split_for_join(
+        allocator,
+        .{ .a2b = a2b, .b2c = b2c },
+        b_range,
+        &scratch,
+    );
+
+    for (
+        &[_][]const mapping.Mapping{ a2b_split.mappings, b2c_split.mappings },
+        &[_][]const mapping.Mapping{ scratch.a2b.items, scratch.b2c.items },
+    )
+        |expected, measured|
+    {
+        try std.testing.expectEqual(expected.len, measured.len);
+
+        for (expected, measured)
+            |exp_m, meas_m|
+        {
+            try std.testing.expectEqual(
+                std.meta.activeTag(exp_m),
+                std.meta.activeTag(meas_m),
+            );
+            try opentime.expectOrdinateEqual(
+                exp_m.input_bounds().start,
+                meas_m.input_bounds().start,
+            );
+            try opentime.expectOrdinateEqual(
+                exp_m.input_bounds().end,
+                meas_m.input_bounds().end,
+            );
+            try opentime.expectOrdinateEqual(
+                exp_m.output_bounds().start,
+                meas_m.output_bounds().start,
+            );
+            try opentime.expectOrdinateEqual(
+                exp_m.output_bounds().end,
+                meas_m.output_bounds().end,
+            );
+        }
+    }
+}
+
 test "Topology: trim_in_output_space (trim to multiple split bug)"
 {
     const allocator = std.testing.allocator;
@@ -1903,6 +3210,74 @@ test "Topology: project_instantaneous_cc and project_instantaneous_cc_inv"
     }
 }
 
+test "Topology.OutputIndex: project_instantaneous_cc_inv"
+{
+    const allocator = std.testing.allocator;
+
+    const topo = MIDDLE.LIN_V_TOPO;
+
+    const index = try topo.build_output_index(allocator);
+    defer index.deinit(allocator);
+
+    const test_ords = [_]opentime.Ordinate{
+        opentime.Ordinate.init(0),
+        opentime.Ordinate.init(16),
+        opentime.Ordinate.init(32),
+        opentime.Ordinate.init(-1),
+    };
+
+    // agrees with the linear scan
+    var buf: [4]opentime.Ordinate = undefined;
+    for (test_ords)
+        |ord|
+    {
+        const expected = try topo.project_instantaneous_cc_inv(
+            allocator,
+            ord,
+        );
+        defer allocator.free(expected);
+
+        const count = index.project_instantaneous_cc_inv_into(ord, &buf);
+
+        try std.testing.expectEqualSlices(
+            opentime.Ordinate,
+            expected,
+            buf[0..count],
+        );
+    }
+
+    // batch
+    var result: [8]opentime.Ordinate = undefined;
+    var offsets: [test_ords.len + 1]usize = undefined;
+    try index.project_instantaneous_cc_inv_batch(
+        &test_ords,
+        &result,
+        &offsets,
+    );
+
+    try std.testing.expectEqualSlices(
+        usize,
+        &.{ 0, 2, 4, 6, 6 },
+        &offsets,
+    );
+    try std.testing.expectEqualSlices(
+        opentime.Ordinate,
+        &.{ opentime.Ordinate.init(4), opentime.Ordinate.init(6) },
+        result[offsets[2]..offsets[3]],
+    );
+
+    // too short a result buffer
+    var short: [3]opentime.Ordinate = undefined;
+    try std.testing.expectError(
+        error.NoSpaceLeft,
+        index.project_instantaneous_cc_inv_batch(
+            &test_ords,
+            &short,
+            &offsets,
+        ),
+    );
+}
+
 test "Topology: init_affine"
 {
     const allocator = std.testing.allocator;
@@ -1931,6 +3306,44 @@ test "Topology: init_affine"
     );
 }
 
+test "Topology: stats"
+{
+    const allocator = std.testing.allocator;
+
+    const t_aff = try Topology.init_identity(
+        allocator,
+        opentime.ContinuousInterval.init(.{ .start = 0, .end = 10 }),
+    );
+    defer t_aff.deinit(allocator);
+
+    const aff_stats = t_aff.stats();
+    try std.testing.expectEqual(1, aff_stats.mappings);
+    try std.testing.expectEqual(1, aff_stats.affine_mappings);
+    try std.testing.expectEqual(2, aff_stats.knots);
+
+    const t_lin = try Topology.init_from_linear_monotonic(
+        allocator,
+        .{
+            .knots = &.{
+                curve.ControlPoint.init(.{ .in = 0, .out = 0 }),
+                curve.ControlPoint.init(.{ .in = 2, .out = 4 }),
+                curve.ControlPoint.init(.{ .in = 4, .out = 5 }),
+            },
+        },
+    );
+    defer t_lin.deinit(allocator);
+
+    var total = t_lin.stats();
+    try std.testing.expectEqual(1, total.linear_mappings);
+    try std.testing.expectEqual(3, total.knots);
+    try std.testing.expectEqual(3, total.max_knots_per_mapping);
+
+    total.accumulate(aff_stats);
+    try std.testing.expectEqual(2, total.mappings);
+    try std.testing.expectEqual(5, total.knots);
+    try std.testing.expectEqual(3, total.max_knots_per_mapping);
+}
+
 test "Topology: join affine with affine"
 {
     const allocator = std.testing.allocator;
@@ -1974,3 +3387,388 @@ test "Topology: join affine with affine"
         try result.project_instantaneous_cc(opentime.Ordinate.init(3)).ordinate(),
     );
 }
+
+test "Topology: join_fast_path matches join_general"
+{
+    const allocator = std.testing.allocator;
+
+    const ident = try Topology.init_identity_infinite(allocator);
+    defer ident.deinit(allocator);
+
+    const a2b = try Topology.init_affine(
+        allocator,
+        .{
+            .input_bounds_val = opentime.ContinuousInterval.init(
+                .{ .start = 0, .end = 10 },
+            ),
+            .input_to_output_xform = .{
+                .offset = opentime.Ordinate.init(2),
+                .scale = opentime.Ordinate.init(2),
+            },
+        },
+    );
+    defer a2b.deinit(allocator);
+
+    const b2c = try Topology.init_affine(
+        allocator,
+        .{
+            .input_bounds_val = opentime.ContinuousInterval.init(
+                .{ .start = 5, .end = 15 },
+            ),
+            .input_to_output_xform = .{
+                .offset = opentime.Ordinate.init(-1),
+                .scale = opentime.Ordinate.init(0.5),
+            },
+        },
+    );
+    defer b2c.deinit(allocator);
+
+    const disjoint = try Topology.init_affine(
+        allocator,
+        .{
+            .input_bounds_val = opentime.ContinuousInterval.init(
+                .{ .start = 100, .end = 200 },
+            ),
+        },
+    );
+    defer disjoint.deinit(allocator);
+
+    try std.testing.expectEqual(
+        .passthrough,
+        std.meta.activeTag(
+            join_fast_path(.{ .a2b = ident, .b2c = b2c }).?
+        ),
+    );
+    try std.testing.expectEqual(
+        .passthrough,
+        std.meta.activeTag(
+            join_fast_path(.{ .a2b = a2b, .b2c = ident }).?
+        ),
+    );
+    try std.testing.expectEqual(
+        .empty,
+        std.meta.activeTag(
+            join_fast_path(.{ .a2b = a2b, .b2c = disjoint }).?
+        ),
+    );
+    try std.testing.expectEqual(
+        null,
+        join_fast_path(.{ .a2b = a2b, .b2c = MIDDLE.LIN_TOPO }),
+    );
+
+    const fast = try join(allocator, .{ .a2b = a2b, .b2c = b2c });
+    defer fast.deinit(allocator);
+
+    const general = try join_general(allocator, .{ .a2b = a2b, .b2c = b2c });
+    defer general.deinit(allocator);
+
+    try std.testing.expectEqual(1, fast.mappings.len);
+    try std.testing.expectEqual(general.mappings.len, fast.mappings.len);
+
+    const fast_ib = fast.input_bounds();
+    const general_ib = general.input_bounds();
+    try opentime.expectOrdinateEqual(general_ib.start, fast_ib.start);
+    try opentime.expectOrdinateEqual(general_ib.end, fast_ib.end);
+
+    for ([_]f64{ 1.5, 2, 3.5, 5, 6 })
+        |pt|
+    {
+        const ord = opentime.Ordinate.init(pt);
+        try opentime.expectOrdinateEqual(
+            try general.project_instantaneous_cc(ord).ordinate(),
+            try fast.project_instantaneous_cc(ord).ordinate(),
+        );
+    }
+
+    // a scratch reused across joins gives the same results
+    var scratch = JoinScratch.init(allocator);
+    defer scratch.deinit();
+
+    for (0..2)
+        |_|
+    {
+        const with_scratch = try join_general(
+            allocator,
+            .{ .a2b = a2b, .b2c = MIDDLE.LIN_TOPO, .scratch = &scratch },
+        );
+        defer with_scratch.deinit(allocator);
+
+        const without = try join_general(
+            allocator,
+            .{ .a2b = a2b, .b2c = MIDDLE.LIN_TOPO },
+        );
+        defer without.deinit(allocator);
+
+        try std.testing.expectEqual(
+            without.mappings.len,
+            with_scratch.mappings.len,
+        );
+        try std.testing.expectEqual(0, scratch.a2b.items.len);
+    }
+}
+
+test "Topology: join through linear mappings with a reused scratch"
+{
+    // the scratch uses the leak checking allocator directly, so any split
+    // that escapes join_general's arena fails the test
+    const allocator = std.testing.allocator;
+
+    const a2b = try Topology.init_from_linear_monotonic(
+        allocator,
+        .{
+            .knots = &.{
+                curve.ControlPoint.init(.{ .in = 0, .out = 0 }),
+                curve.ControlPoint.init(.{ .in = 5, .out = 10 }),
+                curve.ControlPoint.init(.{ .in = 10, .out = 20 }),
+            },
+        },
+    );
+    defer a2b.deinit(allocator);
+
+    const b2c = try Topology.init_from_linear_monotonic(
+        allocator,
+        .{
+            .knots = &.{
+                curve.ControlPoint.init(.{ .in = 2, .out = 0 }),
+                curve.ControlPoint.init(.{ .in = 8, .out = 6 }),
+                curve.ControlPoint.init(.{ .in = 15, .out = 20 }),
+            },
+        },
+    );
+    defer b2c.deinit(allocator);
+
+    const without = try join(allocator, .{ .a2b = a2b, .b2c = b2c });
+    defer without.deinit(allocator);
+
+    var scratch = JoinScratch.init(allocator);
+    defer scratch.deinit();
+
+    for (0..3)
+        |_|
+    {
+        const with_scratch = try join(
+            allocator,
+            .{ .a2b = a2b, .b2c = b2c, .scratch = &scratch },
+        );
+        defer with_scratch.deinit(allocator);
+
+        try std.testing.expectEqual(
+            without.mappings.len,
+            with_scratch.mappings.len,
+        );
+
+        for ([_]f64{ 1.5, 3, 4.5, 6, 7 })
+            |pt|
+        {
+            const ord = opentime.Ordinate.init(pt);
+            try opentime.expectOrdinateEqual(
+                try without.project_instantaneous_cc(ord).ordinate(),
+                try with_scratch.project_instantaneous_cc(ord).ordinate(),
+            );
+        }
+    }
+}
+
+test "MultiTopology: inverse of a topology that folds back"
+{
+    const allocator = std.testing.allocator;
+
+    // /\ shaped: rises from 0 to 10, then falls back to 0
+    const rising = (
+        mapping.MappingCurveLinearMonotonic{
+            .input_to_output_curve = curve.Linear.Monotonic {
+                .knots = @constCast(
+                    &[_]curve.ControlPoint{
+                        curve.ControlPoint.init(.{ .in = 0, .out = 0, }),
+                        curve.ControlPoint.init(.{ .in = 10, .out = 10, }),
+                    }
+                ),
+            },
+        }
+    ).mapping();
+    const falling = (
+        mapping.MappingCurveLinearMonotonic{
+            .input_to_output_curve = curve.Linear.Monotonic {
+                .knots = @constCast(
+                    &[_]curve.ControlPoint{
+                        curve.ControlPoint.init(.{ .in = 10, .out = 10, }),
+                        curve.ControlPoint.init(.{ .in = 20, .out = 0, }),
+                    }
+                ),
+            },
+        }
+    ).mapping();
+
+    const rf_topo = Topology{
+        .mappings = &.{ rising, falling },
+    };
+
+    const inv = try MultiTopology.init_inverted(allocator, rf_topo);
+    defer inv.deinit(allocator);
+
+    try std.testing.expectEqual(2, inv.pieces.len);
+    try std.testing.expect(inv.is_single_valued() == false);
+
+    try opentime.expectOrdinateEqual(0, inv.input_bounds().start);
+    try opentime.expectOrdinateEqual(10, inv.input_bounds().end);
+
+    const TestCase = struct {
+        input: opentime.Ordinate.BaseType,
+        expected: []const opentime.Ordinate.BaseType,
+    };
+    const tests = [_]TestCase{
+        .{ .input = 0, .expected = &.{ 0, 20 } },
+        .{ .input = 5, .expected = &.{ 5, 15 } },
+        .{ .input = -1, .expected = &.{} },
+        .{ .input = 11, .expected = &.{} },
+    };
+
+    for (tests)
+        |t|
+    {
+        const result = try inv.project_instantaneous_cc(
+            allocator,
+            opentime.Ordinate.init(t.input),
+        );
+        defer allocator.free(result);
+
+        errdefer opentime.dbg_print(@src(),
+            "input: {d} expected: {any} got: {any}\n",
+            .{ t.input, t.expected, result },
+        );
+
+        try std.testing.expectEqual(t.expected.len, result.len);
+
+        const sorted = try allocator.dupe(opentime.Ordinate, result);
+        defer allocator.free(sorted);
+        std.mem.sort(
+            opentime.Ordinate,
+            sorted,
+            {},
+            struct {
+                fn lt(
+                    _: void,
+                    lhs: opentime.Ordinate,
+                    rhs: opentime.Ordinate,
+                ) bool
+                {
+                    return lhs.lt(rhs);
+                }
+            }.lt,
+        );
+
+        for (t.expected, sorted)
+            |expected, measured|
+        {
+            try opentime.expectOrdinateEqual(expected, measured);
+        }
+    }
+}
+
+test "Topology: mapping_index_at_input"
+{
+    const topo = Topology{
+        .mappings = &.{
+            (
+             mapping.MappingAffine{
+                 .input_bounds_val = opentime.ContinuousInterval.init(
+                     .{ .start = 0, .end = 10 }
+                 ),
+             }
+            ).mapping(),
+            (
+             mapping.MappingAffine{
+                 .input_bounds_val = opentime.ContinuousInterval.init(
+                     .{ .start = 10, .end = 15 }
+                 ),
+             }
+            ).mapping(),
+        },
+    };
+
+    try std.testing.expectEqual(null, topo.mapping_index_at_input(
+            opentime.Ordinate.init(-1)
+    ));
+    try std.testing.expectEqual(0, topo.mapping_index_at_input(
+            opentime.Ordinate.init(0)
+    ));
+    try std.testing.expectEqual(1, topo.mapping_index_at_input(
+            opentime.Ordinate.init(10)
+    ));
+    try std.testing.expectEqual(1, topo.mapping_index_at_input(
+            opentime.Ordinate.init(15)
+    ));
+    try std.testing.expectEqual(null, topo.mapping_index_at_input(
+            opentime.Ordinate.init(16)
+    ));
+}
+
+test "Topology: project_instantaneous_cc_dual chains through joins"
+{
+    const allocator = std.testing.allocator;
+
+    // slow down by half, then through a curve with slopes 1 and 3
+    const a2b = try Topology.init_affine(
+        allocator,
+        .{
+            .input_bounds_val = opentime.ContinuousInterval.init(
+                .{ .start = 0, .end = 8 },
+            ),
+            .input_to_output_xform = .{
+                .scale = opentime.Ordinate.init(0.5),
+            },
+        },
+    );
+    defer a2b.deinit(allocator);
+
+    const b2c = try Topology.init_from_linear_monotonic(
+        allocator,
+        .{
+            .knots = &.{
+                curve.ControlPoint.init(.{ .in = 0, .out = 0 }),
+                curve.ControlPoint.init(.{ .in = 2, .out = 2 }),
+                curve.ControlPoint.init(.{ .in = 4, .out = 8 }),
+            },
+        },
+    );
+    defer b2c.deinit(allocator);
+
+    const a2c = try join(allocator, .{ .a2b = a2b, .b2c = b2c });
+    defer a2c.deinit(allocator);
+
+    const ords = [_]opentime.Ordinate{
+        opentime.Ordinate.init(1),
+        opentime.Ordinate.init(6),
+        opentime.Ordinate.init(3),
+        opentime.Ordinate.init(12),
+    };
+    const expected_rates = [_]?opentime.Ordinate.BaseType{ 0.5, 1.5, 0.5, null };
+
+    var batch: [ords.len]?opentime.Dual_Ord = undefined;
+    a2c.project_instantaneous_cc_rate_batch(&ords, &batch);
+
+    for (ords, expected_rates, batch)
+        |ord, maybe_rate, batched|
+    {
+        const rate = maybe_rate orelse {
+            try std.testing.expectEqual(null, batched);
+            continue;
+        };
+
+        const input = opentime.Dual_Ord.init_ri(ord, opentime.Ordinate.ONE);
+        const joined = a2c.project_instantaneous_cc_dual(input).?;
+        const chained = b2c.project_instantaneous_cc_dual(
+            a2b.project_instantaneous_cc_dual(input).?
+        ).?;
+
+        try opentime.expectOrdinateEqual(
+            try a2c.project_instantaneous_cc(ord).ordinate(),
+            joined.r,
+        );
+        try opentime.expectOrdinateEqual(rate, joined.i);
+        try opentime.expectOrdinateEqual(joined.r, chained.r);
+        try opentime.expectOrdinateEqual(rate, chained.i);
+        try opentime.expectOrdinateEqual(joined.r, batched.?.r);
+        try opentime.expectOrdinateEqual(rate, batched.?.i);
+    }
+}
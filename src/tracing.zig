@@ -0,0 +1,394 @@
+//! Lightweight span tracer with Chrome/Perfetto trace export.
+//!
+//! Usage:
+//!     const span = tracing.begin("topology.join");
+//!     defer span.end();
+//!
+//! Spans are only recorded when the library is built with
+//! `-Denable_tracing=true` AND `tracing.start(allocator)` has been called.
+//! When tracing is compiled out, `Span` is zero sized and every function here
+//! is a no-op, so instrumented code pays nothing.
+//!
+//! Each thread appends finished spans to its own buffer, so recording never
+//! takes a lock after the first span on a thread.  `write_chrome_trace`
+//! writes every buffer as Trace Event Format JSON, which can be loaded into
+//! chrome://tracing or https://ui.perfetto.dev.  Export and `stop` must not
+//! race with threads that are still recording.
+
+const std = @import("std");
+
+const build_options = @import("build_options");
+
+/// true when spans are compiled in
+pub const ENABLED = build_options.enable_tracing;
+
+/// a finished span
+const Event = struct {
+    /// comptime string, never freed
+    name: []const u8,
+    /// nanoseconds since start()
+    start_ns: u64,
+    duration_ns: u64,
+    /// optional problem size (knots, samples, clips...)
+    size: ?usize,
+};
+
+/// spans recorded by a single thread
+const ThreadBuffer = struct {
+    tid: std.Thread.Id,
+    events: std.ArrayListUnmanaged(Event) = .{},
+    next: ?*ThreadBuffer = null,
+};
+
+/// global tracer state, guarded by mutex except where noted
+const State = struct {
+    mutex: std.Thread.Mutex = .{},
+    allocator: std.mem.Allocator = undefined,
+    epoch: std.time.Instant = undefined,
+    buffers: ?*ThreadBuffer = null,
+    /// bumped by every start()/stop() to invalidate thread local buffers
+    generation: u32 = 0,
+    /// read without the lock
+    active: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    /// spans lost to allocation failures
+    dropped: std.atomic.Value(usize) = std.atomic.Value(usize).init(0),
+};
+
+var state: State = .{};
+
+threadlocal var local_buffer: ?*ThreadBuffer = null;
+threadlocal var local_generation: u32 = 0;
+
+/// A span in flight.  Call end() exactly once.
+pub const Span = if (ENABLED) struct {
+    name: []const u8,
+    start: ?std.time.Instant,
+    size: ?usize,
+
+    /// finish the span and record it in the buffer of the calling thread
+    pub fn end(
+        self: @This(),
+    ) void
+    {
+        const start_instant = self.start orelse return;
+        const now = std.time.Instant.now() catch return;
+
+        record(
+            .{
+                .name = self.name,
+                .start_ns = start_instant.since(state.epoch),
+                .duration_ns = now.since(start_instant),
+                .size = self.size,
+            }
+        );
+    }
+} else struct {
+    pub inline fn end(
+        _: @This(),
+    ) void
+    {}
+};
+
+/// begin a span named `name`
+pub inline fn begin(
+    comptime name: []const u8,
+) Span
+{
+    return begin_sized(name, null);
+}
+
+/// begin a span named `name`, annotated with a problem size that is written
+/// into the "args" of the trace event
+pub inline fn begin_sized(
+    comptime name: []const u8,
+    size: ?usize,
+) Span
+{
+    if (ENABLED)
+    {
+        const maybe_start = (
+            if (state.active.load(.monotonic)) (
+                std.time.Instant.now() catch null
+            )
+            else null
+        );
+
+        return .{
+            .name = name,
+            .start = maybe_start,
+            .size = size,
+        };
+    }
+    else
+    {
+        _ = size;
+        return .{};
+    }
+}
+
+/// start recording spans.  allocator is used for the per-thread buffers and
+/// must be thread safe if spans are recorded from more than one thread.
+/// Discards anything recorded by a previous start().
+pub fn start(
+    allocator: std.mem.Allocator,
+) !void
+{
+    if (!ENABLED) {
+        return;
+    }
+
+    stop();
+
+    state.mutex.lock();
+    defer state.mutex.unlock();
+
+    state.allocator = allocator;
+    state.epoch = try std.time.Instant.now();
+    state.dropped.store(0, .monotonic);
+    state.active.store(true, .release);
+}
+
+/// stop recording and free all the buffers
+pub fn stop(
+) void
+{
+    if (!ENABLED) {
+        return;
+    }
+
+    state.active.store(false, .release);
+
+    state.mutex.lock();
+    defer state.mutex.unlock();
+
+    var maybe_buffer = state.buffers;
+    while (maybe_buffer)
+        |buffer|
+    {
+        maybe_buffer = buffer.next;
+        buffer.events.deinit(state.allocator);
+        state.allocator.destroy(buffer);
+    }
+    state.buffers = null;
+    state.generation +%= 1;
+}
+
+/// true if spans are compiled in and start() has been called
+pub fn is_recording(
+) bool
+{
+    return ENABLED and state.active.load(.monotonic);
+}
+
+/// number of spans lost because a buffer could not grow
+pub fn dropped_count(
+) usize
+{
+    if (!ENABLED) {
+        return 0;
+    }
+    return state.dropped.load(.monotonic);
+}
+
+/// buffer for the calling thread, registering a new one if needed
+fn thread_buffer(
+) ?*ThreadBuffer
+{
+    state.mutex.lock();
+    defer state.mutex.unlock();
+
+    if (local_buffer != null and local_generation == state.generation) {
+        return local_buffer;
+    }
+
+    const buffer = state.allocator.create(ThreadBuffer) catch return null;
+    buffer.* = .{
+        .tid = std.Thread.getCurrentId(),
+        .next = state.buffers,
+    };
+    state.buffers = buffer;
+
+    local_buffer = buffer;
+    local_generation = state.generation;
+
+    return buffer;
+}
+
+fn record(
+    event: Event,
+) void
+{
+    if (!state.active.load(.acquire)) {
+        return;
+    }
+
+    // the generation only changes in start()/stop(), which must not race
+    // with recording threads, so this check is safe without the lock
+    const buffer = (
+        if (local_buffer != null and local_generation == state.generation)
+            local_buffer.?
+        else thread_buffer() orelse {
+            _ = state.dropped.fetchAdd(1, .monotonic);
+            return;
+        }
+    );
+
+    buffer.events.append(state.allocator, event) catch {
+        _ = state.dropped.fetchAdd(1, .monotonic);
+    };
+}
+
+/// write everything recorded since start() as Trace Event Format JSON
+pub fn write_chrome_trace(
+    writer: anytype,
+) !void
+{
+    var ws = std.json.writeStream(writer, .{ .whitespace = .minified });
+    defer ws.deinit();
+
+    try ws.beginObject();
+    try ws.objectField("displayTimeUnit");
+    try ws.write("ns");
+    try ws.objectField("traceEvents");
+    try ws.beginArray();
+
+    if (ENABLED)
+    {
+        state.mutex.lock();
+        defer state.mutex.unlock();
+
+        var maybe_buffer = state.buffers;
+        while (maybe_buffer)
+            |buffer|
+            : (maybe_buffer = buffer.next)
+        {
+            for (buffer.events.items)
+                |event|
+            {
+                try write_event(&ws, buffer.tid, event);
+            }
+        }
+    }
+
+    try ws.endArray();
+    try ws.endObject();
+}
+
+/// write a complete ("X") event.  Timestamps are in microseconds.
+fn write_event(
+    ws: anytype,
+    tid: std.Thread.Id,
+    event: Event,
+) !void
+{
+    try ws.beginObject();
+    try ws.objectField("name");
+    try ws.write(event.name);
+    try ws.objectField("cat");
+    try ws.write("wrinkles");
+    try ws.objectField("ph");
+    try ws.write("X");
+    try ws.objectField("ts");
+    try ws.write(@as(f64, @floatFromInt(event.start_ns)) / 1000.0);
+    try ws.objectField("dur");
+    try ws.write(@as(f64, @floatFromInt(event.duration_ns)) / 1000.0);
+    try ws.objectField("pid");
+    try ws.write(1);
+    try ws.objectField("tid");
+    try ws.write(tid);
+    if (event.size)
+        |size|
+    {
+        try ws.objectField("args");
+        try ws.beginObject();
+        try ws.objectField("size");
+        try ws.write(size);
+        try ws.endObject();
+    }
+    try ws.endObject();
+}
+
+/// write_chrome_trace to the file at path
+pub fn write_chrome_trace_file(
+    path: []const u8,
+) !void
+{
+    const file = try std.fs.cwd().createFile(path, .{});
+    defer file.close();
+
+    var buffered = std.io.bufferedWriter(file.writer());
+    try write_chrome_trace(buffered.writer());
+    try buffered.flush();
+}
+
+test "tracing: spans are recorded and exported"
+{
+    try start(std.testing.allocator);
+    defer stop();
+
+    {
+        const outer = begin("outer");
+        defer outer.end();
+
+        const inner = begin_sized("inner", 12);
+        inner.end();
+    }
+
+    var buf = std.ArrayList(u8).init(std.testing.allocator);
+    defer buf.deinit();
+
+    try write_chrome_trace(buf.writer());
+
+    const parsed = try std.json.parseFromSlice(
+        std.json.Value,
+        std.testing.allocator,
+        buf.items,
+        .{},
+    );
+    defer parsed.deinit();
+
+    const events = parsed.value.object.get("traceEvents").?.array.items;
+
+    if (!ENABLED)
+    {
+        try std.testing.expectEqual(0, events.len);
+        return;
+    }
+
+    try std.testing.expectEqual(2, events.len);
+    try std.testing.expectEqual(0, dropped_count());
+
+    // inner ends first
+    try std.testing.expectEqualStrings(
+        "inner",
+        events[0].object.get("name").?.string,
+    );
+    try std.testing.expectEqual(
+        12,
+        events[0].object.get("args").?.object.get("size").?.integer,
+    );
+    try std.testing.expectEqualStrings(
+        "outer",
+        events[1].object.get("name").?.string,
+    );
+}
+
+test "tracing: nothing is recorded when stopped"
+{
+    stop();
+
+    const span = begin("ignored");
+    span.end();
+
+    try std.testing.expect(is_recording() == false);
+
+    var buf = std.ArrayList(u8).init(std.testing.allocator);
+    defer buf.deinit();
+
+    try write_chrome_trace(buf.writer());
+
+    try std.testing.expectEqualStrings(
+        "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}",
+        buf.items,
+    );
+}
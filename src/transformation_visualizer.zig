@@ -6,8 +6,7 @@ const zplot = zgui.plot;
 const sokol_app_wrapper = @import("sokol_app_wrapper");
 
 const topology = @import("topology");
-const curve = @import("curve");
-const opentime = @import("opentime");
+const plot_series = @import("plot_series");
 
 const build_options = @import("build_options");
 const WINDOW_TITLE = (
@@ -19,8 +18,6 @@ const WINDOW_TITLE = (
 const exe_build_options = @import("exe_build_options");
 const content_dir = exe_build_options.content_dir;
 
-const PLOT_STEPS = 1000;
-
 /// plot a given mapping with dear imgui
 pub fn plot_mapping(
     allocator: std.mem.Allocator,
@@ -28,189 +25,111 @@ pub fn plot_mapping(
     name: [:0]const u8,
 ) !void
 {
-    const input_bounds_ord = map.input_bounds();
-    var input_bounds : [2]f64 = .{
-        input_bounds_ord.start.as(f64),
-        input_bounds_ord.end.as(f64),
-    };
-
     const plot_limits = zgui.plot.getPlotLimits(
         .x1,
         .y1
     );
 
-    if (input_bounds_ord.start.is_inf()) {
-        input_bounds[0] = plot_limits.x[0];
-    }
-    if (input_bounds_ord.end.is_inf()) {
-        input_bounds[1] = plot_limits.x[1];
-    }
-
-    var inputs = std.ArrayList(f64).init(allocator);
-    try inputs.ensureTotalCapacity(PLOT_STEPS);
-    defer inputs.deinit();
-    var outputs = std.ArrayList(f64).init(allocator);
-    try outputs.ensureTotalCapacity(PLOT_STEPS);
-    defer outputs.deinit();
-    var len : usize = 0;
-
-    switch (map) {
-        .affine => |map_aff| {
-            try inputs.append(input_bounds[0]);
-            try inputs.append(input_bounds[1]);
-
-            try outputs.append(
-                (
-                 try map_aff.project_instantaneous_cc(
-                     opentime.Ordinate.init(input_bounds[0])
-                 ).ordinate()
-                ).as(f64)
-            );
-            try outputs.append(
-                (
-                 try map_aff.project_instantaneous_cc(
-                     opentime.Ordinate.init(input_bounds[1])
-                 ).ordinate()
-                ).as(f64)
-            );
-
-            len = 2;
-        },
-        .linear => |map_lin| {
-            for (map_lin.input_to_output_curve.knots)
-                |k|
-            {
-                try inputs.append(k.in.as(f64));
-                try outputs.append(k.out.as(f64));
-            }
-
-            len = map_lin.input_to_output_curve.knots.len;
-        },
-        // .bezier => |map_bez| {
-        //     const step = (
-        //         @as(f32, @floatCast(input_bounds[1] - input_bounds[0])) 
-        //         / @as(f32, @floatFromInt(PLOT_STEPS))
-        //     );
-        //
-        //     var x = input_bounds[0];
-        //     while (x <= input_bounds[1])
-        //         : (x += step)
-        //     {
-        //         try inputs.append(x);
-        //         try outputs.append(
-        //             try map_bez.project_instantaneous_cc(@floatCast(x))
-        //         );
-        //     }
-        //
-        //     len = PLOT_STEPS;
-        // },
-
-        inline else => {},
-    }
-
-    try inputs.resize(len);
-    const in_im = try inputs.toOwnedSlice();
-    try outputs.resize(len);
-    const out_im = try outputs.toOwnedSlice();
+    const series = try plot_series.mapping_series(
+        allocator,
+        name,
+        map,
+        plot_limits.x,
+    );
+    defer series.deinit(allocator);
 
     zplot.plotLine(
         name,
         f64, 
         .{
-            .xv = in_im,
-            .yv = out_im, 
+            .xv = series.xv,
+            .yv = series.yv, 
         },
     );
 }
 
 /// ui for a particular space
-const SpaceUI = struct {
-    name: []const u8,
-    input: []const u8,
-    output: []const u8,
-    mapping: topology.mapping.Mapping,
-
-    pub fn draw_ui(
-        self: @This(),
-        allocator: std.mem.Allocator,
-    ) !void
+fn draw_space_ui(
+    self: plot_series.Space,
+    allocator: std.mem.Allocator,
+) !void
+{
+    var buf : [1024:0]u8 = undefined;
+    const label = try std.fmt.bufPrintZ(
+        &buf,
+        "Space: {s}",
+        .{ self.name }
+    );
+    if (
+        zgui.collapsingHeader(
+            label,
+            .{ .default_open = true }
+            )
+        )
     {
-        var buf : [1024:0]u8 = undefined;
-        const label = try std.fmt.bufPrintZ(
-            &buf,
-            "Space: {s}",
-            .{ self.name }
+        zgui.text(
+            "Input space name: {s}\n"
+            ++ "Transform type: {s}\n"
+            ++ "output space name: {s}",
+            .{
+                self.input,
+                @tagName(self.mapping),
+                self.output,
+            }
+        );
+
+        const plot_label = try std.fmt.bufPrintZ(
+            buf[label.len..],
+            "{s}.{s} -> {s}.{s} Mapping Plot",
+            .{ self.name, self.input, self.name, self.output },
         );
         if (
-            zgui.collapsingHeader(
-                label,
-                .{ .default_open = true }
-                )
+            zgui.plot.beginPlot(
+                plot_label,
+                .{ 
+                    .w = -1.0,
+                    .h = -1.0,
+                    .flags = .{ .equal = true },
+                }
             )
+        ) 
         {
-            zgui.text(
-                "Input space name: {s}\n"
-                ++ "Transform type: {s}\n"
-                ++ "output space name: {s}",
+            defer zgui.plot.endPlot();
+
+            zgui.plot.setupAxis(
+                .x1,
+                .{ .label = @ptrCast(self.input) }
+            );
+            zgui.plot.setupAxis(
+                .y1,
+                .{ .label = @ptrCast(self.output) }
+            );
+            zgui.plot.setupLegend(
+                .{ 
+                    .south = true,
+                    .west = true 
+                },
+                .{}
+            );
+            const input_limits = self.mapping.input_bounds();
+            zgui.plot.setupAxisLimits(
+                .x1, 
                 .{
-                    self.input,
-                    @tagName(self.mapping),
-                    self.output,
-                }
+                    .min = input_limits.start.as(f64),
+                    .max = input_limits.end.as(f64),
+                },
             );
 
-            const plot_label = try std.fmt.bufPrintZ(
-                buf[label.len..],
-                "{s}.{s} -> {s}.{s} Mapping Plot",
-                .{ self.name, self.input, self.name, self.output },
+            const output_limits = self.mapping.output_bounds();
+            zgui.plot.setupAxisLimits(
+                .y1, 
+                .{
+                    .min = output_limits.start.as(f64),
+                    .max = output_limits.end.as(f64),
+                },
             );
-            if (
-                zgui.plot.beginPlot(
-                    plot_label,
-                    .{ 
-                        .w = -1.0,
-                        .h = -1.0,
-                        .flags = .{ .equal = true },
-                    }
-                )
-            ) 
-            {
-                defer zgui.plot.endPlot();
 
-                zgui.plot.setupAxis(
-                    .x1,
-                    .{ .label = @ptrCast(self.input) }
-                );
-                zgui.plot.setupAxis(
-                    .y1,
-                    .{ .label = @ptrCast(self.output) }
-                );
-                zgui.plot.setupLegend(
-                    .{ 
-                        .south = true,
-                        .west = true 
-                    },
-                    .{}
-                );
-                const input_limits = self.mapping.input_bounds();
-                zgui.plot.setupAxisLimits(
-                    .x1, 
-                    .{
-                        .min = input_limits.start.as(f64),
-                        .max = input_limits.end.as(f64),
-                    },
-                );
-
-                const output_limits = self.mapping.output_bounds();
-                zgui.plot.setupAxisLimits(
-                    .y1, 
-                    .{
-                        .min = output_limits.start.as(f64),
-                        .max = output_limits.end.as(f64),
-                    },
-                );
-
-                zgui.plot.setupFinish();
+            zgui.plot.setupFinish();
 
             const graph_label = try std.fmt.bufPrintZ(
                 buf[label.len + plot_label.len..],
@@ -218,116 +137,19 @@ const SpaceUI = struct {
                 .{ self.name, self.input, self.name, self.output },
             );
 
-                try plot_mapping(
-                    allocator,
-                    self.mapping,
-                    graph_label,
-                );
-            }
+            try plot_mapping(
+                allocator,
+                self.mapping,
+                graph_label,
+            );
         }
     }
-};
-
-/// state for the ui
-const UI = struct {
-    spaces: []const SpaceUI = &.{},
-};
-
-/// preset examples to choose from... pub const decls get added to an enum
-/// and shown in the dropdown in the menu
-const PRESETS = struct{
-    pub const single_identity = UI{ 
-        .spaces = &.{
-            .{ 
-                .name = "Clip",
-                .input = "presentation",
-                .output = "media",
-                .mapping = topology.mapping.INFINITE_IDENTITY,
-            },
-        },
-    };
-
-    pub const single_affine = UI{
-        .spaces = &.{
-            .{ 
-                .name = "Clip",
-                .input = "presentation",
-                .output = "media",
-                .mapping = (
-                    topology.mapping.MappingAffine{
-                        .input_bounds_val = opentime.ContinuousInterval.init(
-                            .{ 
-                                .start = -10,
-                                .end = 10, 
-                            },
-                        ),
-                        .input_to_output_xform = .{
-                                .offset = opentime.Ordinate.init(10),
-                                .scale = opentime.Ordinate.init(2), 
-                        },
-                    }
-                ).mapping(),
-            },
-        },
-    };
-
-    pub const affine_linear = UI{
-        .spaces = &.{
-            .{ 
-                .name = "Track",
-                .input = "presentation",
-                .output = "media",
-                .mapping = (
-                    topology.mapping.MappingAffine{
-                        .input_bounds_val = opentime.ContinuousInterval.init(
-                            .{ 
-                                .start = -10,
-                                .end = 10, 
-                            }
-                        ),
-                        .input_to_output_xform = .{
-                            .offset = opentime.Ordinate.init(10),
-                            .scale = opentime.Ordinate.init(2),
-                        },
-                    }
-                ).mapping(),
-            },
-            .{ 
-                .name = "Clip",
-                .input = "presentation",
-                .output = "media",
-                .mapping = (
-                    topology.mapping.MappingCurveLinearMonotonic{
-                        .input_to_output_curve = .{
-                                .knots = @constCast(
-                                    &[_]curve.ControlPoint{
-                                        .{
-                                            .in = opentime.Ordinate.init(-10),
-                                            .out = opentime.Ordinate.init(-10),
-                                        },
-                                        .{ 
-                                            .in = opentime.Ordinate.init(0),
-                                            .out = opentime.Ordinate.init(0),
-                                        },
-                                        .{ 
-                                            .in = opentime.Ordinate.init(5),
-                                            .out = opentime.Ordinate.init(10),
-                                        },
-                                    },
-                                )
-                            },
-                        }
-                ).mapping(),
-            },
-        },
-    };
-};
-const PresetNames = std.meta.DeclEnum(PRESETS);
+}
 
 /// wrap the state for the entire UI
 const State = struct {
-    current_preset : PresetNames = .single_affine,
-    data : UI = .{}, 
+    current_preset : plot_series.PresetNames = .single_affine,
+    data : plot_series.Preset = .{}, 
 };
 var STATE = State{};
 
@@ -402,12 +224,7 @@ fn draw_err(
                 if (zgui.button("LOAD PRESET", .{}))
                 {
                     // load into state
-                    STATE.data = switch(STATE.current_preset) {
-                        inline else => |f| @field(
-                            PRESETS,
-                            @tagName(f)
-                        ),
-                    };
+                    STATE.data = plot_series.preset(STATE.current_preset);
                 }
             }
 
@@ -423,7 +240,7 @@ fn draw_err(
                 for (STATE.data.spaces)
                     |s|
                 {
-                    try s.draw_ui(allocator);
+                    try draw_space_ui(s, allocator);
                 }
             }
         }
@@ -504,19 +321,11 @@ fn draw_err(
                 );
                 zgui.plot.setupFinish();
 
-                var total_map = STATE.data.spaces[0].mapping;
-
-                for (STATE.data.spaces[1..])
-                    |s|
-                {
-                    total_map = try topology.mapping.join(
-                        allocator,
-                        .{
-                            .a2b = total_map,
-                            .b2c = s.mapping,
-                        },
-                    );
-                }
+                const total_map = try plot_series.composed_mapping(
+                    allocator,
+                    STATE.data.spaces,
+                );
+                defer total_map.deinit(allocator);
 
                 const line_label = try std.fmt.bufPrintZ(
                     buf,
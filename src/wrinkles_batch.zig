@@ -0,0 +1,273 @@
+//! Command line front end for the batch preprocessing pipeline.
+//!
+//! Usage:
+//!     wrinkles_batch [--read-threads N] [--map-threads N]
+//!                    [--project-threads N] [--queue N] path ...
+//!
+//! Every path is either an .otio file or a directory that is searched
+//! recursively for .otio files.  Each file is read, mapped and projected to
+//! media from its presentation space, and the media usage of all the files
+//! is printed as JSON along with the throughput of each stage.
+
+const std = @import("std");
+
+const otio = @import("opentimelineio");
+const batch = otio.batch;
+
+const USAGE = (
+    \\usage: wrinkles_batch [--read-threads N] [--map-threads N]
+    \\           [--project-threads N] [--queue N] path ...
+    \\
+);
+
+/// a command line flag and the batch.Config field it sets
+const FLAGS = .{
+    .{ "--read-threads", "read_threads" },
+    .{ "--map-threads", "map_threads" },
+    .{ "--project-threads", "project_threads" },
+    .{ "--queue", "queue_capacity" },
+};
+
+/// number of kinds of media reference
+const MEDIA_KIND_COUNT = std.meta.fields(otio.schema.MediaDataReference).len;
+
+/// media usage summed over every file
+const MediaUsage = struct {
+    files: usize = 0,
+    failed_files: usize = 0,
+    segments: usize = 0,
+    operators: usize = 0,
+    /// distinct clips with media visible in the presentation space
+    clips: usize = 0,
+    /// clips per kind of media reference
+    media: [MEDIA_KIND_COUNT]usize = [_]usize{0} ** MEDIA_KIND_COUNT,
+    /// presentation time covered by media, summed over the operators of
+    /// every segment
+    media_seconds: f64 = 0,
+
+    allocator: std.mem.Allocator,
+
+    pub fn reduce(
+        self: *@This(),
+        file: batch.File,
+    ) !void
+    {
+        self.files += 1;
+        self.segments += file.po_map.operators.len;
+
+        var clips = std.AutoHashMap(otio.ComposedValueRef, void).init(
+            self.allocator
+        );
+        defer clips.deinit();
+
+        for (file.po_map.operators, 0..)
+            |segment_ops, ind|
+        {
+            self.operators += segment_ops.len;
+
+            const duration = file.po_map.end_points[ind + 1].sub(
+                file.po_map.end_points[ind]
+            );
+            self.media_seconds += (
+                duration.as(f64) * @as(f64, @floatFromInt(segment_ops.len))
+            );
+
+            for (segment_ops)
+                |op|
+            {
+                const entry = try clips.getOrPut(op.destination.ref);
+                if (entry.found_existing) {
+                    continue;
+                }
+
+                self.clips += 1;
+                switch (op.destination.ref) {
+                    .clip_ptr => |cl| {
+                        self.media[@intFromEnum(cl.media.ref)] += 1;
+                    },
+                    else => {},
+                }
+            }
+        }
+    }
+
+    pub fn failed(
+        self: *@This(),
+        path: []const u8,
+        err: anyerror,
+    ) void
+    {
+        self.failed_files += 1;
+        std.log.warn("{s}: {s}", .{ path, @errorName(err) });
+    }
+};
+
+/// append path, or every .otio file under it if it is a directory
+fn collect_paths(
+    allocator: std.mem.Allocator,
+    path: []const u8,
+    paths: *std.ArrayList([]const u8),
+) !void
+{
+    var dir = std.fs.cwd().openDir(path, .{ .iterate = true }) catch |err| {
+        switch (err) {
+            error.NotDir => {
+                try paths.append(try allocator.dupe(u8, path));
+                return;
+            },
+            else => return err,
+        }
+    };
+    defer dir.close();
+
+    var walker = try dir.walk(allocator);
+    defer walker.deinit();
+
+    while (try walker.next())
+        |entry|
+    {
+        if (
+            entry.kind != .file
+            or !std.mem.endsWith(u8, entry.basename, ".otio")
+        )
+        {
+            continue;
+        }
+
+        try paths.append(
+            try std.fs.path.join(allocator, &.{ path, entry.path })
+        );
+    }
+}
+
+/// JSON friendly view of a batch.StageStats
+fn stage_report(
+    stage: batch.StageStats,
+) struct {
+    threads: usize,
+    items: usize,
+    failures: usize,
+    busy_ns: u64,
+    done_ns: u64,
+    items_per_s: f64,
+    utilization: f64,
+}
+{
+    return .{
+        .threads = stage.threads,
+        .items = stage.items,
+        .failures = stage.failures,
+        .busy_ns = stage.busy_ns,
+        .done_ns = stage.done_ns,
+        .items_per_s = stage.items_per_s(),
+        .utilization = stage.utilization(),
+    };
+}
+
+pub fn main(
+) !void
+{
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    var config = batch.Config{};
+
+    var paths = std.ArrayList([]const u8).init(allocator);
+    defer {
+        for (paths.items)
+            |path|
+        {
+            allocator.free(path);
+        }
+        paths.deinit();
+    }
+
+    var arg_ind: usize = 1;
+    args: while (arg_ind < args.len)
+        : (arg_ind += 1)
+    {
+        const arg = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--help"))
+        {
+            try std.io.getStdOut().writeAll(USAGE);
+            return;
+        }
+
+        if (!std.mem.startsWith(u8, arg, "--"))
+        {
+            try collect_paths(allocator, arg, &paths);
+            continue;
+        }
+
+        if (arg_ind + 1 >= args.len)
+        {
+            std.log.err("{s} requires a value\n{s}", .{ arg, USAGE });
+            return error.MissingArgument;
+        }
+        arg_ind += 1;
+        const value = args[arg_ind];
+
+        inline for (FLAGS)
+            |flag|
+        {
+            if (std.mem.eql(u8, arg, flag[0]))
+            {
+                @field(config, flag[1]) = try std.fmt.parseInt(
+                    usize,
+                    value,
+                    10,
+                );
+                continue :args;
+            }
+        }
+
+        std.log.err("unknown argument: '{s}'\n{s}", .{ arg, USAGE });
+        return error.UnknownArgument;
+    }
+
+    if (paths.items.len == 0)
+    {
+        std.log.err("no .otio files given\n{s}", .{ USAGE });
+        return error.MissingArgument;
+    }
+
+    var usage = MediaUsage{ .allocator = allocator };
+    const stats = try batch.run(
+        allocator,
+        paths.items,
+        config,
+        MediaUsage,
+        &usage,
+    );
+
+    const stdout = std.io.getStdOut().writer();
+    try std.json.stringify(
+        .{
+            .config = config,
+            .usage = .{
+                .files = usage.files,
+                .failed_files = usage.failed_files,
+                .segments = usage.segments,
+                .operators = usage.operators,
+                .clips = usage.clips,
+                .media = usage.media,
+                .media_seconds = usage.media_seconds,
+            },
+            .stages = .{
+                .read = stage_report(stats.read),
+                .map = stage_report(stats.map),
+                .project = stage_report(stats.project),
+                .reduce = stage_report(stats.reduce),
+            },
+            .wall_ns = stats.wall_ns,
+        },
+        .{ .whitespace = .indent_2 },
+        stdout,
+    );
+    try stdout.writeByte('\n');
+}
@@ -0,0 +1,1091 @@
+//! Benchmark harness for the core wrinkles operations.
+//!
+//! Each benchmark is parameterized by a problem size and reports wall clock
+//! time per operation, throughput, allocation counts and sizes, peak live
+//! bytes and the peak resident set size of the process as JSON on stdout.
+//!
+//! Usage:
+//!     wrinkles_bench [benchmark ...] [--size N] [--iterations N]
+//!                    [--trace trace.json]
+//!
+//! Run `wrinkles_bench --list` to print the available benchmarks.  With no
+//! benchmark names every benchmark is run.  Via the build system:
+//!     zig build bench -Doptimize=ReleaseFast -- join_linear --size 10000
+//!
+//! --trace writes the spans recorded during the run as Chrome trace JSON.  It
+//! requires building with -Denable_tracing=true.
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+const build_options = @import("build_options");
+
+const opentime = @import("opentime");
+const curve = @import("curve");
+const topology = @import("topology");
+const treecode = @import("treecode");
+const sampling = @import("sampling");
+const otio = @import("opentimelineio");
+const allocation_tracker = @import("allocation_tracker");
+const tracing = @import("tracing");
+
+const DEFAULT_SIZE = 1000;
+const DEFAULT_ITERATIONS = 100;
+
+/// parameters shared by every benchmark
+const Config = struct {
+    /// problem size, interpreted per benchmark (clips, knots, samples...)
+    size: usize = DEFAULT_SIZE,
+    /// number of timed calls to run()
+    iterations: usize = DEFAULT_ITERATIONS,
+};
+
+/// measurement for a single benchmark, serialized to JSON
+const Result = struct {
+    name: []const u8,
+    size: usize,
+    iterations: usize,
+    total_ns: u64,
+    ns_per_op: f64,
+    ops_per_s: f64,
+    /// allocations made per call to run()
+    allocations_per_op: f64,
+    /// bytes requested per call to run()
+    bytes_allocated_per_op: f64,
+    /// largest number of bytes live at once during the timed runs
+    peak_live_bytes: usize,
+    /// allocation count per power of two size class over the timed runs,
+    /// see allocation_tracker.Stats.size_class
+    size_classes: [allocation_tracker.SIZE_CLASS_COUNT]usize,
+    /// peak resident set size of the process after the benchmark
+    peak_rss_bytes: usize,
+};
+
+/// peak resident set size of this process in bytes, 0 if unsupported
+fn peak_rss_bytes(
+) usize
+{
+    switch (builtin.os.tag) {
+        .linux, .macos, .freebsd, .netbsd, .openbsd => {},
+        else => return 0,
+    }
+
+    const usage = std.posix.getrusage(std.posix.rusage.SELF);
+    const maxrss: usize = @intCast(usage.maxrss);
+
+    // darwin reports bytes, everyone else reports kilobytes
+    return if (builtin.os.tag == .macos) maxrss else maxrss * 1024;
+}
+
+/// time Bench.run() config.iterations times.  Bench must provide:
+///     setup(allocator, size) !Bench
+///     run(self, allocator) !void
+///     deinit(self, allocator) void
+fn measure(
+    comptime name: []const u8,
+    comptime Bench: type,
+    parent_allocator: std.mem.Allocator,
+    config: Config,
+) !Result
+{
+    const state = try Bench.setup(parent_allocator, config.size);
+    defer state.deinit(parent_allocator);
+
+    // warm up caches and lazily initialized state outside of the timing
+    try state.run(parent_allocator);
+
+    var tracker = allocation_tracker.AllocationTracker.init(parent_allocator);
+    defer tracker.deinit();
+    const allocator = tracker.allocator();
+
+    var timer = try std.time.Timer.start();
+    for (0..config.iterations)
+        |_|
+    {
+        try state.run(allocator);
+    }
+    const total_ns = timer.read();
+    const stats = tracker.totals;
+
+    const iterations_f: f64 = @floatFromInt(@max(config.iterations, 1));
+    const total_ns_f: f64 = @floatFromInt(total_ns);
+    const ns_per_op = total_ns_f / iterations_f;
+
+    return .{
+        .name = name,
+        .size = config.size,
+        .iterations = config.iterations,
+        .total_ns = total_ns,
+        .ns_per_op = ns_per_op,
+        .ops_per_s = if (ns_per_op > 0) std.time.ns_per_s / ns_per_op else 0,
+        .allocations_per_op = (
+            @as(f64, @floatFromInt(stats.allocations)) / iterations_f
+        ),
+        .bytes_allocated_per_op = (
+            @as(f64, @floatFromInt(stats.bytes_allocated)) / iterations_f
+        ),
+        .peak_live_bytes = stats.peak_live_bytes,
+        .size_classes = stats.size_classes,
+        .peak_rss_bytes = peak_rss_bytes(),
+    };
+}
+
+//
+// Fixtures
+//
+
+/// a generated single track timeline of `clip_count` clips with some gaps
+fn generated_timeline(
+    allocator: std.mem.Allocator,
+    clip_count: usize,
+) !otio.timeline_generator.GeneratedTimeline
+{
+    return try otio.timeline_generator.generate(
+        allocator,
+        .{
+            .track_count = 1,
+            .clips_per_track = clip_count,
+            .gap_ratio = 0.25,
+            .with_names = false,
+        },
+    );
+}
+
+/// a monotonic linear curve with `knot_count` knots over [0, knot_count)
+fn wobbly_linear_curve(
+    allocator: std.mem.Allocator,
+    knot_count: usize,
+    slope: opentime.Ordinate.BaseType,
+) !curve.Linear.Monotonic
+{
+    const knots = try allocator.alloc(
+        curve.ControlPoint,
+        @max(knot_count, 2),
+    );
+
+    var out: opentime.Ordinate.BaseType = 0;
+    for (knots, 0..)
+        |*k, ind|
+    {
+        k.* = curve.ControlPoint.init(
+            .{ .in = @floatFromInt(ind), .out = out },
+        );
+        // alternate between two slopes so the curve isn't collinear
+        out += if (@rem(ind, 2) == 0) slope else slope * 0.5;
+    }
+
+    return .{ .knots = knots };
+}
+
+/// a monotonic bezier curve with `segment_count` eased segments
+fn eased_bezier_curve(
+    allocator: std.mem.Allocator,
+    segment_count: usize,
+) !curve.Bezier
+{
+    const segments = try allocator.alloc(
+        curve.Bezier.Segment,
+        @max(segment_count, 1),
+    );
+
+    for (segments, 0..)
+        |*seg, ind|
+    {
+        const s: opentime.Ordinate.BaseType = @floatFromInt(ind);
+        seg.* = curve.Bezier.Segment.init_f32(
+            .{
+                .p0 = .{ .in = s, .out = s },
+                .p1 = .{ .in = s + 1.0/3.0, .out = s + 0.1 },
+                .p2 = .{ .in = s + 2.0/3.0, .out = s + 0.9 },
+                .p3 = .{ .in = s + 1.0, .out = s + 1.0 },
+            },
+        );
+    }
+
+    return .{ .segments = segments };
+}
+
+//
+// Benchmarks
+//
+
+/// build a treecode `size` bits long, clone, hash and compare it, then walk a
+/// second treecode towards it one step at a time
+const TreecodeBench = struct {
+    size: usize,
+
+    pub fn setup(
+        _: std.mem.Allocator,
+        size: usize,
+    ) !TreecodeBench
+    {
+        return .{ .size = size };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        var dest = try treecode.Treecode.init_word(
+            allocator,
+            treecode.ROOT_TREECODE,
+        );
+        defer dest.deinit();
+
+        for (0..self.size)
+            |ind|
+        {
+            try dest.append(@intCast(@rem(ind, 2)));
+        }
+
+        const dest_clone = try dest.clone();
+        defer dest_clone.deinit();
+
+        std.mem.doNotOptimizeAway(dest.hash());
+        std.mem.doNotOptimizeAway(dest.eql(dest_clone));
+
+        var walker = try treecode.Treecode.init_word(
+            allocator,
+            treecode.ROOT_TREECODE,
+        );
+        defer walker.deinit();
+
+        while (walker.code_length() < dest.code_length())
+        {
+            try walker.append(try walker.next_step_towards(dest));
+            std.mem.doNotOptimizeAway(dest.is_superset_of(walker));
+        }
+    }
+
+    pub fn deinit(
+        _: @This(),
+        _: std.mem.Allocator,
+    ) void
+    {
+    }
+};
+
+/// build_topological_map over a track of `size` clips
+const TopologicalMapBench = struct {
+    generated: otio.timeline_generator.GeneratedTimeline,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !TopologicalMapBench
+    {
+        return .{
+            .generated = try generated_timeline(allocator, size),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const map = try otio.build_topological_map(
+            allocator,
+            self.generated.ref(),
+        );
+        map.deinit();
+    }
+
+    pub fn deinit(
+        self: @This(),
+        _: std.mem.Allocator,
+    ) void
+    {
+        self.generated.deinit();
+    }
+};
+
+/// projection_map_to_media_from the presentation space of a track of `size`
+/// clips
+const ProjectionMapBench = struct {
+    generated: otio.timeline_generator.GeneratedTimeline,
+    map: otio.TopologicalMap,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !ProjectionMapBench
+    {
+        const generated = try generated_timeline(allocator, size);
+        return .{
+            .generated = generated,
+            .map = try otio.build_topological_map(allocator, generated.ref()),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const proj_map = try otio.projection_map_to_media_from(
+            allocator,
+            self.map,
+            try self.generated.ref().space(.presentation),
+        );
+        proj_map.deinit();
+    }
+
+    pub fn deinit(
+        self: @This(),
+        _: std.mem.Allocator,
+    ) void
+    {
+        self.map.deinit();
+        self.generated.deinit();
+    }
+};
+
+/// projection_map, built into a per document MappingPool and released with it
+/// instead of one allocation per operator
+const ProjectionMapPooledBench = struct {
+    generated: otio.timeline_generator.GeneratedTimeline,
+    map: otio.TopologicalMap,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !ProjectionMapPooledBench
+    {
+        const generated = try generated_timeline(allocator, size);
+        return .{
+            .generated = generated,
+            .map = try otio.build_topological_map(allocator, generated.ref()),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        var pool = topology.MappingPool.init(allocator);
+        defer pool.deinit();
+
+        const proj_map = try otio.projection_map_to_media_from_pooled(
+            allocator,
+            &pool,
+            self.map,
+            try self.generated.ref().space(.presentation),
+        );
+        proj_map.deinit();
+    }
+
+    pub fn deinit(
+        self: @This(),
+        _: std.mem.Allocator,
+    ) void
+    {
+        self.map.deinit();
+        self.generated.deinit();
+    }
+};
+
+/// topology.join of two affine topologies (size is ignored)
+const JoinAffineBench = struct {
+    a2b: topology.Topology,
+    b2c: topology.Topology,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        _: usize,
+    ) !JoinAffineBench
+    {
+        return .{
+            .a2b = try topology.Topology.init_affine(
+                allocator,
+                .{
+                    .input_bounds_val = opentime.ContinuousInterval.init(
+                        .{ .start = 0, .end = 10 },
+                    ),
+                    .input_to_output_xform = .{
+                        .offset = opentime.Ordinate.init(2),
+                        .scale = opentime.Ordinate.init(2),
+                    },
+                },
+            ),
+            .b2c = try topology.Topology.init_affine(
+                allocator,
+                .{
+                    .input_bounds_val = opentime.ContinuousInterval.init(
+                        .{ .start = 5, .end = 15 },
+                    ),
+                    .input_to_output_xform = .{
+                        .offset = opentime.Ordinate.init(-1),
+                        .scale = opentime.Ordinate.init(0.5),
+                    },
+                },
+            ),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const a2c = try topology.join(
+            allocator,
+            .{ .a2b = self.a2b, .b2c = self.b2c },
+        );
+        a2c.deinit(allocator);
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.a2b.deinit(allocator);
+        self.b2c.deinit(allocator);
+    }
+};
+
+/// topology.join_general of the JoinAffineBench topologies, the cost of an
+/// affine join without the analytic fast path (size is ignored)
+const JoinAffineGeneralBench = struct {
+    inner: JoinAffineBench,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !JoinAffineGeneralBench
+    {
+        return .{
+            .inner = try JoinAffineBench.setup(allocator, size),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const a2c = try topology.join_general(
+            allocator,
+            .{ .a2b = self.inner.a2b, .b2c = self.inner.b2c },
+        );
+        a2c.deinit(allocator);
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.inner.deinit(allocator);
+    }
+};
+
+/// topology.join of two linear topologies with `size` knots each
+const JoinLinearBench = struct {
+    a2b: topology.Topology,
+    b2c: topology.Topology,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !JoinLinearBench
+    {
+        const a2b_crv = try wobbly_linear_curve(allocator, size, 0.5);
+        defer a2b_crv.deinit(allocator);
+        const b2c_crv = try wobbly_linear_curve(allocator, size, 2);
+        defer b2c_crv.deinit(allocator);
+
+        return .{
+            .a2b = try topology.Topology.init_from_linear_monotonic(
+                allocator,
+                a2b_crv,
+            ),
+            .b2c = try topology.Topology.init_from_linear_monotonic(
+                allocator,
+                b2c_crv,
+            ),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const a2c = try topology.join(
+            allocator,
+            .{ .a2b = self.a2b, .b2c = self.b2c },
+        );
+        a2c.deinit(allocator);
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.a2b.deinit(allocator);
+        self.b2c.deinit(allocator);
+    }
+};
+
+/// a mapping of the given kind over [0, size): a 2x speed for affine, a
+/// wobbly curve with `size` knots for linear
+fn bench_mapping(
+    allocator: std.mem.Allocator,
+    comptime tag: std.meta.Tag(topology.mapping.Mapping),
+    size: usize,
+) !topology.mapping.Mapping
+{
+    const end: opentime.Ordinate.BaseType = @floatFromInt(size);
+
+    return switch (tag) {
+        .empty => @compileError(
+            "mapping.join returns early for empty mappings, nothing to time"
+        ),
+        .affine => (
+            topology.mapping.MappingAffine{
+                .input_bounds_val = opentime.ContinuousInterval.init(
+                    .{ .start = 0, .end = end },
+                ),
+                .input_to_output_xform = .{
+                    .scale = opentime.Ordinate.init(2),
+                },
+            }
+        ).mapping(),
+        .linear => (
+            topology.mapping.MappingCurveLinearMonotonic{
+                .input_to_output_curve = try wobbly_linear_curve(
+                    allocator,
+                    size,
+                    1,
+                ),
+            }
+        ).mapping(),
+    };
+}
+
+/// mapping.join of one pair of mapping kinds, one cell of the join dispatch
+/// matrix.  Linear mappings have `size` knots.  Pairs with an empty mapping
+/// are left out, join only returns early for those.
+fn MappingJoinBench(
+    comptime a2b_tag: std.meta.Tag(topology.mapping.Mapping),
+    comptime b2c_tag: std.meta.Tag(topology.mapping.Mapping),
+) type
+{
+    return struct {
+        a2b: topology.mapping.Mapping,
+        b2c: topology.mapping.Mapping,
+
+        pub fn setup(
+            allocator: std.mem.Allocator,
+            size: usize,
+        ) !@This()
+        {
+            return .{
+                .a2b = try bench_mapping(allocator, a2b_tag, size),
+                .b2c = try bench_mapping(allocator, b2c_tag, size),
+            };
+        }
+
+        pub fn run(
+            self: @This(),
+            allocator: std.mem.Allocator,
+        ) !void
+        {
+            const a2c = try topology.mapping.join(
+                allocator,
+                .{ .a2b = self.a2b, .b2c = self.b2c },
+            );
+            a2c.deinit(allocator);
+        }
+
+        pub fn deinit(
+            self: @This(),
+            allocator: std.mem.Allocator,
+        ) void
+        {
+            self.a2b.deinit(allocator);
+            self.b2c.deinit(allocator);
+        }
+    };
+}
+
+/// linearize a bezier curve of `size` segments
+const LinearizeBench = struct {
+    crv: curve.Bezier,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !LinearizeBench
+    {
+        return .{ .crv = try eased_bezier_curve(allocator, size) };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const lin = try self.crv.linearized(allocator);
+        lin.deinit(allocator);
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.crv.deinit(allocator);
+    }
+};
+
+/// evaluate a bezier curve of `size` segments and its linearization at `size`
+/// evenly spaced input ordinates
+const CurveEvalBench = struct {
+    crv: curve.Bezier,
+    lin: curve.Linear.Monotonic,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !CurveEvalBench
+    {
+        const crv = try eased_bezier_curve(allocator, size);
+        const lin = try crv.linearized(allocator);
+
+        return .{
+            .crv = crv,
+            .lin = .{ .knots = lin.knots },
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        _: std.mem.Allocator,
+    ) !void
+    {
+        for (0..self.crv.segments.len)
+            |ind|
+        {
+            // sample the middle of each segment
+            const t = opentime.Ordinate.init(
+                @as(opentime.Ordinate.BaseType, @floatFromInt(ind)) + 0.5
+            );
+            std.mem.doNotOptimizeAway(try self.crv.output_at_input(t));
+            std.mem.doNotOptimizeAway(self.lin.output_at_input(t));
+        }
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.lin.deinit(allocator);
+        self.crv.deinit(allocator);
+    }
+};
+
+/// transform_resample_dd a 48khz sine of `size` samples through a 2x speed
+/// affine warp
+const ResampleBench = struct {
+    input: sampling.Sampling,
+    output_to_input: topology.Topology,
+
+    const RATE_HZ = 48000;
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !ResampleBench
+    {
+        const duration_s = opentime.Ordinate.init(
+            @as(opentime.Ordinate.BaseType, @floatFromInt(@max(size, 2)))
+            / RATE_HZ
+        );
+
+        const signal = sampling.SignalGenerator{
+            .frequency_hz = 100,
+            .duration_s = duration_s,
+            .signal = .sine,
+        };
+
+        return .{
+            .input = try signal.rasterized(
+                allocator,
+                .{ .sample_rate_hz = .{ .Int = RATE_HZ } },
+                true,
+            ),
+            .output_to_input = try topology.Topology.init_affine(
+                allocator,
+                .{
+                    .input_bounds_val = .{
+                        .start = opentime.Ordinate.ZERO,
+                        .end = duration_s.div(2),
+                    },
+                    .input_to_output_xform = .{
+                        .scale = opentime.Ordinate.init(2),
+                    },
+                },
+            ),
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) !void
+    {
+        const result = try sampling.transform_resample_dd(
+            allocator,
+            self.input,
+            self.output_to_input,
+            self.input.index_generator,
+            true,
+        );
+        result.deinit();
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        self.output_to_input.deinit(allocator);
+        self.input.deinit();
+    }
+};
+
+/// the same render as ResampleBench played back through a ResampleCache,
+/// so after the warm up run every block is a hit
+const CachedResampleBench = struct {
+    resample: ResampleBench,
+    cache: *sampling.ResampleCache,
+    output: []sampling.sample_value_t,
+
+    pub fn setup(
+        allocator: std.mem.Allocator,
+        size: usize,
+    ) !CachedResampleBench
+    {
+        const resample = try ResampleBench.setup(allocator, size);
+        errdefer resample.deinit(allocator);
+
+        const cache = try allocator.create(sampling.ResampleCache);
+        errdefer allocator.destroy(cache);
+        cache.* = sampling.ResampleCache.init(allocator, .{});
+
+        const output = try allocator.alloc(
+            sampling.sample_value_t,
+            resample.input.index_generator.buffer_size_for_length(
+                resample.output_to_input.input_bounds().duration()
+            ),
+        );
+
+        return .{
+            .resample = resample,
+            .cache = cache,
+            .output = output,
+        };
+    }
+
+    pub fn run(
+        self: @This(),
+        _: std.mem.Allocator,
+    ) !void
+    {
+        try self.cache.samples_into(
+            @intFromPtr(self.resample.input.buffer.ptr),
+            self.resample.input,
+            self.resample.output_to_input,
+            self.resample.input.index_generator,
+            true,
+            0,
+            self.output,
+        );
+    }
+
+    pub fn deinit(
+        self: @This(),
+        allocator: std.mem.Allocator,
+    ) void
+    {
+        allocator.free(self.output);
+        self.cache.deinit();
+        allocator.destroy(self.cache);
+        self.resample.deinit(allocator);
+    }
+};
+
+/// QUERY_COUNT evenly spaced "what is visible at t" queries against the
+/// presentation space of a track of `size` clips, either through the
+/// ProjectionOperatorMap or through its compiled EvaluationProgram.  Both
+/// find the segment with the same search, so the difference is the walk
+/// over the operators.
+fn PresentationQueryBench(
+    comptime compiled: bool,
+) type
+{
+    return struct {
+        generated: otio.timeline_generator.GeneratedTimeline,
+        map: otio.TopologicalMap,
+        po_map: otio.ProjectionOperatorMap,
+        program: otio.EvaluationProgram,
+
+        const QUERY_COUNT = 1000;
+
+        pub fn setup(
+            allocator: std.mem.Allocator,
+            size: usize,
+        ) !@This()
+        {
+            const generated = try generated_timeline(allocator, size);
+            const map = try otio.build_topological_map(
+                allocator,
+                generated.ref(),
+            );
+            const po_map = try otio.projection_map_to_media_from(
+                allocator,
+                map,
+                try generated.ref().space(.presentation),
+            );
+
+            return .{
+                .generated = generated,
+                .map = map,
+                .po_map = po_map,
+                .program = try otio.EvaluationProgram.compile(
+                    allocator,
+                    po_map,
+                ),
+            };
+        }
+
+        pub fn run(
+            self: @This(),
+            _: std.mem.Allocator,
+        ) !void
+        {
+            const start = self.program.end_points[0];
+            const step = self.program.end_points[
+                self.program.end_points.len - 1
+            ].sub(start).div(QUERY_COUNT);
+
+            var samples: [8]otio.evaluation_program.Sample = undefined;
+
+            for (0..QUERY_COUNT)
+                |ind|
+            {
+                const ord = start.add(step.mul(ind));
+
+                if (compiled)
+                {
+                    std.mem.doNotOptimizeAway(
+                        self.program.evaluate_into(ord, &samples)
+                    );
+                    continue;
+                }
+
+                const segment = self.program.segment_at(ord) orelse continue;
+                for (self.po_map.operators[segment])
+                    |op|
+                {
+                    std.mem.doNotOptimizeAway(
+                        op.project_instantaneous_cc(ord)
+                    );
+                }
+            }
+        }
+
+        pub fn deinit(
+            self: @This(),
+            _: std.mem.Allocator,
+        ) void
+        {
+            self.program.deinit();
+            self.po_map.deinit();
+            self.map.deinit();
+            self.generated.deinit();
+        }
+    };
+}
+
+/// every benchmark, in the order they are run when none are specified
+const BENCHMARKS = .{
+    .{ "treecode", TreecodeBench },
+    .{ "topological_map", TopologicalMapBench },
+    .{ "projection_map", ProjectionMapBench },
+    .{ "projection_map_pooled", ProjectionMapPooledBench },
+    .{ "join_affine", JoinAffineBench },
+    .{ "join_affine_general", JoinAffineGeneralBench },
+    .{ "join_linear", JoinLinearBench },
+    .{ "mapping_join_aff_aff", MappingJoinBench(.affine, .affine) },
+    .{ "mapping_join_aff_lin", MappingJoinBench(.affine, .linear) },
+    .{ "mapping_join_lin_aff", MappingJoinBench(.linear, .affine) },
+    .{ "mapping_join_lin_lin", MappingJoinBench(.linear, .linear) },
+    .{ "linearize", LinearizeBench },
+    .{ "curve_eval", CurveEvalBench },
+    .{ "resample", ResampleBench },
+    .{ "resample_cached", CachedResampleBench },
+    .{ "query_map", PresentationQueryBench(false) },
+    .{ "query_program", PresentationQueryBench(true) },
+};
+
+fn run_named(
+    allocator: std.mem.Allocator,
+    name: []const u8,
+    config: Config,
+    results: *std.ArrayList(Result),
+) !void
+{
+    inline for (BENCHMARKS)
+        |bench|
+    {
+        if (std.mem.eql(u8, name, bench[0]))
+        {
+            try results.append(
+                try measure(bench[0], bench[1], allocator, config)
+            );
+            return;
+        }
+    }
+
+    std.log.err("unknown benchmark: '{s}', try --list", .{ name });
+    return error.UnknownBenchmark;
+}
+
+fn print_usage(
+    writer: anytype,
+) !void
+{
+    try writer.print(
+        "usage: wrinkles_bench [benchmark ...] [--size N] [--iterations N]\n"
+        ++ "                      [--trace trace.json]\n"
+        ++ "benchmarks:\n",
+        .{},
+    );
+    inline for (BENCHMARKS)
+        |bench|
+    {
+        try writer.print("    {s}\n", .{ bench[0] });
+    }
+}
+
+pub fn main(
+) !void
+{
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    var config = Config{};
+    var names = std.ArrayList([]const u8).init(allocator);
+    defer names.deinit();
+    var maybe_trace_path: ?[]const u8 = null;
+
+    var arg_ind: usize = 1;
+    while (arg_ind < args.len)
+        : (arg_ind += 1)
+    {
+        const arg = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--list") or std.mem.eql(u8, arg, "--help"))
+        {
+            return print_usage(std.io.getStdOut().writer());
+        }
+        else if (
+            std.mem.eql(u8, arg, "--size")
+            or std.mem.eql(u8, arg, "--iterations")
+        )
+        {
+            arg_ind += 1;
+            if (arg_ind >= args.len)
+            {
+                std.log.err("{s} requires a value", .{ arg });
+                return error.MissingArgument;
+            }
+            const value = try std.fmt.parseInt(usize, args[arg_ind], 10);
+            if (arg[2] == 's') {
+                config.size = value;
+            } else {
+                config.iterations = value;
+            }
+        }
+        else if (std.mem.eql(u8, arg, "--trace"))
+        {
+            arg_ind += 1;
+            if (arg_ind >= args.len)
+            {
+                std.log.err("{s} requires a value", .{ arg });
+                return error.MissingArgument;
+            }
+            maybe_trace_path = args[arg_ind];
+        }
+        else
+        {
+            try names.append(arg);
+        }
+    }
+
+    if (maybe_trace_path != null)
+    {
+        if (!tracing.ENABLED)
+        {
+            std.log.err(
+                "--trace requires building with -Denable_tracing=true",
+                .{},
+            );
+            return error.TracingDisabled;
+        }
+        try tracing.start(allocator);
+    }
+    defer tracing.stop();
+
+    var results = std.ArrayList(Result).init(allocator);
+    defer results.deinit();
+
+    if (names.items.len == 0)
+    {
+        inline for (BENCHMARKS)
+            |bench|
+        {
+            try results.append(
+                try measure(bench[0], bench[1], allocator, config)
+            );
+        }
+    }
+    else
+    {
+        for (names.items)
+            |name|
+        {
+            try run_named(allocator, name, config, &results);
+        }
+    }
+
+    const stdout = std.io.getStdOut().writer();
+    try std.json.stringify(
+        .{
+            .hash = build_options.hash,
+            .optimize = @tagName(builtin.mode),
+            .results = results.items,
+        },
+        .{ .whitespace = .indent_2 },
+        stdout,
+    );
+    try stdout.writeByte('\n');
+
+    if (maybe_trace_path)
+        |trace_path|
+    {
+        try tracing.write_chrome_trace_file(trace_path);
+    }
+}
@@ -0,0 +1,64 @@
+//! Report what changed in time between two revisions of a timeline.
+//!
+//! Usage:
+//!     wrinkles_diff old.otio new.otio
+//!
+//! Prints the presentation space ranges of new.otio whose media or mapping
+//! differ from old.otio as JSON, so that only those ranges are rendered
+//! again.
+
+const std = @import("std");
+
+const otio = @import("opentimelineio");
+
+const USAGE = "usage: wrinkles_diff old.otio new.otio\n";
+
+pub fn main(
+) !void
+{
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    if (args.len != 3)
+    {
+        try std.io.getStdErr().writeAll(USAGE);
+        return error.MissingArgument;
+    }
+
+    const old_timeline = try otio.read_from_file(allocator, args[1]);
+    defer old_timeline.recursively_deinit();
+    const new_timeline = try otio.read_from_file(allocator, args[2]);
+    defer new_timeline.recursively_deinit();
+
+    const changes = try otio.timeline_diff.diff_timelines(
+        allocator,
+        &old_timeline,
+        &new_timeline,
+    );
+    defer allocator.free(changes);
+
+    var changed_s: f64 = 0;
+    const ranges = try allocator.alloc([2]f64, changes.len);
+    defer allocator.free(ranges);
+    for (ranges, changes)
+        |*range, change|
+    {
+        range.* = .{ change.start.as(f64), change.end.as(f64) };
+        changed_s += change.duration().as(f64);
+    }
+
+    const stdout = std.io.getStdOut().writer();
+    try std.json.stringify(
+        .{
+            .changed = ranges,
+            .changed_seconds = changed_s,
+        },
+        .{ .whitespace = .indent_2 },
+        stdout,
+    );
+    try stdout.writeByte('\n');
+}
@@ -0,0 +1,145 @@
+//! Command line front end for the synthetic timeline generator.
+//!
+//! Usage:
+//!     wrinkles_generate [--tracks N] [--clips-per-track N] [--gap-ratio F]
+//!                       [--nesting-depth N] [--warp-density F]
+//!                       [--bezier-knots N] [--seed N] [--rate N]
+//!                       [--out path.otio]
+//!
+//! Without --out the timeline is only built in memory.  Either way a JSON
+//! summary (counts, bounds, timing) is printed to stdout.  Warps cannot be
+//! written to .otio files yet, so --out requires --warp-density 0.
+
+const std = @import("std");
+
+const otio = @import("opentimelineio");
+const generator = otio.timeline_generator;
+
+const USAGE = (
+    \\usage: wrinkles_generate [--tracks N] [--clips-per-track N]
+    \\           [--gap-ratio F] [--nesting-depth N] [--warp-density F]
+    \\           [--bezier-knots N] [--seed N] [--rate N] [--out path.otio]
+    \\
+);
+
+/// a command line flag and the Parameters field it sets
+const FLAGS = .{
+    .{ "--tracks", "track_count" },
+    .{ "--clips-per-track", "clips_per_track" },
+    .{ "--gap-ratio", "gap_ratio" },
+    .{ "--nesting-depth", "nesting_depth" },
+    .{ "--warp-density", "warp_density" },
+    .{ "--bezier-knots", "bezier_knots" },
+    .{ "--seed", "seed" },
+    .{ "--rate", "rate_hz" },
+};
+
+/// parse value into the type of the field on params
+fn set_field(
+    params: *generator.Parameters,
+    comptime field_name: []const u8,
+    value: []const u8,
+) !void
+{
+    const FieldType = @TypeOf(@field(params.*, field_name));
+    @field(params.*, field_name) = switch (@typeInfo(FieldType)) {
+        .Float => try std.fmt.parseFloat(FieldType, value),
+        .Int => try std.fmt.parseInt(FieldType, value, 10),
+        else => @compileError("unsupported flag type"),
+    };
+}
+
+pub fn main(
+) !void
+{
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    var params = generator.Parameters{};
+    var maybe_out_path: ?[]const u8 = null;
+
+    var arg_ind: usize = 1;
+    args: while (arg_ind < args.len)
+        : (arg_ind += 1)
+    {
+        const arg = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--help"))
+        {
+            try std.io.getStdOut().writeAll(USAGE);
+            return;
+        }
+
+        if (arg_ind + 1 >= args.len)
+        {
+            std.log.err("{s} requires a value\n{s}", .{ arg, USAGE });
+            return error.MissingArgument;
+        }
+        arg_ind += 1;
+        const value = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--out"))
+        {
+            maybe_out_path = value;
+            continue;
+        }
+
+        inline for (FLAGS)
+            |flag|
+        {
+            if (std.mem.eql(u8, arg, flag[0]))
+            {
+                try set_field(&params, flag[1], value);
+                continue :args;
+            }
+        }
+
+        std.log.err("unknown argument: '{s}'\n{s}", .{ arg, USAGE });
+        return error.UnknownArgument;
+    }
+
+    if (maybe_out_path != null and params.warp_density > 0)
+    {
+        std.log.err("warps cannot be written to .otio files yet", .{});
+        return error.NotImplementedWarpJson;
+    }
+
+    var timer = try std.time.Timer.start();
+
+    const gen = try generator.generate(allocator, params);
+    defer gen.deinit();
+
+    const generate_ns = timer.lap();
+
+    if (maybe_out_path)
+        |out_path|
+    {
+        try otio.write_to_file(gen.timeline.*, out_path);
+    }
+
+    const write_ns = timer.read();
+
+    const bounds = try gen.ref().bounds_of(allocator, .presentation);
+
+    const stdout = std.io.getStdOut().writer();
+    try std.json.stringify(
+        .{
+            .parameters = params,
+            .counts = gen.counts,
+            .presentation_bounds_s = .{
+                bounds.start.as(f64),
+                bounds.end.as(f64),
+            },
+            .generate_ns = generate_ns,
+            .write_ns = if (maybe_out_path != null) write_ns else 0,
+            .out = maybe_out_path,
+        },
+        .{ .whitespace = .indent_2 },
+        stdout,
+    );
+    try stdout.writeByte('\n');
+}
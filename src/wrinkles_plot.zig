@@ -0,0 +1,572 @@
+//! Headless front end for the visualizer math.
+//!
+//! Runs the computations the curve and transformation visualizers plot and
+//! writes the resulting series as CSV or JSON, along with how long each stage
+//! took, so the math can be checked and profiled without a display.
+//!
+//! Usage:
+//!     wrinkles_plot --curve path.curve.json [--through path.curve.json]
+//!                   [options]
+//!     wrinkles_plot --preset name [options]
+//!
+//! options:
+//!     --steps N           samples per sampled curve (default 1000)
+//!     --iterations N      timed runs of each stage (default 10)
+//!     --format csv|json   (default json)
+//!     --out path          write to path instead of stdout
+//!
+//! --through projects the --curve through a second curve, the way curvet's
+//! projection view does.  `wrinkles_plot --list` prints the presets.  With
+//! --format csv the timings are printed to stderr.
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+const build_options = @import("build_options");
+
+const curve = @import("curve");
+const plot_series = @import("plot_series");
+const Series = plot_series.Series;
+
+const DEFAULT_ITERATIONS = 10;
+
+/// input range used for mappings with infinite bounds
+const MAPPING_LIMITS = [2]f64{ -10, 10 };
+
+/// parameters of the three point approximations
+const THREE_POINT_U_VALUES = [_]curve.bezier_curve.U_TYPE{ 0.25, 0.5, 0.75 };
+
+const USAGE = (
+    \\usage: wrinkles_plot --curve path.curve.json [--through path.curve.json]
+    \\                     [--steps N] [--iterations N] [--format csv|json]
+    \\                     [--out path]
+    \\       wrinkles_plot --preset name [--iterations N] [--format csv|json]
+    \\                     [--out path]
+    \\       wrinkles_plot --list
+    \\
+);
+
+/// the data the stages compute from
+const Input = struct {
+    crv: ?curve.Bezier = null,
+    /// curve that crv is projected through
+    through: ?curve.Bezier = null,
+    preset: ?plot_series.Preset = null,
+    steps: usize = plot_series.DEFAULT_STEPS,
+};
+
+/// output format
+const Format = enum { json, csv };
+
+/// timing for a single stage, serialized to JSON
+const Timing = struct {
+    stage: []const u8,
+    iterations: usize,
+    total_ns: u64,
+    ns_per_op: f64,
+};
+
+//
+// Stages.  Each appends the series it computes to `out`.
+//
+
+fn stage_sample(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    try append_series(
+        out,
+        try plot_series.bezier_series(
+            allocator,
+            "curve",
+            input.crv.?,
+            input.steps,
+        ),
+        allocator,
+    );
+}
+
+fn stage_split_on_critical_points(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    const split = try input.crv.?.split_on_critical_points(allocator);
+    defer split.deinit(allocator);
+
+    try append_series(
+        out,
+        try plot_series.bezier_series(
+            allocator,
+            "split_on_critical_points",
+            split,
+            input.steps,
+        ),
+        allocator,
+    );
+}
+
+fn stage_linearized(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    const lin = try input.crv.?.linearized(allocator);
+    defer lin.deinit(allocator);
+
+    try append_series(
+        out,
+        try plot_series.linear_series(allocator, "linearized", lin),
+        allocator,
+    );
+}
+
+fn stage_three_point_approximation(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    for (THREE_POINT_U_VALUES)
+        |u|
+    {
+        const approx = try plot_series.three_point_approximation(
+            allocator,
+            input.crv.?,
+            u,
+        );
+        defer approx.deinit(allocator);
+
+        var buf: [128]u8 = undefined;
+        try append_series(
+            out,
+            try plot_series.bezier_series(
+                allocator,
+                try std.fmt.bufPrint(
+                    &buf,
+                    "three_point_approximation u={d}",
+                    .{ u },
+                ),
+                approx,
+                input.steps,
+            ),
+            allocator,
+        );
+    }
+}
+
+fn stage_projection(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    const guts = try input.through.?.project_curve_guts(
+        allocator,
+        input.crv.?,
+    );
+    defer guts.deinit();
+
+    inline for (.{ "result", "self_split", "other_split" })
+        |field|
+    {
+        if (@field(guts, field))
+            |crv|
+        {
+            try append_series(
+                out,
+                try plot_series.bezier_series(
+                    allocator,
+                    "projection." ++ field,
+                    crv,
+                    input.steps,
+                ),
+                allocator,
+            );
+        }
+    }
+}
+
+fn stage_mappings(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    for (input.preset.?.spaces)
+        |space|
+    {
+        var buf: [256]u8 = undefined;
+        try append_series(
+            out,
+            try plot_series.mapping_series(
+                allocator,
+                try std.fmt.bufPrint(
+                    &buf,
+                    "{s}.{s} -> {s}.{s}",
+                    .{ space.name, space.input, space.name, space.output },
+                ),
+                space.mapping,
+                MAPPING_LIMITS,
+            ),
+            allocator,
+        );
+    }
+}
+
+fn stage_composed(
+    allocator: std.mem.Allocator,
+    input: Input,
+    out: *std.ArrayList(Series),
+) !void
+{
+    const total_map = try plot_series.composed_mapping(
+        allocator,
+        input.preset.?.spaces,
+    );
+    defer total_map.deinit(allocator);
+
+    try append_series(
+        out,
+        try plot_series.mapping_series(
+            allocator,
+            "composed",
+            total_map,
+            MAPPING_LIMITS,
+        ),
+        allocator,
+    );
+}
+
+const CURVE_STAGES = .{
+    .{ "sample", stage_sample },
+    .{ "split_on_critical_points", stage_split_on_critical_points },
+    .{ "linearized", stage_linearized },
+    .{ "three_point_approximation", stage_three_point_approximation },
+};
+
+const PROJECTION_STAGES = .{
+    .{ "projection", stage_projection },
+};
+
+const PRESET_STAGES = .{
+    .{ "mappings", stage_mappings },
+    .{ "composed", stage_composed },
+};
+
+/// append s to out, freeing s if that fails
+fn append_series(
+    out: *std.ArrayList(Series),
+    s: Series,
+    allocator: std.mem.Allocator,
+) !void
+{
+    out.append(s) catch |err| {
+        s.deinit(allocator);
+        return err;
+    };
+}
+
+/// run stage once to keep its output in `series`, then time `iterations`
+/// more runs whose output is thrown away
+fn measure(
+    allocator: std.mem.Allocator,
+    comptime name: []const u8,
+    comptime stage: anytype,
+    input: Input,
+    iterations: usize,
+    series: *std.ArrayList(Series),
+) !Timing
+{
+    try stage(allocator, input, series);
+
+    var scratch = std.ArrayList(Series).init(allocator);
+    defer {
+        for (scratch.items)
+            |s|
+        {
+            s.deinit(allocator);
+        }
+        scratch.deinit();
+    }
+
+    var total_ns: u64 = 0;
+    var timer = try std.time.Timer.start();
+    for (0..iterations)
+        |_|
+    {
+        timer.reset();
+        try stage(allocator, input, &scratch);
+        total_ns += timer.read();
+
+        for (scratch.items)
+            |s|
+        {
+            s.deinit(allocator);
+        }
+        scratch.clearRetainingCapacity();
+    }
+
+    const iterations_f: f64 = @floatFromInt(@max(iterations, 1));
+
+    return .{
+        .stage = name,
+        .iterations = iterations,
+        .total_ns = total_ns,
+        .ns_per_op = @as(f64, @floatFromInt(total_ns)) / iterations_f,
+    };
+}
+
+fn run_stages(
+    allocator: std.mem.Allocator,
+    comptime stages: anytype,
+    input: Input,
+    iterations: usize,
+    series: *std.ArrayList(Series),
+    timings: *std.ArrayList(Timing),
+) !void
+{
+    inline for (stages)
+        |stage|
+    {
+        try timings.append(
+            try measure(
+                allocator,
+                stage[0],
+                stage[1],
+                input,
+                iterations,
+                series,
+            )
+        );
+    }
+}
+
+fn write_output(
+    writer: anytype,
+    format: Format,
+    source: []const u8,
+    input: Input,
+    series: []const Series,
+    timings: []const Timing,
+) !void
+{
+    switch (format) {
+        .json => {
+            try std.json.stringify(
+                .{
+                    .hash = build_options.hash,
+                    .optimize = @tagName(builtin.mode),
+                    .source = source,
+                    .steps = input.steps,
+                    .timings = timings,
+                    .series = series,
+                },
+                .{},
+                writer,
+            );
+            try writer.writeByte('\n');
+        },
+        .csv => {
+            try plot_series.write_csv(writer, series);
+
+            const stderr = std.io.getStdErr().writer();
+            try stderr.writeAll("stage,iterations,total_ns,ns_per_op\n");
+            for (timings)
+                |t|
+            {
+                try stderr.print(
+                    "{s},{d},{d},{d:.1}\n",
+                    .{ t.stage, t.iterations, t.total_ns, t.ns_per_op },
+                );
+            }
+        },
+    }
+}
+
+pub fn main(
+) !void
+{
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    var input = Input{};
+    var iterations: usize = DEFAULT_ITERATIONS;
+    var format = Format.json;
+    var maybe_out_path: ?[]const u8 = null;
+    var maybe_curve_path: ?[]const u8 = null;
+    var maybe_through_path: ?[]const u8 = null;
+    var maybe_preset_name: ?[]const u8 = null;
+
+    var arg_ind: usize = 1;
+    while (arg_ind < args.len)
+        : (arg_ind += 1)
+    {
+        const arg = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--help"))
+        {
+            try std.io.getStdOut().writeAll(USAGE);
+            return;
+        }
+
+        if (std.mem.eql(u8, arg, "--list"))
+        {
+            const stdout = std.io.getStdOut().writer();
+            for (std.meta.fieldNames(plot_series.PresetNames))
+                |name|
+            {
+                try stdout.print("{s}\n", .{ name });
+            }
+            return;
+        }
+
+        if (arg_ind + 1 >= args.len)
+        {
+            std.log.err("{s} requires a value\n{s}", .{ arg, USAGE });
+            return error.MissingArgument;
+        }
+        arg_ind += 1;
+        const value = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--curve")) {
+            maybe_curve_path = value;
+        } else if (std.mem.eql(u8, arg, "--through")) {
+            maybe_through_path = value;
+        } else if (std.mem.eql(u8, arg, "--preset")) {
+            maybe_preset_name = value;
+        } else if (std.mem.eql(u8, arg, "--steps")) {
+            input.steps = try std.fmt.parseInt(usize, value, 10);
+        } else if (std.mem.eql(u8, arg, "--iterations")) {
+            iterations = try std.fmt.parseInt(usize, value, 10);
+        } else if (std.mem.eql(u8, arg, "--out")) {
+            maybe_out_path = value;
+        } else if (std.mem.eql(u8, arg, "--format")) {
+            format = std.meta.stringToEnum(Format, value) orelse {
+                std.log.err("unknown format: '{s}'\n{s}", .{ value, USAGE });
+                return error.UnknownFormat;
+            };
+        } else {
+            std.log.err("unknown argument: '{s}'\n{s}", .{ arg, USAGE });
+            return error.UnknownArgument;
+        }
+    }
+
+    if ((maybe_curve_path == null) == (maybe_preset_name == null))
+    {
+        std.log.err("pass exactly one of --curve or --preset\n{s}", .{ USAGE });
+        return error.MissingArgument;
+    }
+
+    var series = std.ArrayList(Series).init(allocator);
+    defer {
+        for (series.items)
+            |s|
+        {
+            s.deinit(allocator);
+        }
+        series.deinit();
+    }
+
+    var timings = std.ArrayList(Timing).init(allocator);
+    defer timings.deinit();
+
+    if (maybe_curve_path)
+        |curve_path|
+    {
+        const crv = try curve.read_curve_json(curve_path, allocator);
+        defer crv.deinit(allocator);
+        input.crv = crv;
+
+        try run_stages(
+            allocator,
+            CURVE_STAGES,
+            input,
+            iterations,
+            &series,
+            &timings,
+        );
+
+        if (maybe_through_path)
+            |through_path|
+        {
+            const through = try curve.read_curve_json(through_path, allocator);
+            defer through.deinit(allocator);
+            input.through = through;
+
+            try run_stages(
+                allocator,
+                PROJECTION_STAGES,
+                input,
+                iterations,
+                &series,
+                &timings,
+            );
+        }
+    }
+    else if (maybe_preset_name)
+        |preset_name|
+    {
+        const name = std.meta.stringToEnum(
+            plot_series.PresetNames,
+            preset_name,
+        ) orelse {
+            std.log.err(
+                "unknown preset: '{s}', try --list",
+                .{ preset_name },
+            );
+            return error.UnknownPreset;
+        };
+        input.preset = plot_series.preset(name);
+
+        try run_stages(
+            allocator,
+            PRESET_STAGES,
+            input,
+            iterations,
+            &series,
+            &timings,
+        );
+    }
+
+    const source = maybe_curve_path orelse maybe_preset_name.?;
+
+    if (maybe_out_path)
+        |out_path|
+    {
+        const file = try std.fs.cwd().createFile(out_path, .{});
+        defer file.close();
+
+        var buffered = std.io.bufferedWriter(file.writer());
+        try write_output(
+            buffered.writer(),
+            format,
+            source,
+            input,
+            series.items,
+            timings.items,
+        );
+        try buffered.flush();
+    }
+    else
+    {
+        var buffered = std.io.bufferedWriter(std.io.getStdOut().writer());
+        try write_output(
+            buffered.writer(),
+            format,
+            source,
+            input,
+            series.items,
+            timings.items,
+        );
+        try buffered.flush();
+    }
+}
@@ -0,0 +1,304 @@
+//! Resident projection query daemon and its load generator.
+//!
+//! Usage:
+//!     wrinkles_serve serve timeline.otio [--socket path]
+//!     wrinkles_serve load timeline.otio [--socket path] [--requests N]
+//!                    [--batch N] [--kind project|pull_list] [--seed N]
+//!
+//! `serve` loads the timeline, keeps its maps resident and answers requests
+//! on the socket until it is killed.  `load` sends `requests` batches of
+//! `batch` random queries to a running `serve` of the same timeline, runs
+//! the same batches in process, and prints the latency percentiles and
+//! throughput of both as JSON.
+
+const std = @import("std");
+
+const opentime = @import("opentime");
+const otio = @import("opentimelineio");
+const server = otio.server;
+
+const USAGE = (
+    \\usage: wrinkles_serve serve timeline.otio [--socket path]
+    \\       wrinkles_serve load timeline.otio [--socket path]
+    \\           [--requests N] [--batch N] [--kind project|pull_list]
+    \\           [--seed N]
+    \\
+);
+
+const DEFAULT_SOCKET = "/tmp/wrinkles_serve.sock";
+
+const Kind = enum { project, pull_list };
+
+const Options = struct {
+    socket: []const u8 = DEFAULT_SOCKET,
+    requests: usize = 1000,
+    batch: usize = 64,
+    kind: Kind = .project,
+    seed: u64 = 0,
+};
+
+/// latency distribution of a run
+const Report = struct {
+    requests: usize,
+    queries: usize,
+    p50_ns: u64,
+    p90_ns: u64,
+    p99_ns: u64,
+    max_ns: u64,
+    queries_per_s: f64,
+
+    /// summarize latencies_ns, which is sorted in place
+    fn init(
+        latencies_ns: []u64,
+        batch: usize,
+    ) Report
+    {
+        std.mem.sort(u64, latencies_ns, {}, std.sort.asc(u64));
+
+        var total_ns: u64 = 0;
+        for (latencies_ns)
+            |ns|
+        {
+            total_ns += ns;
+        }
+
+        const queries = latencies_ns.len * batch;
+
+        return .{
+            .requests = latencies_ns.len,
+            .queries = queries,
+            .p50_ns = percentile(latencies_ns, 50),
+            .p90_ns = percentile(latencies_ns, 90),
+            .p99_ns = percentile(latencies_ns, 99),
+            .max_ns = latencies_ns[latencies_ns.len - 1],
+            .queries_per_s = (
+                @as(f64, @floatFromInt(queries))
+                / (@as(f64, @floatFromInt(@max(total_ns, 1))) / std.time.ns_per_s)
+            ),
+        };
+    }
+
+    fn percentile(
+        sorted: []const u64,
+        pct: usize,
+    ) u64
+    {
+        return sorted[@min(sorted.len - 1, (sorted.len * pct) / 100)];
+    }
+};
+
+pub fn main(
+) !void
+{
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    if (args.len < 3)
+    {
+        try std.io.getStdErr().writeAll(USAGE);
+        return error.MissingArgument;
+    }
+
+    const mode = args[1];
+    const timeline_path = args[2];
+
+    var options = Options{};
+    var arg_ind: usize = 3;
+    while (arg_ind < args.len)
+        : (arg_ind += 1)
+    {
+        const arg = args[arg_ind];
+
+        if (arg_ind + 1 >= args.len)
+        {
+            std.log.err("{s} requires a value\n{s}", .{ arg, USAGE });
+            return error.MissingArgument;
+        }
+        arg_ind += 1;
+        const value = args[arg_ind];
+
+        if (std.mem.eql(u8, arg, "--socket")) {
+            options.socket = value;
+        } else if (std.mem.eql(u8, arg, "--requests")) {
+            options.requests = try std.fmt.parseInt(usize, value, 10);
+        } else if (std.mem.eql(u8, arg, "--batch")) {
+            options.batch = try std.fmt.parseInt(usize, value, 10);
+        } else if (std.mem.eql(u8, arg, "--seed")) {
+            options.seed = try std.fmt.parseInt(u64, value, 10);
+        } else if (std.mem.eql(u8, arg, "--kind")) {
+            options.kind = std.meta.stringToEnum(Kind, value) orelse {
+                std.log.err("unknown kind: '{s}'\n{s}", .{ value, USAGE });
+                return error.UnknownArgument;
+            };
+        } else {
+            std.log.err("unknown argument: '{s}'\n{s}", .{ arg, USAGE });
+            return error.UnknownArgument;
+        }
+    }
+
+    var resident = try server.Resident.load(allocator, timeline_path);
+    defer resident.deinit();
+
+    if (std.mem.eql(u8, mode, "serve"))
+    {
+        std.log.info(
+            "serving {s} on {s}",
+            .{ timeline_path, options.socket },
+        );
+        var stop = std.atomic.Value(bool).init(false);
+        try server.serve(&resident, options.socket, &stop);
+    }
+    else if (std.mem.eql(u8, mode, "load"))
+    {
+        try load(allocator, &resident, options);
+    }
+    else
+    {
+        std.log.err("unknown mode: '{s}'\n{s}", .{ mode, USAGE });
+        return error.UnknownArgument;
+    }
+}
+
+/// time options.requests batches against the server and in process
+fn load(
+    allocator: std.mem.Allocator,
+    resident: *const server.Resident,
+    options: Options,
+) !void
+{
+    if (options.requests == 0 or options.batch == 0) {
+        return error.EmptyLoad;
+    }
+
+    const end_points = resident.program.end_points;
+    if (end_points.len < 2) {
+        return error.EmptyTimeline;
+    }
+    const start = end_points[0].as(f64);
+    const duration = end_points[end_points.len - 1].as(f64) - start;
+
+    // every query of every request, so both sides see the same load
+    var prng = std.Random.DefaultPrng.init(options.seed);
+    const random = prng.random();
+
+    const ords = try allocator.alloc(f64, options.requests * options.batch);
+    defer allocator.free(ords);
+    for (ords)
+        |*ord|
+    {
+        ord.* = start + random.float(f64) * duration;
+    }
+
+    const ranges = try allocator.alloc([2]f64, ords.len);
+    defer allocator.free(ranges);
+    for (ranges, ords)
+        |*range, ord|
+    {
+        range.* = .{ ord, @min(ord + duration / 100, start + duration) };
+    }
+
+    const remote_ns = try allocator.alloc(u64, options.requests);
+    defer allocator.free(remote_ns);
+    const local_ns = try allocator.alloc(u64, options.requests);
+    defer allocator.free(local_ns);
+
+    // remote
+    {
+        var client = try server.Client.connect(allocator, options.socket);
+        defer client.close();
+
+        var samples = std.ArrayList(server.WireSample).init(allocator);
+        defer samples.deinit();
+        var entries = std.ArrayList(server.PullEntry).init(allocator);
+        defer entries.deinit();
+        var offsets = std.ArrayList(u32).init(allocator);
+        defer offsets.deinit();
+
+        for (remote_ns, 0..)
+            |*ns, ind|
+        {
+            const first = ind * options.batch;
+            const last = first + options.batch;
+
+            var timer = try std.time.Timer.start();
+            switch (options.kind) {
+                .project => try client.project(
+                    ords[first..last],
+                    &samples,
+                    &offsets,
+                ),
+                .pull_list => try client.pull_list(
+                    ranges[first..last],
+                    &entries,
+                    &offsets,
+                ),
+            }
+            ns.* = timer.read();
+        }
+    }
+
+    // in process, through the same resident maps
+    {
+        var arena = std.heap.ArenaAllocator.init(allocator);
+        defer arena.deinit();
+
+        var samples: [64]otio.evaluation_program.Sample = undefined;
+        var entries = std.ArrayList(server.PullEntry).init(allocator);
+        defer entries.deinit();
+
+        for (local_ns, 0..)
+            |*ns, ind|
+        {
+            const first = ind * options.batch;
+            const last = first + options.batch;
+
+            entries.clearRetainingCapacity();
+            _ = arena.reset(.retain_capacity);
+
+            var timer = try std.time.Timer.start();
+            switch (options.kind) {
+                .project => for (ords[first..last])
+                    |ord|
+                {
+                    std.mem.doNotOptimizeAway(
+                        resident.program.evaluate_into(
+                            opentime.Ordinate.init(ord),
+                            &samples,
+                        )
+                    );
+                },
+                .pull_list => for (ranges[first..last])
+                    |range|
+                {
+                    try resident.pull_list_into(
+                        arena.allocator(),
+                        .{
+                            .start = opentime.Ordinate.init(range[0]),
+                            .end = opentime.Ordinate.init(range[1]),
+                        },
+                        &entries,
+                    );
+                },
+            }
+            ns.* = timer.read();
+        }
+    }
+
+    const stdout = std.io.getStdOut().writer();
+    try std.json.stringify(
+        .{
+            .kind = @tagName(options.kind),
+            .batch = options.batch,
+            .segments = resident.program.segment_count(),
+            .remote = Report.init(remote_ns, options.batch),
+            .in_process = Report.init(local_ns, options.batch),
+        },
+        .{ .whitespace = .indent_2 },
+        stdout,
+    );
+    try stdout.writeByte('\n');
+}
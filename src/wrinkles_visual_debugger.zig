@@ -231,9 +231,30 @@ pub fn plot_curve_bezier_segment(
 }
 
 
-/// plot a given mapping with dear imgui
+/// polylines of plotted mappings, keyed on the hash of their plot label
+var POLYLINES = curve.PolylineCache.init(std.heap.c_allocator);
+
+/// viewport of the current plot, for the polyline cache
+fn plot_viewport(
+) curve.polyline_cache.Viewport
+{
+    const limits = zgui.plot.getPlotLimits(.x1, .y1);
+    const size = zgui.plot.getPlotSize();
+
+    return .{
+        .x_min = limits.x[0],
+        .x_max = limits.x[1],
+        .y_min = limits.y[0],
+        .y_max = limits.y[1],
+        .width_px = size[0],
+        .height_px = size[1],
+    };
+}
+
+/// plot a given mapping with dear imgui.  Linear mappings are drawn from a
+/// cached, decimated polyline that is only rebuilt when the mapping changes
+/// or the plot zooms.
 pub fn plot_mapping(
-    allocator: std.mem.Allocator,
     map : topology.mapping.Mapping,
     name: [:0]const u8,
 ) !void
@@ -256,63 +277,72 @@ pub fn plot_mapping(
         input_bounds[1] = plot_limits.x[1];
     }
 
-    var inputs = std.ArrayList(f64).init(allocator);
-    try inputs.ensureTotalCapacity(PLOT_STEPS);
-    defer inputs.deinit();
-    var outputs = std.ArrayList(f64).init(allocator);
-    try outputs.ensureTotalCapacity(PLOT_STEPS);
-    defer outputs.deinit();
-    var len : usize = 0;
-
     switch (map) {
         .affine => |map_aff| {
-            try inputs.append(input_bounds[0]);
-            try inputs.append(input_bounds[1]);
-
-            try outputs.append(
-                (
-                 try map_aff.project_instantaneous_cc(
-                     opentime.Ordinate.init(input_bounds[0])
-                 ).ordinate()
-                ).as(f64)
-            );
-            try outputs.append(
-                (
-                 try map_aff.project_instantaneous_cc(
-                     opentime.Ordinate.init(input_bounds[1])
-                 ).ordinate()
-                ).as(f64)
-            );
+            var outputs : [2]f64 = undefined;
+            for (input_bounds, &outputs)
+                |in, *out|
+            {
+                out.* = (
+                    try map_aff.project_instantaneous_cc(
+                        opentime.Ordinate.init(in)
+                    ).ordinate()
+                ).as(f64);
+            }
 
-            len = 2;
+            zplot.plotLine(
+                name,
+                f64, 
+                .{
+                    .xv = &input_bounds,
+                    .yv = &outputs, 
+                },
+            );
         },
         .linear => |map_lin| {
-            for (map_lin.input_to_output_curve.knots)
-                |k|
-            {
-                try inputs.append(k.in.as(f64));
-                try outputs.append(k.out.as(f64));
-            }
+            const line = try POLYLINES.linear(
+                std.hash.Wyhash.hash(0, name),
+                map_lin.input_to_output_curve.knots,
+                plot_viewport(),
+            );
 
-            len = map_lin.input_to_output_curve.knots.len;
+            zplot.plotLine(
+                name,
+                f64, 
+                .{
+                    .xv = line.xv,
+                    .yv = line.yv, 
+                },
+            );
         },
 
         inline else => {},
     }
+}
 
-    try inputs.resize(len);
-    const in_im = try inputs.toOwnedSlice();
-    try outputs.resize(len);
-    const out_im = try outputs.toOwnedSlice();
+/// draw every field of a stats struct (Topology.stats(),
+/// TopologicalMap.stats(), ProjectionOperatorMap.stats()...) as a tree
+fn draw_stats(
+    label: [:0]const u8,
+    stats: anytype,
+) void
+{
+    if (zgui.treeNode(label))
+    {
+        defer zgui.treePop();
 
-    zplot.plotLine(
-        name,
-        f64, 
-        .{
-            .xv = in_im,
-            .yv = out_im, 
-        },
-    );
+        inline for (std.meta.fields(@TypeOf(stats)))
+            |field|
+        {
+            const value = @field(stats, field.name);
+            switch (@typeInfo(field.type)) {
+                .Struct => draw_stats(field.name, value),
+                .Array => zgui.text(field.name ++ ": {any}", .{ value }),
+                .Float => zgui.text(field.name ++ ": {d:.3}", .{ value }),
+                else => zgui.text(field.name ++ ": {d}", .{ value }),
+            }
+        }
+    }
 }
 
 /// ui for a particular space
@@ -324,7 +354,6 @@ const SpaceUI = struct {
 
     pub fn draw_ui(
         self: @This(),
-        allocator: std.mem.Allocator,
     ) !void
     {
         var buf : [1024:0]u8 = undefined;
@@ -404,14 +433,13 @@ const SpaceUI = struct {
 
                 zgui.plot.setupFinish();
 
-            const graph_label = try std.fmt.bufPrintZ(
-                buf[label.len + plot_label.len..],
-                "{s}.{s} -> {s}.{s}",
-                .{ self.name, self.input, self.name, self.output },
-            );
+                const graph_label = try std.fmt.bufPrintZ(
+                    buf[label.len + plot_label.len..],
+                    "{s}.{s} -> {s}.{s}",
+                    .{ self.name, self.input, self.name, self.output },
+                );
 
                 try plot_mapping(
-                    allocator,
                     self.mapping,
                     graph_label,
                 );
@@ -692,9 +720,27 @@ const TransformVisualizer = struct {
                 for (STATE.data.spaces)
                     |s|
                 {
-                    try s.draw_ui(allocator);
+                    try s.draw_ui();
                 }
             }
+
+            if (zgui.collapsingHeader("Statistics", .{}))
+            {
+                const mappings = try allocator.alloc(
+                    topology.mapping.Mapping,
+                    STATE.data.spaces.len,
+                );
+                defer allocator.free(mappings);
+
+                for (mappings, STATE.data.spaces)
+                    |*m, s|
+                {
+                    m.* = s.mapping;
+                }
+
+                const topo = topology.Topology{ .mappings = mappings };
+                draw_stats("Mappings of all spaces", topo.stats());
+            }
         }
 
         zgui.sameLine(.{});
@@ -795,7 +841,6 @@ const TransformVisualizer = struct {
                 buf = buf[line_label.len..];
 
                 try plot_mapping(
-                    allocator,
                     total_map,
                     line_label,
                 );